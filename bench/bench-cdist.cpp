@@ -0,0 +1,203 @@
+#include <benchmark/benchmark.h>
+#include <jaro_winkler/process.hpp>
+#include <jaro_winkler/sharded_index.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> generate_strings(size_t count, size_t min_len, size_t max_len,
+                                                 unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> len_dist(min_len, max_len);
+    std::uniform_int_distribution<int> char_dist('a', 'z');
+
+    std::vector<std::string> strings(count);
+    for (auto& str : strings) {
+        str.resize(len_dist(gen));
+        for (auto& ch : str) {
+            ch = static_cast<char>(char_dist(gen));
+        }
+    }
+    return strings;
+}
+
+/* alternate between the queries for every choice, which is the access pattern of a
+ * naive implementation iterating choices in the outer loop */
+static void BM_NaiveCachedLoop(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto queries = generate_strings(2048, len / 2, len, 1);
+    auto choices = generate_strings(512, len / 2, len, 2);
+
+    std::vector<jaro_winkler::CachedJaroWinklerSimilarity<char>> scorers;
+    for (const auto& query : queries) {
+        scorers.emplace_back(query);
+    }
+
+    std::vector<double> matrix(queries.size() * choices.size());
+    for (auto _ : state) {
+        for (size_t c = 0; c < choices.size(); ++c) {
+            for (size_t q = 0; q < scorers.size(); ++q) {
+                matrix[q * choices.size() + c] = scorers[q].similarity(choices[c]);
+            }
+        }
+        benchmark::DoNotOptimize(matrix.data());
+    }
+
+    state.counters["Rate"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * queries.size() * choices.size()),
+        benchmark::Counter::kIsRate);
+}
+
+static void BM_CdistTiled(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto queries = generate_strings(2048, len / 2, len, 1);
+    auto choices = generate_strings(512, len / 2, len, 2);
+
+    jaro_winkler::CdistOptions options;
+    options.tiling.query_tile = state.range(1);
+    options.tiling.choice_tile = state.range(2);
+
+    for (auto _ : state) {
+        auto matrix = jaro_winkler::cdist_jaro_winkler(queries, choices, options);
+        benchmark::DoNotOptimize(matrix.data());
+    }
+
+    state.counters["Rate"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * queries.size() * choices.size()),
+        benchmark::Counter::kIsRate);
+}
+
+/* score a[i] against b[i] by calling the free function for every pair */
+static void BM_PairwiseLoop(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto a = generate_strings(65536, len / 2, len, 1);
+    auto b = generate_strings(65536, len / 2, len, 2);
+
+    std::vector<double> scores(a.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            scores[i] = jaro_winkler::jaro_winkler_similarity(a[i], b[i]);
+        }
+        benchmark::DoNotOptimize(scores.data());
+    }
+
+    state.counters["Rate"] = benchmark::Counter(static_cast<double>(state.iterations() * a.size()),
+                                                benchmark::Counter::kIsRate);
+}
+
+static void BM_Pairwise(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto a = generate_strings(65536, len / 2, len, 1);
+    auto b = generate_strings(65536, len / 2, len, 2);
+
+    std::vector<double> scores(a.size());
+    for (auto _ : state) {
+        jaro_winkler::pairwise_jaro_winkler(a, b, scores.data());
+        benchmark::DoNotOptimize(scores.data());
+    }
+
+    state.counters["Rate"] = benchmark::Counter(static_cast<double>(state.iterations() * a.size()),
+                                                benchmark::Counter::kIsRate);
+}
+
+/* choices, of which about 40% repeat earlier ones. state.range(0) is the
+ * string length and state.range(1) enables the deduplication */
+static void BM_CdistDuplicates(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto queries = generate_strings(256, len / 2, len, 1);
+    auto choices = generate_strings(4096, len / 2, len, 2);
+    std::mt19937 gen(3);
+    for (size_t i = 1; i < choices.size(); ++i) {
+        if (gen() % 10 < 4) choices[i] = choices[gen() % i];
+    }
+
+    jaro_winkler::CdistOptions options;
+    options.deduplicate = state.range(1) != 0;
+
+    for (auto _ : state) {
+        auto matrix = jaro_winkler::cdist_jaro_winkler(queries, choices, options);
+        benchmark::DoNotOptimize(matrix.data());
+    }
+
+    state.counters["Rate"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * queries.size() * choices.size()),
+        benchmark::Counter::kIsRate);
+}
+
+/* scaling with the number of workers state.range(0). state.range(1) splits the
+ * queries between the NUMA nodes, which only makes a difference on systems
+ * with multiple nodes */
+static void BM_CdistWorkers(benchmark::State& state)
+{
+    auto queries = generate_strings(1024, 32, 64, 1);
+    auto choices = generate_strings(4096, 32, 64, 2);
+
+    jaro_winkler::CdistOptions options;
+    options.workers = state.range(0);
+    options.numa = state.range(1) != 0;
+
+    for (auto _ : state) {
+        auto matrix = jaro_winkler::cdist_jaro_winkler(queries, choices, options);
+        benchmark::DoNotOptimize(matrix.data());
+    }
+
+    state.counters["Rate"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * queries.size() * choices.size()),
+        benchmark::Counter::kIsRate);
+}
+
+/* top-10 search over state.range(0) shards. state.range(1) shares the cutoff
+ * between the shards, while 0 searches every shard independently */
+static void BM_ShardedExtract(benchmark::State& state)
+{
+    auto queries = generate_strings(64, 8, 32, 1);
+    auto choices = generate_strings(16384, 8, 32, 2);
+    jaro_winkler::ShardedPatternIndex<char> index(choices, static_cast<size_t>(state.range(0)));
+    bool share_cutoff = state.range(1) != 0;
+
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            std::vector<std::vector<jaro_winkler::ExtractMatch>> results;
+            jaro_winkler::ShardCutoff shared_cutoff;
+            for (size_t i = 0; i < index.shard_count(); ++i) {
+                jaro_winkler::ShardCutoff local_cutoff;
+                results.push_back(jaro_winkler::shard_extract_jaro_winkler(
+                    index.shard(i), query, 10, share_cutoff ? shared_cutoff : local_cutoff, 0.1,
+                    index.shard_offset(i)));
+            }
+            auto matches = jaro_winkler::merge_shard_results(results, 10);
+            benchmark::DoNotOptimize(matches.data());
+        }
+    }
+
+    state.counters["Rate"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * queries.size() * choices.size()),
+        benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_NaiveCachedLoop)->Arg(16)->Arg(64);
+
+/* tile sizes of 0 use the defaults derived from the string lengths, while a
+ * query tile of 1 disables the tiling */
+BENCHMARK(BM_CdistTiled)
+    ->Args({16, 0, 0})
+    ->Args({16, 1, 512})
+    ->Args({64, 0, 0})
+    ->Args({64, 1, 512});
+
+BENCHMARK(BM_PairwiseLoop)->Arg(8)->Arg(16)->Arg(32)->Arg(64)->Arg(200);
+BENCHMARK(BM_Pairwise)->Arg(8)->Arg(16)->Arg(32)->Arg(64)->Arg(200);
+BENCHMARK(BM_CdistDuplicates)->ArgsProduct({{16, 64}, {0, 1}});
+BENCHMARK(BM_CdistWorkers)
+    ->ArgsProduct({benchmark::CreateRange(1, 256, 2), {0, 1}})
+    ->UseRealTime();
+BENCHMARK(BM_ShardedExtract)->ArgsProduct({{1, 4, 16}, {0, 1}});
+
+BENCHMARK_MAIN();
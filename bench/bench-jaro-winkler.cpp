@@ -0,0 +1,361 @@
+#include <benchmark/benchmark.h>
+#include <jaro_winkler/jaro_winkler.hpp>
+#include <jaro_winkler/record.hpp>
+#include <jaro_winkler/sequence.hpp>
+#include <jaro_winkler/token.hpp>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+static std::vector<std::string> generate_strings(size_t count, size_t min_len, size_t max_len,
+                                                 unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> len_dist(min_len, max_len);
+    std::uniform_int_distribution<int> char_dist('a', 'z');
+
+    std::vector<std::string> strings(count);
+    for (auto& str : strings) {
+        str.resize(len_dist(gen));
+        for (auto& ch : str) {
+            ch = static_cast<char>(char_dist(gen));
+        }
+    }
+    return strings;
+}
+
+static void set_rate(benchmark::State& state, size_t per_iteration)
+{
+    state.counters["Rate"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * per_iteration),
+                           benchmark::Counter::kIsRate);
+}
+
+static void BM_CachedSimilarity(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto query = generate_strings(1, len, len, 1)[0];
+    auto choices = generate_strings(4096, len / 2, len, 2);
+    jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(query);
+
+    std::vector<double> scores(choices.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < choices.size(); ++i) {
+            scores[i] = scorer.similarity(choices[i]);
+        }
+        benchmark::DoNotOptimize(scores.data());
+    }
+
+    set_rate(state, choices.size());
+}
+
+static void BM_CachedSimilarityBatch(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto query = generate_strings(1, len, len, 1)[0];
+    auto choices = generate_strings(4096, len / 2, len, 2);
+    jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(query);
+
+    std::vector<double> scores(choices.size());
+    for (auto _ : state) {
+        scorer.similarity_batch(choices.begin(), choices.end(), scores.data());
+        benchmark::DoNotOptimize(scores.data());
+    }
+
+    set_rate(state, choices.size());
+}
+
+static void BM_UncachedSimilarity(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto queries = generate_strings(4096, len, len, 1);
+    auto choices = generate_strings(4096, len / 2, len, 2);
+
+    std::vector<double> scores(choices.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < choices.size(); ++i) {
+            scores[i] = jaro_winkler::jaro_winkler_similarity(queries[i], choices[i]);
+        }
+        benchmark::DoNotOptimize(scores.data());
+    }
+
+    set_rate(state, choices.size());
+}
+
+/**
+ * free function called in a loop, in which the pattern repeats. range(1)
+ * enables the thread local pattern cache
+ */
+static void BM_UncachedRepeatedPattern(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    auto queries = generate_strings(4, len, len, 1);
+    auto choices = generate_strings(1024, len / 2, len, 2);
+    std::unique_ptr<jaro_winkler::ScopedPatternCache> cache;
+    if (state.range(1)) cache.reset(new jaro_winkler::ScopedPatternCache());
+
+    std::vector<double> scores(choices.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < choices.size(); ++i) {
+            scores[i] = jaro_winkler::jaro_winkler_similarity(queries[i % queries.size()],
+                                                              choices[i]);
+        }
+        benchmark::DoNotOptimize(scores.data());
+    }
+
+    set_rate(state, choices.size());
+}
+
+/* pairs of similar strings over a small alphabet, so most characters are common characters */
+static std::vector<std::pair<std::string, std::string>> generate_similar_pairs(size_t count,
+                                                                             size_t len)
+{
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> char_dist('a', 'd');
+    std::uniform_int_distribution<size_t> pos_dist(0, len - 1);
+
+    std::vector<std::pair<std::string, std::string>> pairs(count);
+    for (auto& pair : pairs) {
+        pair.first.resize(len);
+        for (auto& ch : pair.first) {
+            ch = static_cast<char>(char_dist(gen));
+        }
+        pair.second = pair.first;
+        for (size_t i = 0; i < len / 4; ++i) {
+            std::swap(pair.second[pos_dist(gen)], pair.second[pos_dist(gen)]);
+        }
+    }
+    return pairs;
+}
+
+template <typename CountFunc>
+static void bench_transpositions(benchmark::State& state, CountFunc count_transpositions)
+{
+    using namespace jaro_winkler;
+    size_t len = static_cast<size_t>(state.range(0));
+    auto pairs = generate_similar_pairs(256, len);
+
+    std::vector<common::BlockPatternMatchVector> PMs;
+    std::vector<detail::FlaggedCharsMultiword> flagged;
+    for (const auto& pair : pairs) {
+        PMs.emplace_back(pair.first.begin(), pair.first.end());
+        int64_t Bound = static_cast<int64_t>(len) / 2 - 1;
+        if (len <= 64) {
+            auto word = detail::flag_similar_characters_word(
+                PMs.back(), pair.first.begin(), pair.first.end(), pair.second.begin(),
+                pair.second.end(), static_cast<int>(Bound));
+            flagged.push_back({{word.P_flag}, {word.T_flag}});
+        }
+        else {
+            flagged.push_back(detail::flag_similar_characters_block(
+                PMs.back(), pair.first.begin(), pair.first.end(), pair.second.begin(),
+                pair.second.end(), Bound));
+        }
+    }
+
+    int64_t transpositions = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            transpositions += count_transpositions(PMs[i], pairs[i], flagged[i]);
+        }
+        benchmark::DoNotOptimize(transpositions);
+    }
+
+    set_rate(state, pairs.size());
+}
+
+static void BM_TranspositionsScalar(benchmark::State& state)
+{
+    using namespace jaro_winkler;
+    bench_transpositions(state, [](const common::BlockPatternMatchVector& PM,
+                                   const std::pair<std::string, std::string>& pair,
+                                   const detail::FlaggedCharsMultiword& flagged) {
+        if (pair.first.size() <= 64) {
+            detail::FlaggedCharsWord word = {flagged.P_flag[0], flagged.T_flag[0]};
+            return detail::count_transpositions_word(PM, pair.second.begin(), pair.second.end(),
+                                                     word);
+        }
+        return detail::count_transpositions_block(PM, pair.second.begin(), pair.second.end(),
+                                                  flagged, detail::count_common_chars(flagged));
+    });
+}
+
+#if JARO_WINKLER_HAS_PEXT
+static void BM_TranspositionsBMI2(benchmark::State& state)
+{
+    using namespace jaro_winkler;
+    if (!intrinsics::cpu_supports_fast_pext()) {
+        state.SkipWithError("pext is not supported by the cpu");
+        return;
+    }
+
+    bench_transpositions(state, [](const common::BlockPatternMatchVector&,
+                                   const std::pair<std::string, std::string>& pair,
+                                   const detail::FlaggedCharsMultiword& flagged) {
+        if (pair.first.size() <= 64) {
+            detail::FlaggedCharsWord word = {flagged.P_flag[0], flagged.T_flag[0]};
+            return detail::count_transpositions_word_bmi2(pair.first.begin(), pair.first.end(),
+                                                          pair.second.begin(),
+                                                          pair.second.end(), word);
+        }
+        return detail::count_transpositions_block_bmi2(pair.first.begin(), pair.first.end(),
+                                                       pair.second.begin(), pair.second.end(),
+                                                       flagged);
+    });
+}
+#endif
+
+/**
+ * flag the common characters and count the transpositions using pattern match
+ * vectors with 32 or 64 bit words, which are built for every comparison like
+ * in the uncached scorers
+ */
+template <typename Word>
+static void BM_JaroWordWidth(benchmark::State& state)
+{
+    using namespace jaro_winkler;
+    size_t len = static_cast<size_t>(state.range(0));
+    auto pairs = generate_similar_pairs(256, len);
+    int64_t Bound = static_cast<int64_t>(len) / 2 - 1;
+
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (const auto& pair : pairs) {
+            const std::string& P = pair.first;
+            const std::string& T = pair.second;
+            if (static_cast<int64_t>(len) <= common::word_bits<Word>::value) {
+                common::BasicPatternMatchVector<Word> PM(P.begin(), P.end());
+                auto flagged = detail::flag_similar_characters_word(
+                    PM, P.begin(), P.end(), T.begin(), T.end(), static_cast<int>(Bound));
+                sum += detail::count_common_chars(flagged);
+                sum += detail::count_transpositions_word(PM, T.begin(), T.end(), flagged);
+            }
+            else {
+                common::BasicBlockPatternMatchVector<Word> PM(P.begin(), P.end());
+                auto flagged = detail::flag_similar_characters_block(PM, P.begin(), P.end(),
+                                                                     T.begin(), T.end(), Bound);
+                int64_t common_chars = detail::count_common_chars(flagged);
+                sum += common_chars;
+                sum += detail::count_transpositions_block(PM, T.begin(), T.end(), flagged,
+                                                          common_chars);
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    set_rate(state, pairs.size());
+}
+
+/* records with 8 fields compared with a query record. state.range(0) selects
+ * the score_cutoff in percent, where 0 compares all fields of every record */
+static void BM_RecordSimilarity(benchmark::State& state)
+{
+    const size_t field_count = 8;
+    std::vector<std::vector<std::string>> records(4096);
+    for (size_t field = 0; field < field_count; ++field) {
+        auto values = generate_strings(records.size(), 5, 15, static_cast<unsigned>(field));
+        for (size_t i = 0; i < records.size(); ++i) {
+            records[i].push_back(values[i]);
+        }
+    }
+
+    std::vector<double> weights = {4.0, 3.5, 3.0, 2.0, 1.5, 1.0, 1.0, 0.5};
+    jaro_winkler::CachedRecordSimilarity<char> scorer(records[0], weights);
+    double score_cutoff = static_cast<double>(state.range(0)) / 100.0;
+
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& record : records) {
+            sum += scorer.similarity(record, score_cutoff);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    set_rate(state, records.size());
+}
+
+/* names of 2 to 4 tokens, which are compared with a query in a different token order.
+ * state.range(0) selects token sort (0) or token set (1) */
+static void BM_TokenSimilarity(benchmark::State& state)
+{
+    std::vector<std::string> names(4096);
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<size_t> token_count(2, 4);
+    auto tokens = generate_strings(names.size() * 4, 3, 9, 4);
+    for (size_t i = 0; i < names.size(); ++i) {
+        size_t count = token_count(gen);
+        for (size_t j = 0; j < count; ++j) {
+            if (j) names[i] += ' ';
+            names[i] += tokens[i * 4 + j];
+        }
+    }
+
+    std::string query = tokens[5] + " " + tokens[4];
+    jaro_winkler::CachedTokenSortJaroWinklerSimilarity<char> sort_scorer(query);
+    jaro_winkler::CachedTokenSetJaroWinklerSimilarity<char> set_scorer(query);
+
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& name : names) {
+            sum += state.range(0) ? set_scorer.similarity(name) : sort_scorer.similarity(name);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    set_rate(state, names.size());
+}
+
+/* sequences of 64 bit token ids of the length state.range(0), which share about half
+ * of their tokens with the query. state.range(1) selects CachedJaroSimilarity (0) or
+ * CachedJaroSequenceSimilarity (1) */
+static void BM_SequenceSimilarity(benchmark::State& state)
+{
+    size_t len = static_cast<size_t>(state.range(0));
+    std::mt19937_64 gen(5);
+    std::vector<uint64_t> query(len);
+    for (auto& token : query) {
+        token = gen();
+    }
+
+    std::vector<std::vector<uint64_t>> texts(256, query);
+    for (auto& text : texts) {
+        for (auto& token : text) {
+            if (gen() % 2) token = gen();
+        }
+    }
+
+    jaro_winkler::CachedJaroSimilarity<uint64_t> block_scorer(query);
+    jaro_winkler::CachedJaroSequenceSimilarity<uint64_t> sequence_scorer(query);
+
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& text : texts) {
+            sum += state.range(1) ? sequence_scorer.similarity(text)
+                                  : block_scorer.similarity(text);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    set_rate(state, texts.size());
+}
+
+BENCHMARK(BM_CachedSimilarity)->Arg(8)->Arg(16)->Arg(32)->Arg(64);
+BENCHMARK(BM_CachedSimilarityBatch)->Arg(8)->Arg(16)->Arg(32)->Arg(64);
+BENCHMARK(BM_UncachedSimilarity)->Arg(8)->Arg(16)->Arg(32)->Arg(64);
+BENCHMARK(BM_UncachedRepeatedPattern)->ArgsProduct({{8, 16, 64, 200}, {0, 1}});
+BENCHMARK(BM_TranspositionsScalar)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+#if JARO_WINKLER_HAS_PEXT
+BENCHMARK(BM_TranspositionsBMI2)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+#endif
+
+BENCHMARK_TEMPLATE(BM_JaroWordWidth, uint32_t)->Arg(8)->Arg(16)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK_TEMPLATE(BM_JaroWordWidth, uint64_t)->Arg(8)->Arg(16)->Arg(32)->Arg(128)->Arg(512);
+
+BENCHMARK(BM_RecordSimilarity)->Arg(0)->Arg(70)->Arg(85);
+BENCHMARK(BM_TokenSimilarity)->Arg(0)->Arg(1);
+BENCHMARK(BM_SequenceSimilarity)->ArgsProduct({{64, 256, 1024, 4096}, {0, 1}});
+
+BENCHMARK_MAIN();
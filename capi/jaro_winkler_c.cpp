@@ -0,0 +1,442 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#include "jaro_winkler_c.h"
+
+#include <jaro_winkler/jaro_winkler.hpp>
+#include <jaro_winkler/process.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+using namespace jaro_winkler;
+
+/* characters of a jw_string, which can be used as a sentence by the bulk APIs */
+template <typename CharT>
+struct StringSpan {
+    const CharT* first;
+    const CharT* last;
+
+    const CharT* begin() const
+    {
+        return first;
+    }
+
+    const CharT* end() const
+    {
+        return last;
+    }
+};
+
+std::string& last_error()
+{
+    static thread_local std::string error;
+    return error;
+}
+
+/* runs func and converts exceptions into a jw_status */
+template <typename Func>
+int guarded(Func func)
+{
+    try {
+        func();
+        return JW_OK;
+    }
+    catch (const std::invalid_argument& e) {
+        last_error() = e.what();
+        return JW_ERROR_INVALID_ARGUMENT;
+    }
+    catch (const std::bad_alloc&) {
+        last_error() = "out of memory";
+        return JW_ERROR_OUT_OF_MEMORY;
+    }
+    catch (const std::exception& e) {
+        last_error() = e.what();
+        return JW_ERROR_INTERNAL;
+    }
+    catch (...) {
+        last_error() = "unknown error";
+        return JW_ERROR_INTERNAL;
+    }
+}
+
+void require(bool condition, const char* message)
+{
+    if (!condition) throw std::invalid_argument(message);
+}
+
+void validate_string(const jw_string& str)
+{
+    require(str.kind == JW_KIND_UINT8 || str.kind == JW_KIND_UINT16 || str.kind == JW_KIND_UINT32,
+            "invalid string kind");
+    require(str.data || !str.length, "string data is NULL");
+}
+
+void validate_strings(const jw_string* strings, size_t count)
+{
+    require(strings || !count, "string array is NULL");
+    for (size_t i = 0; i < count; ++i) {
+        validate_string(strings[i]);
+    }
+}
+
+template <typename CharT>
+StringSpan<CharT> make_span(const jw_string& str)
+{
+    /* empty strings are allowed to be NULL, which is not allowed for the
+     * copies made by the cached scorers */
+    static const CharT empty = 0;
+    const CharT* first = str.length ? static_cast<const CharT*>(str.data) : &empty;
+    return {first, first + str.length};
+}
+
+/* calls func(span) with the characters of str */
+template <typename Func>
+void visit(const jw_string& str, Func func)
+{
+    validate_string(str);
+    switch (str.kind) {
+    case JW_KIND_UINT8: func(make_span<uint8_t>(str)); break;
+    case JW_KIND_UINT16: func(make_span<uint16_t>(str)); break;
+    default: func(make_span<uint32_t>(str)); break;
+    }
+}
+
+template <typename CharT>
+std::vector<StringSpan<CharT>> make_spans(const jw_string* strings, size_t count)
+{
+    std::vector<StringSpan<CharT>> spans(count);
+    for (size_t i = 0; i < count; ++i) {
+        spans[i] = make_span<CharT>(strings[i]);
+    }
+    return spans;
+}
+
+/* calls func(offset, spans) for every run of strings with the same kind */
+template <typename Func>
+void for_each_kind_run(const jw_string* strings, size_t count, Func func)
+{
+    validate_strings(strings, count);
+    for (size_t pos = 0; pos < count;) {
+        size_t end = pos + 1;
+        while (end < count && strings[end].kind == strings[pos].kind) ++end;
+
+        switch (strings[pos].kind) {
+        case JW_KIND_UINT8: func(pos, make_spans<uint8_t>(strings + pos, end - pos)); break;
+        case JW_KIND_UINT16: func(pos, make_spans<uint16_t>(strings + pos, end - pos)); break;
+        default: func(pos, make_spans<uint32_t>(strings + pos, end - pos)); break;
+        }
+        pos = end;
+    }
+}
+
+/* calls func(a_spans, b_spans, positions) for the pairs of every combination of kinds */
+template <typename Func>
+void for_each_kind_pair(const jw_string* a, const jw_string* b, size_t count, Func func)
+{
+    validate_strings(a, count);
+    validate_strings(b, count);
+
+    std::vector<size_t> positions[3][3];
+    for (size_t i = 0; i < count; ++i) {
+        positions[a[i].kind / 2][b[i].kind / 2].push_back(i);
+    }
+
+    auto run = [&](auto a_tag, auto b_tag, const std::vector<size_t>& pos) {
+        using CharT1 = decltype(a_tag);
+        using CharT2 = decltype(b_tag);
+        if (pos.empty()) return;
+
+        std::vector<StringSpan<CharT1>> a_spans(pos.size());
+        std::vector<StringSpan<CharT2>> b_spans(pos.size());
+        for (size_t i = 0; i < pos.size(); ++i) {
+            a_spans[i] = make_span<CharT1>(a[pos[i]]);
+            b_spans[i] = make_span<CharT2>(b[pos[i]]);
+        }
+        func(a_spans, b_spans, pos);
+    };
+
+    auto run_b = [&](auto a_tag, const std::vector<size_t>(&pos)[3]) {
+        run(a_tag, uint8_t(), pos[0]);
+        run(a_tag, uint16_t(), pos[1]);
+        run(a_tag, uint32_t(), pos[2]);
+    };
+
+    run_b(uint8_t(), positions[0]);
+    run_b(uint16_t(), positions[1]);
+    run_b(uint32_t(), positions[2]);
+}
+
+} // namespace
+
+struct jw_scorer {
+    virtual ~jw_scorer() = default;
+    virtual double similarity(const jw_string& s2, double score_cutoff) const = 0;
+    virtual void similarity_batch(const jw_string* choices, size_t count, double score_cutoff,
+                                  double* scores) const = 0;
+};
+
+struct jw_index {
+    virtual ~jw_index() = default;
+    virtual size_t size() const = 0;
+    virtual void cdist(const jw_string* choices, size_t count, bool winkler, double prefix_weight,
+                       double score_cutoff, int64_t workers, double* matrix) const = 0;
+};
+
+namespace {
+
+template <typename Scorer>
+struct ScorerImpl final : jw_scorer {
+    template <typename... Args>
+    explicit ScorerImpl(Args&&... args) : scorer(std::forward<Args>(args)...)
+    {}
+
+    double similarity(const jw_string& s2, double score_cutoff) const override
+    {
+        double score = 0;
+        visit(s2, [&](const auto& span) { score = scorer.similarity(span, score_cutoff); });
+        return score;
+    }
+
+    void similarity_batch(const jw_string* choices, size_t count, double score_cutoff,
+                          double* scores) const override
+    {
+        for_each_kind_run(choices, count, [&](size_t offset, const auto& spans) {
+            scorer.similarity_batch(spans.begin(), spans.end(), scores + offset, score_cutoff);
+        });
+    }
+
+    Scorer scorer;
+};
+
+template <typename CharT1>
+struct IndexImpl final : jw_index {
+    explicit IndexImpl(const std::vector<std::vector<CharT1>>& patterns, int64_t workers)
+        : slab(patterns, workers)
+    {}
+
+    size_t size() const override
+    {
+        return slab.size();
+    }
+
+    void cdist(const jw_string* choices, size_t count, bool winkler, double prefix_weight,
+               double score_cutoff, int64_t workers, double* matrix) const override
+    {
+        for_each_kind_run(choices, count, [&](size_t offset, const auto& spans) {
+            using Choices = typename std::decay<decltype(spans)>::type;
+            using ChoiceIt = typename Choices::const_iterator;
+
+            detail::cdist_tiled(
+                slab, spans, CdistTiling(), workers,
+                [&](size_t q, ChoiceIt first, ChoiceIt last, double* scores) {
+                    if (winkler) {
+                        slab.jaro_winkler_similarity_batch(q, first, last, scores, prefix_weight,
+                                                           score_cutoff);
+                    }
+                    else {
+                        slab.jaro_similarity_batch(q, first, last, scores, score_cutoff);
+                    }
+                },
+                [&](int64_t q, int64_t c, double score) {
+                    matrix[static_cast<size_t>(q) * count + offset + static_cast<size_t>(c)] =
+                        score;
+                });
+        });
+    }
+
+    CachedPatternSlab<CharT1> slab;
+};
+
+template <typename CharT1>
+jw_index* new_index(const jw_string* patterns, size_t count, int64_t workers)
+{
+    std::vector<std::vector<CharT1>> converted(count);
+    for (size_t i = 0; i < count; ++i) {
+        visit(patterns[i], [&](const auto& span) {
+            converted[i].assign(span.begin(), span.end());
+        });
+    }
+    return new IndexImpl<CharT1>(converted, workers);
+}
+
+void cdist_checked(const jw_index* index, const jw_string* choices, size_t count, bool winkler,
+                   double prefix_weight, double score_cutoff, int64_t workers, double* matrix)
+{
+    require(index, "index is NULL");
+    require(matrix || !count || !index->size(), "matrix is NULL");
+    if (winkler) detail::validate_prefix_weight<DefaultJaroPolicy>(prefix_weight);
+    index->cdist(choices, count, winkler, prefix_weight, score_cutoff, workers, matrix);
+}
+
+template <typename PairwiseFunc>
+void pairwise_checked(const jw_string* a, const jw_string* b, size_t count, double* scores,
+                      PairwiseFunc pairwise)
+{
+    require(scores || !count, "scores is NULL");
+    for_each_kind_pair(a, b, count, [&](const auto& a_spans, const auto& b_spans,
+                                        const std::vector<size_t>& positions) {
+        /* all pairs share the same kinds, so no scattering is required */
+        if (positions.size() == count) {
+            pairwise(a_spans, b_spans, scores);
+            return;
+        }
+
+        std::vector<double> results(positions.size());
+        pairwise(a_spans, b_spans, results.data());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            scores[positions[i]] = results[i];
+        }
+    });
+}
+
+} // namespace
+
+extern "C" {
+
+int jw_api_version(void)
+{
+    return JW_C_API_VERSION;
+}
+
+const char* jw_last_error(void)
+{
+    return last_error().c_str();
+}
+
+int jw_scorer_new_jaro(const jw_string* s1, jw_scorer** scorer)
+{
+    return guarded([&]() {
+        require(s1 && scorer, "argument is NULL");
+        visit(*s1, [&](const auto& span) {
+            using CharT1 = typename std::decay<decltype(*span.begin())>::type;
+            *scorer = new ScorerImpl<CachedJaroSimilarity<CharT1>>(span.begin(), span.end());
+        });
+    });
+}
+
+int jw_scorer_new_jaro_winkler(const jw_string* s1, double prefix_weight, jw_scorer** scorer)
+{
+    return guarded([&]() {
+        require(s1 && scorer, "argument is NULL");
+        visit(*s1, [&](const auto& span) {
+            using CharT1 = typename std::decay<decltype(*span.begin())>::type;
+            *scorer = new ScorerImpl<CachedJaroWinklerSimilarity<CharT1>>(
+                span.begin(), span.end(), prefix_weight);
+        });
+    });
+}
+
+void jw_scorer_free(jw_scorer* scorer)
+{
+    delete scorer;
+}
+
+int jw_scorer_similarity(const jw_scorer* scorer, const jw_string* s2, double score_cutoff,
+                         double* score)
+{
+    return guarded([&]() {
+        require(scorer && s2 && score, "argument is NULL");
+        *score = scorer->similarity(*s2, score_cutoff);
+    });
+}
+
+int jw_scorer_similarity_batch(const jw_scorer* scorer, const jw_string* choices, size_t count,
+                               double score_cutoff, double* scores)
+{
+    return guarded([&]() {
+        require(scorer, "scorer is NULL");
+        require(scores || !count, "scores is NULL");
+        scorer->similarity_batch(choices, count, score_cutoff, scores);
+    });
+}
+
+int jw_index_new(const jw_string* patterns, size_t count, int64_t workers, jw_index** index)
+{
+    return guarded([&]() {
+        require(index, "index is NULL");
+        validate_strings(patterns, count);
+
+        /* the patterns are stored using the widest kind */
+        int kind = JW_KIND_UINT8;
+        for (size_t i = 0; i < count; ++i) {
+            kind = std::max(kind, patterns[i].kind);
+        }
+
+        if (kind == JW_KIND_UINT8)
+            *index = new_index<uint8_t>(patterns, count, workers);
+        else if (kind == JW_KIND_UINT16)
+            *index = new_index<uint16_t>(patterns, count, workers);
+        else
+            *index = new_index<uint32_t>(patterns, count, workers);
+    });
+}
+
+void jw_index_free(jw_index* index)
+{
+    delete index;
+}
+
+size_t jw_index_size(const jw_index* index)
+{
+    return index ? index->size() : 0;
+}
+
+int jw_index_cdist_jaro(const jw_index* index, const jw_string* choices, size_t count,
+                        double score_cutoff, int64_t workers, double* matrix)
+{
+    return guarded([&]() {
+        cdist_checked(index, choices, count, false, 0.1, score_cutoff, workers, matrix);
+    });
+}
+
+int jw_index_cdist_jaro_winkler(const jw_index* index, const jw_string* choices, size_t count,
+                                double prefix_weight, double score_cutoff, int64_t workers,
+                                double* matrix)
+{
+    return guarded([&]() {
+        cdist_checked(index, choices, count, true, prefix_weight, score_cutoff, workers, matrix);
+    });
+}
+
+int jw_pairwise_jaro(const jw_string* a, const jw_string* b, size_t count, double score_cutoff,
+                     int64_t workers, double* scores)
+{
+    return guarded([&]() {
+        CdistOptions options;
+        options.score_cutoff = score_cutoff;
+        options.workers = workers;
+        pairwise_checked(a, b, count, scores, [&](const auto& a_spans, const auto& b_spans,
+                                                  double* out) {
+            pairwise_jaro(a_spans, b_spans, out, options);
+        });
+    });
+}
+
+int jw_pairwise_jaro_winkler(const jw_string* a, const jw_string* b, size_t count,
+                             double prefix_weight, double score_cutoff, int64_t workers,
+                             double* scores)
+{
+    return guarded([&]() {
+        CdistOptions options;
+        options.prefix_weight = prefix_weight;
+        options.score_cutoff = score_cutoff;
+        options.workers = workers;
+        detail::validate_prefix_weight<DefaultJaroPolicy>(prefix_weight);
+        pairwise_checked(a, b, count, scores, [&](const auto& a_spans, const auto& b_spans,
+                                                  double* out) {
+            pairwise_jaro_winkler(a_spans, b_spans, out, options);
+        });
+    });
+}
+
+} // extern "C"
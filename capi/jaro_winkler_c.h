@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+/*
+ * C API of jaro_winkler for language bindings
+ *
+ * Every function returning int returns JW_OK on success or one of the other
+ * jw_status values. Output arguments are only written on success. Scorers
+ * and indexes are immutable after creation and can be used by multiple
+ * threads at the same time.
+ *
+ * The batch functions compare thousands of strings in a single call, so the
+ * overhead of crossing the language boundary is paid once per batch instead
+ * of once per comparison.
+ *
+ * Functions and types are only added to this header. Existing signatures
+ * and enum values never change within the same JW_C_API_VERSION.
+ */
+
+#ifndef JARO_WINKLER_C_H
+#define JARO_WINKLER_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(JARO_WINKLER_C_STATIC)
+#    define JW_C_API
+#elif defined(_WIN32)
+#    if defined(JARO_WINKLER_C_BUILDING)
+#        define JW_C_API __declspec(dllexport)
+#    else
+#        define JW_C_API __declspec(dllimport)
+#    endif
+#else
+#    define JW_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JW_C_API_VERSION 1
+
+enum jw_status {
+    JW_OK = 0,
+    JW_ERROR_INVALID_ARGUMENT = 1,
+    JW_ERROR_OUT_OF_MEMORY = 2,
+    JW_ERROR_INTERNAL = 3
+};
+
+/* width of the characters of a jw_string */
+enum jw_kind {
+    JW_KIND_UINT8 = 1,
+    JW_KIND_UINT16 = 2,
+    JW_KIND_UINT32 = 4
+};
+
+/*
+ * string passed to the library. The characters are not copied by the batch
+ * functions. Strings of different kinds can be mixed in the same array.
+ * UTF-8 input should be decoded to code points (JW_KIND_UINT32) or, when it
+ * only contains ASCII, passed as JW_KIND_UINT8.
+ */
+typedef struct jw_string {
+    const void* data;
+    size_t length;
+    int kind;
+} jw_string;
+
+/* cached scorer holding the pattern match vector of a single string */
+typedef struct jw_scorer jw_scorer;
+
+/* pattern match vectors of many strings stored in a single allocation */
+typedef struct jw_index jw_index;
+
+/* JW_C_API_VERSION the library was compiled with */
+JW_C_API int jw_api_version(void);
+
+/* description of the last error on the calling thread. Never NULL */
+JW_C_API const char* jw_last_error(void);
+
+/*
+ * scorers
+ */
+JW_C_API int jw_scorer_new_jaro(const jw_string* s1, jw_scorer** scorer);
+JW_C_API int jw_scorer_new_jaro_winkler(const jw_string* s1, double prefix_weight,
+                                        jw_scorer** scorer);
+JW_C_API void jw_scorer_free(jw_scorer* scorer);
+
+JW_C_API int jw_scorer_similarity(const jw_scorer* scorer, const jw_string* s2,
+                                  double score_cutoff, double* score);
+
+/* similarity with each of the count strings in choices written to scores */
+JW_C_API int jw_scorer_similarity_batch(const jw_scorer* scorer, const jw_string* choices,
+                                        size_t count, double score_cutoff, double* scores);
+
+/*
+ * indexes
+ */
+JW_C_API int jw_index_new(const jw_string* patterns, size_t count, int64_t workers,
+                          jw_index** index);
+JW_C_API void jw_index_free(jw_index* index);
+JW_C_API size_t jw_index_size(const jw_index* index);
+
+/*
+ * similarity of every pattern of the index with every choice written to
+ * matrix in row major order. matrix needs space for
+ * jw_index_size(index) * count elements. workers <= 0 uses all cores.
+ */
+JW_C_API int jw_index_cdist_jaro(const jw_index* index, const jw_string* choices, size_t count,
+                                 double score_cutoff, int64_t workers, double* matrix);
+JW_C_API int jw_index_cdist_jaro_winkler(const jw_index* index, const jw_string* choices,
+                                         size_t count, double prefix_weight,
+                                         double score_cutoff, int64_t workers, double* matrix);
+
+/*
+ * pairwise similarity of a[i] and b[i] written to scores[i]
+ */
+JW_C_API int jw_pairwise_jaro(const jw_string* a, const jw_string* b, size_t count,
+                              double score_cutoff, int64_t workers, double* scores);
+JW_C_API int jw_pairwise_jaro_winkler(const jw_string* a, const jw_string* b, size_t count,
+                                      double prefix_weight, double score_cutoff,
+                                      int64_t workers, double* scores);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JARO_WINKLER_C_H */
@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#include "fuzzing.hpp"
+#include <jaro_winkler/process.hpp>
+#include <jaro_winkler/sequence.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+template <typename CharT>
+void validate_jaro(const std::basic_string<CharT>& s1, const std::basic_string<CharT>& s2,
+                   double score_cutoff)
+{
+    double expected = reference::jaro_similarity(s1, s2);
+    jaro_winkler::CachedJaroSimilarity<CharT> scorer(s1);
+
+    check_result("jaro_similarity", jaro_winkler::jaro_similarity(s1, s2, score_cutoff), expected,
+                 score_cutoff);
+    check_result("CachedJaroSimilarity", scorer.similarity(s2, score_cutoff), expected,
+                 score_cutoff);
+
+    if (s1.size() <= 64) {
+        jaro_winkler::common::PatternMatchVector PM(s1.begin(), s1.end());
+        check_result("jaro_similarity(PatternMatchVector)",
+                     jaro_winkler::detail::jaro_similarity(PM, s1.begin(), s1.end(), s2.begin(),
+                                                           s2.end(), score_cutoff),
+                     expected, score_cutoff);
+    }
+
+    /* mix texts of different lengths, so some of them are scored in SIMD lanes */
+    std::vector<std::basic_string<CharT>> texts = {s2, s2.substr(0, s2.size() / 2), s1, s2 + s2};
+    std::vector<double> scores(texts.size());
+    scorer.similarity_batch(texts.begin(), texts.end(), scores.data(), score_cutoff);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        check_result("CachedJaroSimilarity::similarity_batch", scores[i],
+                     reference::jaro_similarity(s1, texts[i]), score_cutoff);
+    }
+}
+
+template <typename CharT>
+void validate_jaro_winkler(const std::basic_string<CharT>& s1,
+                           const std::basic_string<CharT>& s2, double score_cutoff)
+{
+    double expected = reference::jaro_winkler_similarity(s1, s2);
+    jaro_winkler::CachedJaroWinklerSimilarity<CharT> scorer(s1);
+
+    check_result("jaro_winkler_similarity",
+                 jaro_winkler::jaro_winkler_similarity(s1, s2, 0.1, score_cutoff), expected,
+                 score_cutoff);
+    check_result("CachedJaroWinklerSimilarity", scorer.similarity(s2, score_cutoff), expected,
+                 score_cutoff);
+
+    std::vector<std::basic_string<CharT>> texts = {s2, s1, s2 + s1};
+    std::vector<double> scores(texts.size());
+    scorer.similarity_batch(texts.begin(), texts.end(), scores.data(), score_cutoff);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        check_result("CachedJaroWinklerSimilarity::similarity_batch", scores[i],
+                     reference::jaro_winkler_similarity(s1, texts[i]), score_cutoff);
+    }
+}
+
+/* free functions using the thread local pattern cache. Every pair is scored
+ * twice, so the second call uses the cached pattern match vector */
+template <typename CharT>
+void validate_pattern_cache(const std::basic_string<CharT>& s1,
+                            const std::basic_string<CharT>& s2, double score_cutoff)
+{
+    jaro_winkler::ScopedPatternCache cache(2);
+    double expected_jaro = reference::jaro_similarity(s1, s2);
+    double expected_jaro_winkler = reference::jaro_winkler_similarity(s1, s2);
+
+    for (int i = 0; i < 2; ++i) {
+        check_result("jaro_similarity(ScopedPatternCache)",
+                     jaro_winkler::jaro_similarity(s1, s2, score_cutoff), expected_jaro,
+                     score_cutoff);
+        check_result("jaro_winkler_similarity(ScopedPatternCache)",
+                     jaro_winkler::jaro_winkler_similarity(s1, s2, 0.1, score_cutoff),
+                     expected_jaro_winkler, score_cutoff);
+    }
+}
+
+/* sequences of 64 bit keys. Multiplying with an odd constant keeps distinct
+ * characters distinct, while spreading the keys over the whole 64 bit range */
+template <typename CharT>
+std::vector<uint64_t> sequence_keys(const std::basic_string<CharT>& s)
+{
+    std::vector<uint64_t> keys;
+    for (CharT ch : s) {
+        keys.push_back(static_cast<uint64_t>(ch) * 0x9E3779B97F4A7C15);
+    }
+    return keys;
+}
+
+template <typename CharT>
+void validate_sequence(const std::basic_string<CharT>& s1, const std::basic_string<CharT>& s2,
+                       double score_cutoff)
+{
+    std::vector<uint64_t> keys1 = sequence_keys(s1);
+    std::vector<uint64_t> keys2 = sequence_keys(s2);
+    jaro_winkler::CachedJaroSequenceSimilarity<uint64_t> jaro(keys1);
+    jaro_winkler::CachedJaroWinklerSequenceSimilarity<uint64_t> winkler(keys1);
+
+    check_result("CachedJaroSequenceSimilarity", jaro.similarity(keys2, score_cutoff),
+                 reference::jaro_similarity(s1, s2), score_cutoff);
+    check_result("CachedJaroWinklerSequenceSimilarity",
+                 winkler.similarity(keys2, score_cutoff),
+                 reference::jaro_winkler_similarity(s1, s2), score_cutoff);
+}
+
+template <typename CharT>
+void validate_pairwise(const std::basic_string<CharT>& s1, const std::basic_string<CharT>& s2,
+                       double score_cutoff)
+{
+    std::vector<std::basic_string<CharT>> a = {s1, s2, s1 + s2, s2};
+    std::vector<std::basic_string<CharT>> b = {s2, s1, s2, s1 + s1};
+    jaro_winkler::CdistOptions options;
+    options.score_cutoff = score_cutoff;
+
+    std::vector<double> jaro_scores = jaro_winkler::pairwise_jaro(a, b, options);
+    std::vector<double> jw_scores = jaro_winkler::pairwise_jaro_winkler(a, b, options);
+    for (size_t i = 0; i < a.size(); ++i) {
+        check_result("pairwise_jaro", jaro_scores[i], reference::jaro_similarity(a[i], b[i]),
+                     score_cutoff);
+        check_result("pairwise_jaro_winkler", jw_scores[i],
+                     reference::jaro_winkler_similarity(a[i], b[i]), score_cutoff);
+    }
+}
+
+template <typename CharT>
+void validate(const std::basic_string<CharT>& s1, const std::basic_string<CharT>& s2,
+              double score_cutoff)
+{
+    for (double cutoff : {0.0, score_cutoff}) {
+        validate_jaro(s1, s2, cutoff);
+        validate_jaro(s2, s1, cutoff);
+        validate_jaro_winkler(s1, s2, cutoff);
+        validate_pattern_cache(s1, s2, cutoff);
+        validate_sequence(s1, s2, cutoff);
+        validate_pairwise(s1, s2, cutoff);
+    }
+}
+
+/**
+ * differential test of all kernel variants against the reference implementation
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    FuzzInput input;
+    if (!parse_fuzz_input(data, size, input)) return 0;
+
+    if (input.wide)
+        validate(widen(input.s1), widen(input.s2), input.score_cutoff);
+    else
+        validate(input.s1, input.s2, input.score_cutoff);
+
+    return 0;
+}
+
+/**
+ * only runs the optimized kernels. Used by the replay driver to detect
+ * performance regressions on a corpus.
+ */
+extern "C" void JaroWinklerFuzzMeasure(const uint8_t* data, size_t size)
+{
+    FuzzInput input;
+    if (!parse_fuzz_input(data, size, input)) return;
+
+    volatile double sink = 0;
+    if (input.wide) {
+        std::u32string s1 = widen(input.s1);
+        std::u32string s2 = widen(input.s2);
+        sink = sink + jaro_winkler::jaro_similarity(s1, s2, input.score_cutoff);
+        sink = sink + jaro_winkler::jaro_winkler_similarity(s1, s2, 0.1, input.score_cutoff);
+    }
+    else {
+        sink = sink + jaro_winkler::jaro_similarity(input.s1, input.s2, input.score_cutoff);
+        sink = sink +
+               jaro_winkler::jaro_winkler_similarity(input.s1, input.s2, 0.1, input.score_cutoff);
+    }
+}
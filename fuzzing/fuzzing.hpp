@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * Input layout shared by all fuzzers:
+ *
+ *   byte 0     score_cutoff * 255
+ *   byte 1     flags (FuzzWideChars: map bytes to characters outside of the extended ascii range)
+ *   byte 2-3   little endian split position of the remaining bytes
+ *   byte 4..   s1 followed by s2
+ */
+struct FuzzInput {
+    double score_cutoff;
+    bool wide;
+    std::string s1;
+    std::string s2;
+};
+
+enum FuzzFlags : uint8_t {
+    FuzzWideChars = 1
+};
+
+static inline bool parse_fuzz_input(const uint8_t* data, size_t size, FuzzInput& input)
+{
+    if (size < 4) return false;
+
+    input.score_cutoff = static_cast<double>(data[0]) / 255.0;
+    input.wide = (data[1] & FuzzWideChars) != 0;
+    size_t split = static_cast<size_t>(data[2] | (data[3] << 8));
+    data += 4;
+    size -= 4;
+    split %= size + 1;
+
+    input.s1.assign(reinterpret_cast<const char*>(data), split);
+    input.s2.assign(reinterpret_cast<const char*>(data) + split, size - split);
+    return true;
+}
+
+/**
+ * map bytes to characters, which are partially stored in the hashmaps of the
+ * pattern match vectors. The mapping produces plenty of collisions in the
+ * 128 slot hashmaps.
+ */
+static inline std::u32string widen(const std::string& s)
+{
+    std::u32string res;
+    res.reserve(s.size());
+    for (char ch : s) {
+        auto byte = static_cast<char32_t>(static_cast<uint8_t>(ch));
+        res.push_back((byte & 1) ? 0x100 + byte * 128 : byte);
+    }
+    return res;
+}
+
+namespace reference {
+
+/**
+ * straightforward O(N*M) implementation of the Jaro similarity used to
+ * validate the optimized kernels
+ */
+template <typename CharT1, typename CharT2>
+double jaro_similarity(const std::basic_string<CharT1>& P, const std::basic_string<CharT2>& T,
+                       double score_cutoff = 0)
+{
+    if (P.empty() || T.empty()) return 0.0;
+
+    int64_t P_len = static_cast<int64_t>(P.size());
+    int64_t T_len = static_cast<int64_t>(T.size());
+    int64_t Bound = std::max<int64_t>(std::max(P_len, T_len) / 2 - 1, 0);
+
+    std::vector<bool> P_flag(P.size());
+    std::vector<bool> T_flag(T.size());
+    int64_t CommonChars = 0;
+    for (int64_t i = 0; i < T_len; ++i) {
+        int64_t lowlim = std::max<int64_t>(i - Bound, 0);
+        int64_t hilim = std::min<int64_t>(i + Bound, P_len - 1);
+        for (int64_t j = lowlim; j <= hilim; ++j) {
+            if (!P_flag[j] && P[j] == T[i]) {
+                P_flag[j] = true;
+                T_flag[i] = true;
+                CommonChars++;
+                break;
+            }
+        }
+    }
+
+    if (!CommonChars) return 0.0;
+
+    int64_t Transpositions = 0;
+    int64_t j = 0;
+    for (int64_t i = 0; i < T_len; ++i) {
+        if (!T_flag[i]) continue;
+        while (!P_flag[j]) j++;
+        if (P[j] != T[i]) Transpositions++;
+        j++;
+    }
+
+    double m = static_cast<double>(CommonChars);
+    double sim = (m / static_cast<double>(P_len) + m / static_cast<double>(T_len) +
+                  (m - static_cast<double>(Transpositions / 2)) / m) /
+                 3.0;
+    return (sim >= score_cutoff) ? sim : 0.0;
+}
+
+template <typename CharT1, typename CharT2>
+double jaro_winkler_similarity(const std::basic_string<CharT1>& P,
+                               const std::basic_string<CharT2>& T, double prefix_weight = 0.1,
+                               double score_cutoff = 0)
+{
+    double sim = jaro_similarity(P, T);
+    if (sim > 0.7) {
+        size_t max_prefix = std::min<size_t>({P.size(), T.size(), 4});
+        size_t prefix = 0;
+        while (prefix < max_prefix && P[prefix] == T[prefix]) prefix++;
+        sim += static_cast<double>(prefix) * prefix_weight * (1.0 - sim);
+    }
+    return (sim >= score_cutoff) ? sim : 0.0;
+}
+
+} // namespace reference
+
+/**
+ * compare the result of an optimized kernel with the reference similarity and
+ * abort on a mismatch, so libFuzzer stores the input as crash
+ */
+static inline void check_result(const char* kernel, double result, double expected,
+                                double score_cutoff)
+{
+    /* results close to the cutoff may end up on either side due to rounding */
+    if (std::fabs(expected - score_cutoff) < 1e-9) {
+        if (result == 0 || std::fabs(result - expected) < 1e-9) return;
+    }
+    else if (std::fabs(result - ((expected >= score_cutoff) ? expected : 0.0)) < 1e-9) {
+        return;
+    }
+
+    std::fprintf(stderr, "%s: got %.17g, expected %.17g (score_cutoff %.17g)\n", kernel, result,
+                 expected, score_cutoff);
+    std::abort();
+}
@@ -0,0 +1,249 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+/*
+ * Standalone driver for the fuzz targets, which does not require libFuzzer.
+ *
+ *   replay_<target> [options] <file or directory>...
+ *
+ * By default every input is passed to LLVMFuzzerTestOneInput, which validates
+ * the optimized kernels against the reference implementation. This allows
+ * replaying crashes and corpora found by libFuzzer on any compiler.
+ *
+ * options:
+ *   -runs=N          performance mode: time N calls of the optimized kernels
+ *                    per input (JaroWinklerFuzzMeasure) and report the fastest
+ *                    of three repetitions
+ *   -save=FILE       store the timings of the performance mode
+ *   -baseline=FILE   compare the timings with a stored baseline and fail when
+ *                    the corpus got slower by more than the tolerance
+ *   -tolerance=X     allowed slowdown relative to the baseline (default 0.05)
+ *   -generate=N      write N random inputs into the directory instead
+ *   -seed=S          seed used by -generate (default 0)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+extern "C" void JaroWinklerFuzzMeasure(const uint8_t* data, size_t size);
+
+namespace fs = std::filesystem;
+
+struct Options {
+    long runs = 0;
+    std::string save;
+    std::string baseline;
+    double tolerance = 0.05;
+    long generate = 0;
+    unsigned seed = 0;
+    std::vector<std::string> paths;
+};
+
+static Options parse_options(int argc, char** argv)
+{
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* name) -> const char* {
+            size_t len = std::char_traits<char>::length(name);
+            return (arg.compare(0, len, name) == 0) ? arg.c_str() + len : nullptr;
+        };
+
+        if (const char* v = value("-runs="))
+            opts.runs = std::atol(v);
+        else if (const char* v = value("-save="))
+            opts.save = v;
+        else if (const char* v = value("-baseline="))
+            opts.baseline = v;
+        else if (const char* v = value("-tolerance="))
+            opts.tolerance = std::atof(v);
+        else if (const char* v = value("-generate="))
+            opts.generate = std::atol(v);
+        else if (const char* v = value("-seed="))
+            opts.seed = static_cast<unsigned>(std::atol(v));
+        else if (!arg.empty() && arg[0] == '-')
+            std::fprintf(stderr, "ignoring unknown option %s\n", arg.c_str());
+        else
+            opts.paths.push_back(arg);
+    }
+    return opts;
+}
+
+static std::vector<fs::path> collect_inputs(const std::vector<std::string>& paths)
+{
+    std::vector<fs::path> inputs;
+    for (const auto& path : paths) {
+        if (fs::is_directory(path)) {
+            for (const auto& entry : fs::recursive_directory_iterator(path)) {
+                if (entry.is_regular_file()) inputs.push_back(entry.path());
+            }
+        }
+        else {
+            inputs.emplace_back(path);
+        }
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return inputs;
+}
+
+static std::vector<uint8_t> read_file(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+}
+
+/**
+ * random inputs with a small alphabet, so the strings share plenty of
+ * characters, and lengths covering the word and block kernels
+ */
+static int generate_corpus(const Options& opts)
+{
+    if (opts.paths.size() != 1) {
+        std::fprintf(stderr, "-generate requires exactly one output directory\n");
+        return 1;
+    }
+
+    fs::create_directories(opts.paths[0]);
+    std::mt19937 gen(opts.seed);
+    std::uniform_int_distribution<int> len_dist(0, 600);
+    std::uniform_int_distribution<int> alphabet_dist(2, 30);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+
+    for (long i = 0; i < opts.generate; ++i) {
+        std::vector<uint8_t> data = {static_cast<uint8_t>(byte_dist(gen)),
+                                     static_cast<uint8_t>(byte_dist(gen) & 1)};
+        int len = len_dist(gen);
+        int split = std::uniform_int_distribution<int>(0, len)(gen);
+        data.push_back(static_cast<uint8_t>(split & 0xFF));
+        data.push_back(static_cast<uint8_t>(split >> 8));
+
+        std::uniform_int_distribution<int> char_dist('a', 'a' + alphabet_dist(gen));
+        for (int j = 0; j < len; ++j)
+            data.push_back(static_cast<uint8_t>(char_dist(gen)));
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "input-%06ld", i);
+        std::ofstream file(fs::path(opts.paths[0]) / name, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()),
+                   static_cast<std::streamsize>(data.size()));
+    }
+
+    std::printf("wrote %ld inputs to %s\n", opts.generate, opts.paths[0].c_str());
+    return 0;
+}
+
+static std::map<std::string, double> load_timings(const std::string& path)
+{
+    std::map<std::string, double> timings;
+    std::ifstream file(path);
+    double ns;
+    std::string name;
+    while (file >> ns && std::getline(file >> std::ws, name))
+        timings[name] = ns;
+    return timings;
+}
+
+static int measure_corpus(const Options& opts, const std::vector<fs::path>& inputs)
+{
+    std::vector<std::vector<uint8_t>> corpus;
+    for (const auto& path : inputs)
+        corpus.push_back(read_file(path));
+
+    /* warm up caches and the branch predictor */
+    for (const auto& data : corpus)
+        JaroWinklerFuzzMeasure(data.data(), data.size());
+
+    std::map<std::string, double> timings;
+    double total = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const std::vector<uint8_t>& data = corpus[i];
+
+        double best = 0;
+        for (int rep = 0; rep < 3; ++rep) {
+            auto start = std::chrono::steady_clock::now();
+            for (long run = 0; run < opts.runs; ++run)
+                JaroWinklerFuzzMeasure(data.data(), data.size());
+            auto end = std::chrono::steady_clock::now();
+
+            double ns = std::chrono::duration<double, std::nano>(end - start).count() /
+                        static_cast<double>(opts.runs);
+            best = (rep == 0) ? ns : std::min(best, ns);
+        }
+
+        timings[inputs[i].string()] = best;
+        total += best;
+    }
+
+    std::printf("%zu inputs, %.1f ns per corpus pass\n", inputs.size(), total);
+
+    if (!opts.save.empty()) {
+        std::ofstream file(opts.save);
+        for (const auto& timing : timings)
+            file << timing.second << ' ' << timing.first << '\n';
+    }
+
+    if (opts.baseline.empty()) return 0;
+
+    std::map<std::string, double> baseline = load_timings(opts.baseline);
+    double baseline_total = 0;
+    double current_total = 0;
+    std::vector<std::pair<double, std::string>> regressions;
+    for (const auto& timing : timings) {
+        auto it = baseline.find(timing.first);
+        if (it == baseline.end()) continue;
+
+        baseline_total += it->second;
+        current_total += timing.second;
+        if (timing.second > it->second * (1.0 + opts.tolerance))
+            regressions.emplace_back(timing.second / it->second, timing.first);
+    }
+
+    if (baseline_total <= 0) {
+        std::fprintf(stderr, "baseline %s shares no inputs with the corpus\n",
+                     opts.baseline.c_str());
+        return 1;
+    }
+
+    double ratio = current_total / baseline_total;
+    std::printf("%.1f ns -> %.1f ns (%+.1f%%) compared to the baseline\n", baseline_total,
+                current_total, (ratio - 1.0) * 100.0);
+
+    if (ratio <= 1.0 + opts.tolerance) return 0;
+
+    /* single inputs are noisy, so they are only listed to locate a regression of the corpus */
+    std::fprintf(stderr, "corpus got slower by more than %.1f%%\n", opts.tolerance * 100.0);
+    std::sort(regressions.rbegin(), regressions.rend());
+    for (size_t i = 0; i < std::min<size_t>(regressions.size(), 10); ++i)
+        std::fprintf(stderr, "  %.2fx slower: %s\n", regressions[i].first,
+                     regressions[i].second.c_str());
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    Options opts = parse_options(argc, argv);
+    if (opts.generate > 0) return generate_corpus(opts);
+
+    std::vector<fs::path> inputs = collect_inputs(opts.paths);
+    if (opts.runs > 0) return measure_corpus(opts, inputs);
+
+    for (const auto& path : inputs) {
+        std::vector<uint8_t> data = read_file(path);
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+    std::printf("replayed %zu inputs\n", inputs.size());
+    return 0;
+}
@@ -0,0 +1,378 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/jaro_winkler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jaro_winkler {
+
+/**
+ * @defgroup concurrent_index concurrent_index
+ * Pattern index supporting inserts and removals while it is queried
+ * @{
+ */
+
+namespace detail {
+
+template <typename CharT1>
+struct ConcurrentIndexEntry {
+    template <typename InputIt>
+    ConcurrentIndexEntry(InputIt first, InputIt last) : pattern(first, last), PM(first, last)
+    {}
+
+    std::basic_string<CharT1> pattern;
+    common::BlockPatternMatchVector PM;
+};
+
+/**
+ * state of a thread reading the index. Records are never freed before the
+ * index is destroyed, so readers can reuse them without synchronization.
+ */
+struct EpochReaderRecord {
+    /* epoch the reader entered, 0 when the reader is inactive */
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> in_use{false};
+    EpochReaderRecord* next = nullptr;
+};
+
+} // namespace detail
+
+/**
+ * @brief append mostly index of patterns, which can be queried while
+ * patterns are inserted or removed
+ *
+ * Readers never take a lock: they enter an epoch using reader() and score
+ * against the patterns visible at that time. Writers are serialized using a
+ * mutex. Entries are immutable once inserted. Removing an entry replaces it
+ * with a tombstone and its pattern match vector is only freed, once no
+ * reader, which could still observe it, is active (epoch based reclamation).
+ *
+ * Handles are assigned in insertion order and are never reused. All
+ * ReadGuard objects have to be destroyed before the index.
+ *
+ * @tparam CharT1 character type of the stored strings
+ */
+template <typename CharT1>
+class ConcurrentPatternIndex {
+    using Entry = detail::ConcurrentIndexEntry<CharT1>;
+
+    /* segment s stores segment_base << s entries, so the storage never has to move */
+    static constexpr size_t segment_base = 64;
+    static constexpr size_t max_segments = 48;
+
+public:
+    using handle_type = size_t;
+
+    /**
+     * @brief RAII guard keeping the entries observed by a reader alive.
+     * A guard should only be held for the duration of a query, since it
+     * delays the reclamation of removed entries.
+     */
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentPatternIndex& index)
+            : m_index(&index), m_record(index.acquire_record())
+        {
+            m_record->epoch.store(index.m_epoch.load(std::memory_order_seq_cst),
+                                  std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_size = index.m_size.load(std::memory_order_acquire);
+        }
+
+        ReadGuard(ReadGuard&& other) noexcept
+            : m_index(other.m_index), m_record(other.m_record), m_size(other.m_size)
+        {
+            other.m_record = nullptr;
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ReadGuard& operator=(ReadGuard&&) = delete;
+
+        ~ReadGuard()
+        {
+            if (!m_record) return;
+            m_record->epoch.store(0, std::memory_order_release);
+            m_record->in_use.store(false, std::memory_order_release);
+        }
+
+        /**
+         * @brief number of handles visible to this reader, including removed ones
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        bool contains(handle_type handle) const
+        {
+            return entry(handle) != nullptr;
+        }
+
+        /**
+         * @brief pattern stored for handle, or an empty string if it was removed
+         */
+        std::basic_string<CharT1> pattern(handle_type handle) const
+        {
+            const Entry* e = entry(handle);
+            return e ? e->pattern : std::basic_string<CharT1>();
+        }
+
+        template <typename Policy = DefaultJaroPolicy, typename InputIt2>
+        typename std::enable_if<common::is_iterator<InputIt2>::value, double>::type
+        jaro_similarity(handle_type handle, InputIt2 first2, InputIt2 last2,
+                        double score_cutoff = 0) const
+        {
+            const Entry* e = entry(handle);
+            if (!e) return 0;
+
+            return detail::jaro_similarity<Policy>(e->PM, std::begin(e->pattern),
+                                                   std::end(e->pattern), first2, last2,
+                                                   score_cutoff);
+        }
+
+        template <typename Policy = DefaultJaroPolicy, typename S2>
+        double jaro_similarity(handle_type handle, const S2& s2, double score_cutoff = 0) const
+        {
+            return jaro_similarity<Policy>(handle, std::begin(s2), std::end(s2), score_cutoff);
+        }
+
+        template <typename Policy = DefaultJaroPolicy, typename InputIt2>
+        typename std::enable_if<common::is_iterator<InputIt2>::value, double>::type
+        jaro_winkler_similarity(handle_type handle, InputIt2 first2, InputIt2 last2,
+                                double prefix_weight = 0.1, double score_cutoff = 0) const
+        {
+            detail::validate_prefix_weight<Policy>(prefix_weight);
+            const Entry* e = entry(handle);
+            if (!e) return 0;
+
+            return detail::jaro_winkler_similarity<Policy>(e->PM, std::begin(e->pattern),
+                                                           std::end(e->pattern), first2, last2,
+                                                           prefix_weight, score_cutoff);
+        }
+
+        template <typename Policy = DefaultJaroPolicy, typename S2>
+        double jaro_winkler_similarity(handle_type handle, const S2& s2,
+                                       double prefix_weight = 0.1, double score_cutoff = 0) const
+        {
+            return jaro_winkler_similarity<Policy>(handle, std::begin(s2), std::end(s2),
+                                                   prefix_weight, score_cutoff);
+        }
+
+    private:
+        const Entry* entry(handle_type handle) const
+        {
+            if (handle >= m_size) return nullptr;
+            return m_index->slot(handle).load(std::memory_order_acquire);
+        }
+
+        const ConcurrentPatternIndex* m_index;
+        detail::EpochReaderRecord* m_record;
+        size_t m_size;
+    };
+
+    ConcurrentPatternIndex() : m_size(0), m_epoch(1), m_readers(nullptr)
+    {
+        for (auto& segment : m_segments) {
+            segment.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentPatternIndex(const ConcurrentPatternIndex&) = delete;
+    ConcurrentPatternIndex& operator=(const ConcurrentPatternIndex&) = delete;
+
+    ~ConcurrentPatternIndex()
+    {
+        size_t size = m_size.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < size; ++i) {
+            delete slot(i).load(std::memory_order_relaxed);
+        }
+        for (auto& retired : m_retired) {
+            delete retired.second;
+        }
+        for (auto& segment : m_segments) {
+            delete[] segment.load(std::memory_order_relaxed);
+        }
+
+        detail::EpochReaderRecord* record = m_readers.load(std::memory_order_relaxed);
+        while (record) {
+            detail::EpochReaderRecord* next = record->next;
+            delete record;
+            record = next;
+        }
+    }
+
+    /**
+     * @brief enter a read epoch. This never blocks.
+     */
+    ReadGuard reader() const
+    {
+        return ReadGuard(*this);
+    }
+
+    /**
+     * @brief number of handles assigned so far, including removed entries
+     */
+    size_t size() const
+    {
+        return m_size.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief insert a new pattern. The pattern match vector is built before
+     * the writer lock is taken.
+     *
+     * @return handle of the new entry
+     */
+    template <typename InputIt1>
+    handle_type insert(InputIt1 first1, InputIt1 last1)
+    {
+        Entry* e = new Entry(first1, last1);
+
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        size_t handle = m_size.load(std::memory_order_relaxed);
+        size_t segment = segment_index(handle);
+        if (segment >= max_segments) {
+            delete e;
+            throw std::length_error("ConcurrentPatternIndex is full");
+        }
+
+        if (!m_segments[segment].load(std::memory_order_relaxed)) {
+            auto* slots = new std::atomic<const Entry*>[segment_base << segment];
+            for (size_t i = 0; i < (segment_base << segment); ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+            m_segments[segment].store(slots, std::memory_order_release);
+        }
+
+        slot(handle).store(e, std::memory_order_release);
+        m_size.store(handle + 1, std::memory_order_release);
+        return handle;
+    }
+
+    template <typename S1>
+    handle_type insert(const S1& s1)
+    {
+        return insert(std::begin(s1), std::end(s1));
+    }
+
+    /**
+     * @brief replace the entry with a tombstone. Its memory is freed once
+     * all readers, which could still observe it, left their epoch.
+     *
+     * @return false when the handle does not exist or was already removed
+     */
+    bool erase(handle_type handle)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        if (handle >= m_size.load(std::memory_order_relaxed)) return false;
+
+        const Entry* e = slot(handle).exchange(nullptr, std::memory_order_seq_cst);
+        if (!e) return false;
+
+        /* readers entering after this increment can not observe the entry anymore */
+        uint64_t epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        m_retired.emplace_back(epoch, e);
+        collect_locked();
+        return true;
+    }
+
+    /**
+     * @brief free removed entries, which are no longer observable by any reader
+     */
+    void collect()
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        collect_locked();
+    }
+
+    /**
+     * @brief number of removed entries, which are not freed yet
+     */
+    size_t retired_count() const
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        return m_retired.size();
+    }
+
+private:
+    static size_t segment_index(size_t handle)
+    {
+        size_t v = handle / segment_base + 1;
+        size_t segment = 0;
+        while (v >>= 1) segment++;
+        return segment;
+    }
+
+    std::atomic<const Entry*>& slot(size_t handle) const
+    {
+        size_t segment = segment_index(handle);
+        size_t offset = handle - segment_base * ((size_t(1) << segment) - 1);
+        return m_segments[segment].load(std::memory_order_acquire)[offset];
+    }
+
+    detail::EpochReaderRecord* acquire_record() const
+    {
+        detail::EpochReaderRecord* record = m_readers.load(std::memory_order_acquire);
+        for (; record; record = record->next) {
+            bool expected = false;
+            if (!record->in_use.load(std::memory_order_relaxed) &&
+                record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return record;
+            }
+        }
+
+        record = new detail::EpochReaderRecord();
+        record->in_use.store(true, std::memory_order_relaxed);
+        record->next = m_readers.load(std::memory_order_relaxed);
+        while (!m_readers.compare_exchange_weak(record->next, record, std::memory_order_release,
+                                                std::memory_order_relaxed))
+        {}
+        return record;
+    }
+
+    void collect_locked()
+    {
+        if (m_retired.empty()) return;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t min_epoch = m_epoch.load(std::memory_order_seq_cst);
+        for (auto* record = m_readers.load(std::memory_order_acquire); record;
+             record = record->next)
+        {
+            uint64_t epoch = record->epoch.load(std::memory_order_seq_cst);
+            if (epoch) min_epoch = std::min(min_epoch, epoch);
+        }
+
+        /* entries retired in epoch e are only observable by readers which entered in epoch <= e */
+        auto it = std::remove_if(m_retired.begin(), m_retired.end(),
+                                 [min_epoch](const std::pair<uint64_t, const Entry*>& retired) {
+                                     if (retired.first >= min_epoch) return false;
+                                     delete retired.second;
+                                     return true;
+                                 });
+        m_retired.erase(it, m_retired.end());
+    }
+
+    mutable std::atomic<std::atomic<const Entry*>*> m_segments[max_segments];
+    std::atomic<size_t> m_size;
+    std::atomic<uint64_t> m_epoch;
+    mutable std::atomic<detail::EpochReaderRecord*> m_readers;
+
+    mutable std::mutex m_write_mutex;
+    std::vector<std::pair<uint64_t, const Entry*>> m_retired;
+};
+
+/**@}*/
+
+} // namespace jaro_winkler
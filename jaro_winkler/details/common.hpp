@@ -61,23 +61,33 @@ int64_t remove_common_prefix(InputIt1& first1, InputIt1 last1, InputIt2& first2,
     return prefix;
 }
 
-struct BitvectorHashmap {
+/**
+ * number of bits in the word type used by the bit-parallel kernels
+ */
+template <typename Word>
+struct word_bits : std::integral_constant<int64_t, static_cast<int64_t>(sizeof(Word) * 8)> {
+    static_assert(std::is_same<Word, uint32_t>::value || std::is_same<Word, uint64_t>::value,
+                  "only 32 and 64 bit words are supported");
+};
+
+template <typename Word>
+struct BasicBitvectorHashmap {
     struct MapElem {
         uint64_t key = 0;
-        uint64_t value = 0;
+        Word value = 0;
     };
 
-    BitvectorHashmap() : m_map()
+    BasicBitvectorHashmap() : m_map()
     {}
 
     template <typename CharT>
     void insert(CharT key, int64_t pos)
     {
-        insert_mask(key, 1ull << pos);
+        insert_mask(key, static_cast<Word>(1) << pos);
     }
 
     template <typename CharT>
-    void insert_mask(CharT key, uint64_t mask)
+    void insert_mask(CharT key, Word mask)
     {
         uint64_t i = lookup(static_cast<uint64_t>(key));
         m_map[i].key = key;
@@ -85,11 +95,23 @@ struct BitvectorHashmap {
     }
 
     template <typename CharT>
-    uint64_t get(CharT key) const
+    Word get(CharT key) const
     {
         return m_map[lookup(static_cast<uint64_t>(key))].value;
     }
 
+    /**
+     * @brief true when at least one slot is unused. Lookups of keys not
+     * stored in the map only terminate once they reach an unused slot
+     */
+    bool has_free_slot() const
+    {
+        for (const auto& elem : m_map) {
+            if (!elem.value) return true;
+        }
+        return false;
+    }
+
 private:
     /**
      * lookup key inside the hashmap using a similar collision resolution
@@ -117,17 +139,21 @@ private:
     std::array<MapElem, 128> m_map;
 };
 
-struct PatternMatchVector {
-    struct MapElem {
-        uint64_t key = 0;
-        uint64_t value = 0;
-    };
+using BitvectorHashmap = BasicBitvectorHashmap<uint64_t>;
+
+/**
+ * @tparam Word word type of the bitvectors. A pattern can have at most
+ * word_bits<Word> characters
+ */
+template <typename Word>
+struct BasicPatternMatchVector {
+    using word_type = Word;
 
-    PatternMatchVector() : m_map(), m_extendedAscii()
+    BasicPatternMatchVector() : m_map(), m_extendedAscii()
     {}
 
     template <typename InputIt1>
-    PatternMatchVector(InputIt1 first, InputIt1 last) : m_map(), m_extendedAscii()
+    BasicPatternMatchVector(InputIt1 first, InputIt1 last) : m_map(), m_extendedAscii()
     {
         insert(first, last);
     }
@@ -135,7 +161,7 @@ struct PatternMatchVector {
     template <typename InputIt1>
     void insert(InputIt1 first, InputIt1 last)
     {
-        uint64_t mask = 1;
+        Word mask = 1;
         for (int64_t i = 0; i < std::distance(first, last); ++i) {
             auto key = first[i];
             if (key >= 0 && key <= 255) {
@@ -151,7 +177,7 @@ struct PatternMatchVector {
     template <typename CharT>
     void insert(CharT key, int64_t pos)
     {
-        uint64_t mask = 1ull << pos;
+        Word mask = static_cast<Word>(1) << pos;
         if (key >= 0 && key <= 255) {
             m_extendedAscii[key] |= mask;
         }
@@ -160,8 +186,33 @@ struct PatternMatchVector {
         }
     }
 
+    /**
+     * @brief reset the entries set by insert(first, last), so the vector can
+     * be reused for another pattern. This only touches the characters of the
+     * pattern instead of zeroing the whole vector.
+     */
+    template <typename InputIt1>
+    void remove(InputIt1 first, InputIt1 last)
+    {
+        bool uses_map = false;
+        for (; first != last; ++first) {
+            auto key = *first;
+            if (key >= 0 && key <= 255) {
+                m_extendedAscii[key] = 0;
+            }
+            else {
+                uses_map = true;
+            }
+        }
+
+        /* removing single keys would break the probe sequences of the hashmap */
+        if (uses_map) {
+            m_map = BasicBitvectorHashmap<Word>();
+        }
+    }
+
     template <typename CharT>
-    uint64_t get(CharT key) const
+    Word get(CharT key) const
     {
         if (key >= 0 && key <= 255) {
             return m_extendedAscii[key];
@@ -175,7 +226,7 @@ struct PatternMatchVector {
      * combat func for BlockPatternMatchVector
      */
     template <typename CharT>
-    uint64_t get(int64_t block, CharT key) const
+    Word get(int64_t block, CharT key) const
     {
         (void)block;
         assert(block == 0);
@@ -183,16 +234,25 @@ struct PatternMatchVector {
     }
 
 private:
-    BitvectorHashmap m_map;
-    std::array<uint64_t, 256> m_extendedAscii;
+    BasicBitvectorHashmap<Word> m_map;
+    std::array<Word, 256> m_extendedAscii;
 };
 
-struct BlockPatternMatchVector {
-    BlockPatternMatchVector() : m_block_count(0)
+using PatternMatchVector = BasicPatternMatchVector<uint64_t>;
+
+/**
+ * @tparam Word word type of the bitvectors. Patterns are split into blocks
+ * of word_bits<Word> characters
+ */
+template <typename Word>
+struct BasicBlockPatternMatchVector {
+    using word_type = Word;
+
+    BasicBlockPatternMatchVector() : m_block_count(0)
     {}
 
     template <typename InputIt1>
-    BlockPatternMatchVector(InputIt1 first, InputIt1 last) : m_block_count(0)
+    BasicBlockPatternMatchVector(InputIt1 first, InputIt1 last) : m_block_count(0)
     {
         insert(first, last);
     }
@@ -200,7 +260,7 @@ struct BlockPatternMatchVector {
     template <typename CharT>
     void insert(int64_t block, CharT key, int pos)
     {
-        uint64_t mask = 1ull << pos;
+        Word mask = static_cast<Word>(1) << pos;
 
         assert(block < m_block_count);
         if (key >= 0 && key <= 255) {
@@ -214,21 +274,223 @@ struct BlockPatternMatchVector {
     template <typename InputIt1>
     void insert(InputIt1 first, InputIt1 last)
     {
+        const int64_t bits = word_bits<Word>::value;
         int64_t len = std::distance(first, last);
-        m_block_count = ceildiv(len, 64);
+        m_block_count = ceildiv(len, bits);
         m_map.resize(m_block_count);
         m_extendedAscii.resize(m_block_count * 256);
 
         for (int64_t i = 0; i < len; ++i) {
-            int64_t block = i / 64;
-            int64_t pos = i % 64;
-            insert(block, first[i], pos);
+            int64_t block = i / bits;
+            int64_t pos = i % bits;
+            insert(block, first[i], static_cast<int>(pos));
+        }
+    }
+
+    /**
+     * combat func for PatternMatchVector
+     */
+    template <typename CharT>
+    Word get(CharT key) const
+    {
+        return get(0, key);
+    }
+
+    template <typename CharT>
+    Word get(int64_t block, CharT key) const
+    {
+        assert(block < m_block_count);
+        if (key >= 0 && key <= 255) {
+            return m_extendedAscii[key * m_block_count + block];
+        }
+        else {
+            return m_map[block].get(key);
+        }
+    }
+
+    /**
+     * bitvectors of the extended ascii characters. The bitvector of block
+     * `block` for character `key` is stored at `key * block_count() + block`
+     */
+    const Word* extended_ascii() const
+    {
+        return m_extendedAscii.data();
+    }
+
+    int64_t block_count() const
+    {
+        return m_block_count;
+    }
+
+private:
+    std::vector<BasicBitvectorHashmap<Word>> m_map;
+    std::vector<Word> m_extendedAscii;
+    int64_t m_block_count;
+};
+
+using BlockPatternMatchVector = BasicBlockPatternMatchVector<uint64_t>;
+
+/**
+ * bitvectors of all blocks of a pattern for a single character. This is
+ * used by the block kernels, so the character is only looked up once.
+ */
+template <typename PM_Vec, typename CharT>
+struct PatternMatchRow {
+    const PM_Vec& PM;
+    CharT key;
+
+    typename PM_Vec::word_type get(int64_t block) const
+    {
+        return PM.get(block, key);
+    }
+};
+
+template <typename PM_Vec, typename CharT>
+PatternMatchRow<PM_Vec, CharT> pattern_match_row(const PM_Vec& PM, CharT key)
+{
+    return {PM, key};
+}
+
+/**
+ * @brief pattern match vector for sequences over large alphabets like 32 or
+ * 64 bit token ids
+ *
+ * BasicBlockPatternMatchVector keeps a 128 slot hashmap per block for keys
+ * outside of the extended ascii range, which is probed once per block and
+ * text character. Here a single open addressing table sized to the pattern
+ * maps every distinct key to a row with the bitvectors of all blocks. A key
+ * is looked up once per text character and the memory only grows with the
+ * number of distinct keys.
+ *
+ * @tparam Word word type of the bitvectors
+ */
+template <typename Word>
+struct BasicSequencePatternMatchVector {
+    using word_type = Word;
+
+    struct Row {
+        const Word* words;
+
+        Word get(int64_t block) const
+        {
+            return words[block];
+        }
+    };
+
+    BasicSequencePatternMatchVector() : m_block_count(0), m_shift(63), m_slots(2)
+    {}
+
+    template <typename InputIt1>
+    BasicSequencePatternMatchVector(InputIt1 first, InputIt1 last)
+        : BasicSequencePatternMatchVector()
+    {
+        insert(first, last);
+    }
+
+    template <typename InputIt1>
+    void insert(InputIt1 first, InputIt1 last)
+    {
+        const int64_t bits = word_bits<Word>::value;
+        int64_t len = std::distance(first, last);
+        m_block_count = ceildiv(len, bits);
+
+        /* at most half of the slots are used, so the probe sequences stay short */
+        int shift_bits = 1;
+        while ((int64_t(1) << shift_bits) < 2 * len) ++shift_bits;
+        m_shift = 64 - shift_bits;
+        m_slots.assign(size_t(1) << shift_bits, Slot());
+
+        /* row 0 is the empty row of keys not part of the pattern */
+        m_rows.assign(static_cast<size_t>(m_block_count), 0);
+        for (int64_t i = 0; first != last; ++first, ++i) {
+            uint64_t key = static_cast<uint64_t>(*first);
+            Slot& slot = m_slots[lookup(key)];
+            if (!slot.row) {
+                slot.key = key;
+                slot.row = m_rows.size() / static_cast<size_t>(m_block_count);
+                m_rows.resize(m_rows.size() + static_cast<size_t>(m_block_count), 0);
+            }
+
+            m_rows[slot.row * static_cast<size_t>(m_block_count) + static_cast<size_t>(i / bits)] |=
+                static_cast<Word>(1) << (i % bits);
         }
     }
 
+    template <typename CharT>
+    Row row(CharT key) const
+    {
+        size_t row = m_slots[lookup(static_cast<uint64_t>(key))].row;
+        return {m_rows.data() + row * static_cast<size_t>(m_block_count)};
+    }
+
     /**
      * combat func for PatternMatchVector
      */
+    template <typename CharT>
+    Word get(CharT key) const
+    {
+        return get(0, key);
+    }
+
+    template <typename CharT>
+    Word get(int64_t block, CharT key) const
+    {
+        assert(block < m_block_count);
+        return row(key).get(block);
+    }
+
+    int64_t block_count() const
+    {
+        return m_block_count;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        /* 0 for empty slots */
+        size_t row = 0;
+    };
+
+    /* linear probing using a multiplicative hash, so sequential ids and ids
+     * sharing their low bits are spread over the table */
+    size_t lookup(uint64_t key) const
+    {
+        size_t mask = m_slots.size() - 1;
+        size_t i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> m_shift) & mask;
+        while (m_slots[i].row && m_slots[i].key != key) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    int64_t m_block_count;
+    int m_shift;
+    std::vector<Slot> m_slots;
+    std::vector<Word> m_rows;
+};
+
+template <typename Word, typename CharT>
+typename BasicSequencePatternMatchVector<Word>::Row
+pattern_match_row(const BasicSequencePatternMatchVector<Word>& PM, CharT key)
+{
+    return PM.row(key);
+}
+
+using SequencePatternMatchVector = BasicSequencePatternMatchVector<uint64_t>;
+
+/**
+ * Non owning view on the pattern match vector of a single pattern stored
+ * inside a BlockPatternMatchVectorSlab. It provides the same lookup interface
+ * as BlockPatternMatchVector.
+ */
+struct BlockPatternMatchVectorView {
+    using word_type = uint64_t;
+
+    BlockPatternMatchVectorView(const uint64_t* extendedAscii, const BitvectorHashmap* map,
+                                int64_t block_count)
+        : m_extendedAscii(extendedAscii), m_map(map), m_block_count(block_count)
+    {}
+
     template <typename CharT>
     uint64_t get(CharT key) const
     {
@@ -242,17 +504,142 @@ struct BlockPatternMatchVector {
         if (key >= 0 && key <= 255) {
             return m_extendedAscii[key * m_block_count + block];
         }
-        else {
+        else if (m_map) {
             return m_map[block].get(key);
         }
+        return 0;
+    }
+
+    const uint64_t* extended_ascii() const
+    {
+        return m_extendedAscii;
+    }
+
+    int64_t block_count() const
+    {
+        return m_block_count;
     }
 
 private:
-    std::vector<BitvectorHashmap> m_map;
-    std::vector<uint64_t> m_extendedAscii;
+    const uint64_t* m_extendedAscii;
+    const BitvectorHashmap* m_map;
     int64_t m_block_count;
 };
 
+/**
+ * Pattern match vectors of a whole collection of patterns stored in a
+ * single contiguous slab. The bitvectors of all patterns are placed back to
+ * back in one array and the hashmaps for characters outside of the extended
+ * ascii range are only allocated for patterns, which actually contain such
+ * characters.
+ *
+ * The slab is built in two steps: allocate() sizes the storage for all
+ * patterns, after which insert() can be called for each pattern. Calls to
+ * insert() for different patterns do not share any memory and can be
+ * performed concurrently.
+ */
+struct BlockPatternMatchVectorSlab {
+    BlockPatternMatchVectorSlab()
+    {}
+
+    /**
+     * @param block_counts number of 64 bit blocks required by each pattern
+     * @param needs_map whether each pattern includes characters > 255
+     */
+    void allocate(const std::vector<int64_t>& block_counts, const std::vector<bool>& needs_map)
+    {
+        assert(block_counts.size() == needs_map.size());
+        size_t count = block_counts.size();
+        m_block_offset.assign(count + 1, 0);
+        m_map_offset.assign(count, -1);
+
+        int64_t map_count = 0;
+        for (size_t i = 0; i < count; ++i) {
+            m_block_offset[i + 1] = m_block_offset[i] + block_counts[i];
+            if (needs_map[i]) {
+                m_map_offset[i] = map_count;
+                map_count += block_counts[i];
+            }
+        }
+
+        m_extendedAscii.assign(static_cast<size_t>(m_block_offset[count]) * 256, 0);
+        m_map.assign(static_cast<size_t>(map_count), BitvectorHashmap());
+    }
+
+    template <typename InputIt1>
+    void insert(size_t idx, InputIt1 first, InputIt1 last)
+    {
+        int64_t len = std::distance(first, last);
+        int64_t block_count = this->block_count(idx);
+        assert(ceildiv(len, 64) == block_count);
+        uint64_t* extendedAscii = &m_extendedAscii[static_cast<size_t>(m_block_offset[idx]) * 256];
+        BitvectorHashmap* map = (m_map_offset[idx] < 0) ? nullptr : &m_map[m_map_offset[idx]];
+
+        for (int64_t i = 0; i < len; ++i) {
+            int64_t block = i / 64;
+            uint64_t mask = 1ull << (i % 64);
+            auto key = first[i];
+            if (key >= 0 && key <= 255) {
+                extendedAscii[key * block_count + block] |= mask;
+            }
+            else {
+                assert(map != nullptr);
+                map[block].insert_mask(key, mask);
+            }
+        }
+    }
+
+    BlockPatternMatchVectorView view(size_t idx) const
+    {
+        const BitvectorHashmap* map =
+            (m_map_offset[idx] < 0) ? nullptr : &m_map[m_map_offset[idx]];
+        return BlockPatternMatchVectorView(
+            m_extendedAscii.data() + static_cast<size_t>(m_block_offset[idx]) * 256, map,
+            block_count(idx));
+    }
+
+    int64_t block_count(size_t idx) const
+    {
+        return m_block_offset[idx + 1] - m_block_offset[idx];
+    }
+
+    size_t size() const
+    {
+        return m_map_offset.size();
+    }
+
+    /**
+     * raw storage of the slab. Pattern idx uses the blocks
+     * [block_offsets()[idx], block_offsets()[idx + 1]) and, when
+     * map_offsets()[idx] >= 0, the hashmaps starting at map_offsets()[idx]
+     */
+    const std::vector<int64_t>& block_offsets() const
+    {
+        return m_block_offset;
+    }
+
+    const std::vector<int64_t>& map_offsets() const
+    {
+        return m_map_offset;
+    }
+
+    const std::vector<uint64_t>& extended_ascii() const
+    {
+        return m_extendedAscii;
+    }
+
+    const std::vector<BitvectorHashmap>& maps() const
+    {
+        return m_map;
+    }
+
+private:
+    std::vector<int64_t> m_block_offset;
+    std::vector<int64_t> m_map_offset;
+    std::vector<uint64_t> m_extendedAscii;
+    std::vector<BitvectorHashmap> m_map;
+};
+
 /**@}*/
 
 } // namespace common
@@ -0,0 +1,268 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/common.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace jaro_winkler {
+namespace detail {
+
+/* FNV-1a over the character values */
+template <typename InputIt>
+uint64_t hash_chars(InputIt first, InputIt last)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (; first != last; ++first) {
+        hash ^= static_cast<uint64_t>(*first);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/* compares the character values, so strings of different character types can be compared */
+template <typename InputIt1, typename InputIt2>
+bool equal_chars(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2)
+{
+    if (std::distance(first1, last1) != std::distance(first2, last2)) return false;
+
+    for (; first1 != last1; ++first1, ++first2) {
+        if (static_cast<uint64_t>(*first1) != static_cast<uint64_t>(*first2)) return false;
+    }
+    return true;
+}
+
+/**
+ * random access iterator over the elements of a sequence at a list of positions
+ */
+template <typename It>
+class IndexedIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = typename std::iterator_traits<It>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::iterator_traits<It>::pointer;
+    using reference = typename std::iterator_traits<It>::reference;
+
+    IndexedIterator(It base, const int64_t* pos) : m_base(base), m_pos(pos)
+    {}
+
+    reference operator*() const
+    {
+        return m_base[static_cast<difference_type>(*m_pos)];
+    }
+
+    reference operator[](difference_type n) const
+    {
+        return m_base[static_cast<difference_type>(m_pos[n])];
+    }
+
+    IndexedIterator& operator++()
+    {
+        ++m_pos;
+        return *this;
+    }
+
+    IndexedIterator& operator+=(difference_type n)
+    {
+        m_pos += n;
+        return *this;
+    }
+
+    IndexedIterator operator+(difference_type n) const
+    {
+        return IndexedIterator(m_base, m_pos + n);
+    }
+
+    difference_type operator-(const IndexedIterator& other) const
+    {
+        return m_pos - other.m_pos;
+    }
+
+    bool operator==(const IndexedIterator& other) const
+    {
+        return m_pos == other.m_pos;
+    }
+
+    bool operator!=(const IndexedIterator& other) const
+    {
+        return m_pos != other.m_pos;
+    }
+
+private:
+    It m_base;
+    const int64_t* m_pos;
+};
+
+/**
+ * set of the distinct sentences of a random access sequence, which only
+ * stores their positions and hashes in an open addressing hash table
+ *
+ * At most max_unique distinct sentences are added to the table, which bounds
+ * the memory usage for inputs with a large number of distinct sentences.
+ */
+template <typename It>
+class SentenceDedup {
+public:
+    using value_type = typename std::iterator_traits<It>::value_type;
+    using const_iterator = IndexedIterator<It>;
+
+    explicit SentenceDedup(It first, size_t max_unique = size_t(1) << 20)
+        : m_first(first), m_max_unique(max_unique), m_table_size(0)
+    {}
+
+    /**
+     * @brief id of the distinct sentence equal to the sentence at pos.
+     * A new sentence is added with the next id, unless the table already
+     * holds max_unique sentences, in which case -1 is returned.
+     */
+    int64_t insert(int64_t pos)
+    {
+        const auto& s = m_first[static_cast<ptrdiff_t>(pos)];
+        uint64_t hash = hash_chars(std::begin(s), std::end(s));
+        size_t slot = find_slot(std::begin(s), std::end(s), hash);
+        if (!m_slots.empty() && m_slots[slot] >= 0) return m_slots[slot];
+        if (m_table_size >= m_max_unique) return -1;
+
+        if ((m_table_size + 1) * 2 > m_slots.size()) {
+            grow();
+            slot = find_slot(std::begin(s), std::end(s), hash);
+        }
+
+        int64_t id = append(pos);
+        m_hashes.push_back(hash);
+        m_slots[slot] = id;
+        m_table_size++;
+        return id;
+    }
+
+    /**
+     * @brief add the sentence at pos with a new id without adding it to the
+     * table. Used for sentences, which no longer fit into the table.
+     */
+    int64_t append(int64_t pos)
+    {
+        m_positions.push_back(pos);
+        return static_cast<int64_t>(m_positions.size()) - 1;
+    }
+
+    /**
+     * @brief id of the distinct sentence equal to [first, last) or -1
+     */
+    template <typename InputIt>
+    int64_t find(InputIt first, InputIt last) const
+    {
+        if (m_slots.empty()) return -1;
+        return m_slots[find_slot(first, last, hash_chars(first, last))];
+    }
+
+    size_t size() const
+    {
+        return m_positions.size();
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(m_first, m_positions.data());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(m_first, m_positions.data() + m_positions.size());
+    }
+
+private:
+    /* slot holding the sentence or the empty slot it would be inserted into */
+    template <typename InputIt>
+    size_t find_slot(InputIt first, InputIt last, uint64_t hash) const
+    {
+        if (m_slots.empty()) return 0;
+
+        size_t mask = m_slots.size() - 1;
+        for (size_t slot = static_cast<size_t>(hash) & mask;; slot = (slot + 1) & mask) {
+            int64_t id = m_slots[slot];
+            if (id < 0) return slot;
+            if (m_hashes[static_cast<size_t>(id)] != hash) continue;
+
+            const auto& s = m_first[static_cast<ptrdiff_t>(m_positions[static_cast<size_t>(id)])];
+            if (equal_chars(first, last, std::begin(s), std::end(s))) return slot;
+        }
+    }
+
+    void grow()
+    {
+        std::vector<int64_t> slots(std::max<size_t>(m_slots.size() * 2, 64), -1);
+        size_t mask = slots.size() - 1;
+        /* sentences are only appended outside the table once it is full, so
+         * the first m_table_size ids are the ones in the table */
+        for (size_t id = 0; id < m_table_size; ++id) {
+            size_t slot = static_cast<size_t>(m_hashes[id]) & mask;
+            while (slots[slot] >= 0) slot = (slot + 1) & mask;
+            slots[slot] = static_cast<int64_t>(id);
+        }
+        m_slots.swap(slots);
+    }
+
+    It m_first;
+    size_t m_max_unique;
+    size_t m_table_size;
+    std::vector<int64_t> m_slots;
+    std::vector<uint64_t> m_hashes;
+    /* position of the first occurrence of every distinct sentence */
+    std::vector<int64_t> m_positions;
+};
+
+/**
+ * @brief distinct sentences of [first, last) together with the positions of
+ * all occurrences of each of them
+ */
+template <typename It>
+struct DedupSentences {
+    DedupSentences(It first, It last) : unique(first)
+    {
+        int64_t len = static_cast<int64_t>(std::distance(first, last));
+        std::vector<int64_t> ids(static_cast<size_t>(len));
+        for (int64_t pos = 0; pos < len; ++pos) {
+            int64_t id = unique.insert(pos);
+            ids[static_cast<size_t>(pos)] = (id >= 0) ? id : unique.append(pos);
+        }
+
+        /* group the positions by id */
+        offsets.assign(unique.size() + 1, 0);
+        for (int64_t id : ids) {
+            offsets[static_cast<size_t>(id) + 1]++;
+        }
+        for (size_t id = 0; id < unique.size(); ++id) {
+            offsets[id + 1] += offsets[id];
+        }
+
+        positions.resize(ids.size());
+        std::vector<int64_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t pos = 0; pos < ids.size(); ++pos) {
+            positions[static_cast<size_t>(fill[static_cast<size_t>(ids[pos])]++)] =
+                static_cast<int64_t>(pos);
+        }
+    }
+
+    const int64_t* occurrences_begin(size_t id) const
+    {
+        return positions.data() + offsets[id];
+    }
+
+    const int64_t* occurrences_end(size_t id) const
+    {
+        return positions.data() + offsets[id + 1];
+    }
+
+    SentenceDedup<It> unique;
+    std::vector<int64_t> offsets;
+    std::vector<int64_t> positions;
+};
+
+} // namespace detail
+} // namespace jaro_winkler
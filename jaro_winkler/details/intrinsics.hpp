@@ -9,6 +9,36 @@
 #    include <intrin.h>
 #endif
 
+/* SIMD kernels are compiled using function level target attributes and
+ * selected at runtime, which is only supported by gcc and clang */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    define JARO_WINKLER_X86_DISPATCH 1
+#    define JARO_WINKLER_TARGET(arch) __attribute__((target(arch)))
+#    include <immintrin.h>
+#else
+#    define JARO_WINKLER_X86_DISPATCH 0
+#    define JARO_WINKLER_TARGET(arch)
+#endif
+
+/* pext/pdep on 64 bit words are only available on x86_64. Defining
+ * JARO_WINKLER_DISABLE_PEXT forces the scalar transposition count, e.g. to
+ * test it on hosts with fast pext */
+#if JARO_WINKLER_X86_DISPATCH && defined(__x86_64__) && !defined(JARO_WINKLER_DISABLE_PEXT)
+#    define JARO_WINKLER_HAS_PEXT 1
+#else
+#    define JARO_WINKLER_HAS_PEXT 0
+#endif
+
+/* word size used by the bit-parallel kernels of the uncached scorers. 32 bit
+ * targets default to 32 bit words, since 64 bit shifts are emulated there */
+#ifndef JARO_WINKLER_WORD_BITS
+#    if UINTPTR_MAX == 0xFFFFFFFFu
+#        define JARO_WINKLER_WORD_BITS 32
+#    else
+#        define JARO_WINKLER_WORD_BITS 64
+#    endif
+#endif
+
 namespace jaro_winkler {
 namespace intrinsics {
 
@@ -28,6 +58,19 @@ bool bittest(T a, int bit)
     return (a >> bit) & 1;
 }
 
+static inline int64_t popcount(uint32_t x)
+{
+    const uint32_t m1 = 0x55555555;
+    const uint32_t m2 = 0x33333333;
+    const uint32_t m4 = 0x0f0f0f0f;
+    const uint32_t h01 = 0x01010101;
+
+    x -= (x >> 1) & m1;
+    x = (x & m2) + ((x >> 2) & m2);
+    x = (x + (x >> 4)) & m4;
+    return static_cast<int64_t>((x * h01) >> 24);
+}
+
 static inline int64_t popcount(uint64_t x)
 {
     const uint64_t m1 = 0x5555555555555555;
@@ -106,5 +149,57 @@ static inline int tzcnt(uint64_t x)
 }
 #endif
 
+#if JARO_WINKLER_X86_DISPATCH
+static inline bool cpu_supports_avx2()
+{
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+}
+
+static inline bool cpu_supports_avx512()
+{
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") != 0;
+    }();
+    return supported;
+}
+/**
+ * bmi2 is available and pext/pdep are implemented in hardware. AMD processors
+ * before Zen 3 implement them in microcode, which is slower than a scalar loop.
+ */
+static inline bool cpu_supports_fast_pext()
+{
+#    if JARO_WINKLER_HAS_PEXT
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("amdfam15h") &&
+               !__builtin_cpu_is("amdfam17h");
+    }();
+    return supported;
+#    else
+    return false;
+#    endif
+}
+#else
+static inline bool cpu_supports_avx2()
+{
+    return false;
+}
+
+static inline bool cpu_supports_fast_pext()
+{
+    return false;
+}
+
+static inline bool cpu_supports_avx512()
+{
+    return false;
+}
+#endif
+
 } // namespace intrinsics
 } // namespace jaro_winkler
@@ -1,27 +1,82 @@
 /* SPDX-License-Identifier: MIT */
 /* Copyright © 2022 Max Bachmann */
 
+#pragma once
 #include <jaro_winkler/details/common.hpp>
 #include <jaro_winkler/details/intrinsics.hpp>
 
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
 namespace jaro_winkler {
+
+/**
+ * @brief parameters of the Jaro and Jaro-Winkler similarity
+ *
+ * The policy is resolved at compile time, so a custom policy does not add
+ * any overhead. A custom policy has to provide the same static member
+ * functions, e.g. for the Winkler-Porter variant with a wider window:
+ *
+ *     struct WinklerPorterPolicy : jaro_winkler::DefaultJaroPolicy {
+ *         static constexpr int64_t match_window(int64_t P_len, int64_t T_len)
+ *         {
+ *             return std::max(P_len, T_len) / 2;
+ *         }
+ *     };
+ */
+struct DefaultJaroPolicy {
+    /**
+     * characters are only considered similar, when their positions differ
+     * by at most match_window(P_len, T_len)
+     */
+    static constexpr int64_t match_window(int64_t P_len, int64_t T_len)
+    {
+        return std::max(P_len, T_len) / 2 - 1;
+    }
+
+    /* the common prefix is only taken into account above this Jaro similarity */
+    static constexpr double boost_threshold()
+    {
+        return 0.7;
+    }
+
+    /* maximum length of the common prefix taken into account */
+    static constexpr int64_t max_prefix()
+    {
+        return 4;
+    }
+};
+
 namespace detail {
 
-struct FlaggedCharsWord {
-    uint64_t P_flag;
-    uint64_t T_flag;
+/* word type used by the uncached scorers (see JARO_WINKLER_WORD_BITS) */
+using native_word = std::conditional<JARO_WINKLER_WORD_BITS == 32, uint32_t, uint64_t>::type;
+
+template <typename Word>
+struct BasicFlaggedCharsWord {
+    Word P_flag;
+    Word T_flag;
 };
 
-struct FlaggedCharsMultiword {
-    std::vector<uint64_t> P_flag;
-    std::vector<uint64_t> T_flag;
+using FlaggedCharsWord = BasicFlaggedCharsWord<uint64_t>;
+
+template <typename Word>
+struct BasicFlaggedCharsMultiword {
+    std::vector<Word> P_flag;
+    std::vector<Word> T_flag;
 };
 
+using FlaggedCharsMultiword = BasicFlaggedCharsMultiword<uint64_t>;
+
+template <typename Word>
 struct SearchBoundMask {
     int64_t words = 0;
     int64_t empty_words = 0;
-    uint64_t last_mask = 0;
-    uint64_t first_mask = 0;
+    Word last_mask = 0;
+    Word first_mask = 0;
 };
 
 struct TextPosition {
@@ -42,6 +97,20 @@ static inline double jaro_calculate_similarity(int64_t P_len, int64_t T_len, int
     return Sim / 3.0;
 }
 
+/**
+ * @brief upper bound of the Jaro similarity of two strings with the lengths
+ * P_len and T_len, which is reached when all characters of the shorter
+ * string match without transpositions
+ */
+static inline double jaro_max_possible_score(int64_t P_len, int64_t T_len)
+{
+    if (!T_len || !P_len) return 0.0;
+
+    double min_len = static_cast<double>(std::min(P_len, T_len));
+    double Sim = min_len / static_cast<double>(P_len) + min_len / static_cast<double>(T_len) + 1.0;
+    return Sim / 3.0;
+}
+
 /**
  * @brief filter matches below score_cutoff based on string lengths
  */
@@ -49,10 +118,7 @@ static inline bool jaro_length_filter(int64_t P_len, int64_t T_len, double score
 {
     if (!T_len || !P_len) return false;
 
-    double min_len = static_cast<double>(std::min(P_len, T_len));
-    double Sim = min_len / static_cast<double>(P_len) + min_len / static_cast<double>(T_len) + 1.0;
-    Sim /= 3.0;
-    return Sim >= score_cutoff;
+    return jaro_max_possible_score(P_len, T_len) >= score_cutoff;
 }
 
 /**
@@ -71,21 +137,23 @@ static inline bool jaro_common_char_filter(int64_t P_len, int64_t T_len, int64_t
     return Sim >= score_cutoff;
 }
 
-static inline int64_t count_common_chars(const FlaggedCharsWord& flagged)
+template <typename Word>
+static inline int64_t count_common_chars(const BasicFlaggedCharsWord<Word>& flagged)
 {
     return intrinsics::popcount(flagged.P_flag);
 }
 
-static inline int64_t count_common_chars(const FlaggedCharsMultiword& flagged)
+template <typename Word>
+static inline int64_t count_common_chars(const BasicFlaggedCharsMultiword<Word>& flagged)
 {
     int64_t CommonChars = 0;
     if (flagged.P_flag.size() < flagged.T_flag.size()) {
-        for (uint64_t flag : flagged.P_flag) {
+        for (Word flag : flagged.P_flag) {
             CommonChars += intrinsics::popcount(flag);
         }
     }
     else {
-        for (uint64_t flag : flagged.T_flag) {
+        for (Word flag : flagged.T_flag) {
             CommonChars += intrinsics::popcount(flag);
         }
     }
@@ -93,37 +161,38 @@ static inline int64_t count_common_chars(const FlaggedCharsMultiword& flagged)
 }
 
 template <typename PM_Vec, typename InputIt1, typename InputIt2>
-static inline FlaggedCharsWord
+static inline BasicFlaggedCharsWord<typename PM_Vec::word_type>
 flag_similar_characters_word(const PM_Vec& PM, InputIt1 P_first,
                              InputIt1 P_last, InputIt2 T_first, InputIt2 T_last, int Bound)
 {
     using namespace intrinsics;
+    using Word = typename PM_Vec::word_type;
     int64_t P_len = std::distance(P_first, P_last);
     (void)P_len;
     int64_t T_len = std::distance(T_first, T_last);
-    assert(P_len <= 64);
-    assert(T_len <= 64);
+    assert(P_len <= common::word_bits<Word>::value);
+    assert(T_len <= common::word_bits<Word>::value);
     assert(Bound > P_len || P_len - Bound <= T_len);
 
-    FlaggedCharsWord flagged = {0, 0};
+    BasicFlaggedCharsWord<Word> flagged = {0, 0};
 
-    uint64_t BoundMask = bit_mask_lsb<uint64_t>(Bound + 1);
+    Word BoundMask = bit_mask_lsb<Word>(Bound + 1);
 
     int64_t j = 0;
     for (; j < std::min(static_cast<int64_t>(Bound), T_len); ++j) {
-        uint64_t PM_j = PM.get(T_first[j]) & BoundMask & (~flagged.P_flag);
+        Word PM_j = PM.get(T_first[j]) & BoundMask & (~flagged.P_flag);
 
         flagged.P_flag |= blsi(PM_j);
-        flagged.T_flag |= static_cast<uint64_t>(PM_j != 0) << j;
+        flagged.T_flag |= static_cast<Word>(PM_j != 0) << j;
 
         BoundMask = (BoundMask << 1) | 1;
     }
 
     for (; j < T_len; ++j) {
-        uint64_t PM_j = PM.get(T_first[j]) & BoundMask & (~flagged.P_flag);
+        Word PM_j = PM.get(T_first[j]) & BoundMask & (~flagged.P_flag);
 
         flagged.P_flag |= blsi(PM_j);
-        flagged.T_flag |= static_cast<uint64_t>(PM_j != 0) << j;
+        flagged.T_flag |= static_cast<Word>(PM_j != 0) << j;
 
         BoundMask <<= 1;
     }
@@ -131,88 +200,91 @@ flag_similar_characters_word(const PM_Vec& PM, InputIt1 P_first,
     return flagged;
 }
 
-template <typename CharT>
-static inline void flag_similar_characters_step(const common::BlockPatternMatchVector& PM,
-                                                CharT T_j, FlaggedCharsMultiword& flagged,
-                                                int64_t j, SearchBoundMask BoundMask)
+template <typename Row, typename Word>
+static inline void flag_similar_characters_step(const Row& row,
+                                                BasicFlaggedCharsMultiword<Word>& flagged,
+                                                int64_t j, SearchBoundMask<Word> BoundMask)
 {
     using namespace intrinsics;
+    const int64_t bits = common::word_bits<Word>::value;
 
-    int64_t j_word = j / 64;
-    int64_t j_pos = j % 64;
+    int64_t j_word = j / bits;
+    int64_t j_pos = j % bits;
     int64_t word = BoundMask.empty_words;
     int64_t last_word = word + BoundMask.words;
 
     if (BoundMask.words == 1) {
-        uint64_t PM_j = PM.get(word, T_j) & BoundMask.last_mask & BoundMask.first_mask &
-                        (~flagged.P_flag[word]);
+        Word PM_j = row.get(word) & BoundMask.last_mask & BoundMask.first_mask &
+                    (~flagged.P_flag[word]);
 
         flagged.P_flag[word] |= blsi(PM_j);
-        flagged.T_flag[j_word] |= static_cast<uint64_t>(PM_j != 0) << j_pos;
+        flagged.T_flag[j_word] |= static_cast<Word>(PM_j != 0) << j_pos;
         return;
     }
 
     if (BoundMask.first_mask) {
-        uint64_t PM_j = PM.get(word, T_j) & BoundMask.first_mask & (~flagged.P_flag[word]);
+        Word PM_j = row.get(word) & BoundMask.first_mask & (~flagged.P_flag[word]);
 
         if (PM_j) {
             flagged.P_flag[word] |= blsi(PM_j);
-            flagged.T_flag[j_word] |= 1ull << j_pos;
+            flagged.T_flag[j_word] |= static_cast<Word>(1) << j_pos;
             return;
         }
         word++;
     }
 
     for (; word < last_word - 1; ++word) {
-        uint64_t PM_j = PM.get(word, T_j) & (~flagged.P_flag[word]);
+        Word PM_j = row.get(word) & (~flagged.P_flag[word]);
 
         if (PM_j) {
             flagged.P_flag[word] |= blsi(PM_j);
-            flagged.T_flag[j_word] |= 1ull << j_pos;
+            flagged.T_flag[j_word] |= static_cast<Word>(1) << j_pos;
             return;
         }
     }
 
     if (BoundMask.last_mask) {
-        uint64_t PM_j = PM.get(word, T_j) & BoundMask.last_mask & (~flagged.P_flag[word]);
+        Word PM_j = row.get(word) & BoundMask.last_mask & (~flagged.P_flag[word]);
 
         flagged.P_flag[word] |= blsi(PM_j);
-        flagged.T_flag[j_word] |= static_cast<uint64_t>(PM_j != 0) << j_pos;
+        flagged.T_flag[j_word] |= static_cast<Word>(PM_j != 0) << j_pos;
     }
 }
 
-template <typename InputIt1, typename InputIt2>
-static inline FlaggedCharsMultiword
-flag_similar_characters_block(const common::BlockPatternMatchVector& PM, InputIt1 P_first,
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline BasicFlaggedCharsMultiword<typename PM_Vec::word_type>
+flag_similar_characters_block(const PM_Vec& PM, InputIt1 P_first,
                               InputIt1 P_last, InputIt2 T_first, InputIt2 T_last, int64_t Bound)
 {
     using namespace intrinsics;
+    using Word = typename PM_Vec::word_type;
+    const int64_t bits = common::word_bits<Word>::value;
     int64_t P_len = std::distance(P_first, P_last);
     int64_t T_len = std::distance(T_first, T_last);
-    assert(P_len > 64 || T_len > 64);
+    assert(P_len > bits || T_len > bits);
     assert(Bound > P_len || P_len - Bound <= T_len);
-    assert(Bound >= 31);
 
-    int64_t TextWords = common::ceildiv(T_len, 64);
-    int64_t PatternWords = common::ceildiv(P_len, 64);
+    int64_t TextWords = common::ceildiv(T_len, bits);
+    int64_t PatternWords = common::ceildiv(P_len, bits);
 
-    FlaggedCharsMultiword flagged;
+    BasicFlaggedCharsMultiword<Word> flagged;
     flagged.T_flag.resize(TextWords);
     flagged.P_flag.resize(PatternWords);
 
-    SearchBoundMask BoundMask;
+    SearchBoundMask<Word> BoundMask;
     int64_t start_range = std::min(Bound + 1, P_len);
-    BoundMask.words = 1 + start_range / 64;
+    BoundMask.words = 1 + start_range / bits;
     BoundMask.empty_words = 0;
-    BoundMask.last_mask = (1ull << (start_range % 64)) - 1;
-    BoundMask.first_mask = ~UINT64_C(0);
+    BoundMask.last_mask = (static_cast<Word>(1) << (start_range % bits)) - 1;
+    BoundMask.first_mask = ~static_cast<Word>(0);
 
     for (int64_t j = 0; j < T_len; ++j) {
-        flag_similar_characters_step(PM, T_first[j], flagged, j, BoundMask);
+        flag_similar_characters_step(common::pattern_match_row(PM, T_first[j]), flagged, j,
+                                     BoundMask);
 
         if (j + Bound + 1 < P_len) {
             BoundMask.last_mask = (BoundMask.last_mask << 1) | 1;
-            if (j + Bound + 2 < P_len && BoundMask.last_mask == ~UINT64_C(0)) {
+            if (j + Bound + 2 < P_len && BoundMask.last_mask == ~static_cast<Word>(0)) {
                 BoundMask.last_mask = 0;
                 BoundMask.words++;
             }
@@ -221,7 +293,7 @@ flag_similar_characters_block(const common::BlockPatternMatchVector& PM, InputIt
         if (j >= Bound) {
             BoundMask.first_mask <<= 1;
             if (BoundMask.first_mask == 0) {
-                BoundMask.first_mask = ~UINT64_C(0);
+                BoundMask.first_mask = ~static_cast<Word>(0);
                 BoundMask.words--;
                 BoundMask.empty_words++;
             }
@@ -231,17 +303,17 @@ flag_similar_characters_block(const common::BlockPatternMatchVector& PM, InputIt
     return flagged;
 }
 
-template <typename PM_Vec, typename InputIt1>
+template <typename PM_Vec, typename InputIt1, typename Word>
 static inline int64_t count_transpositions_word(const PM_Vec& PM,
                                                 InputIt1 T_first, InputIt1,
-                                                const FlaggedCharsWord& flagged)
+                                                const BasicFlaggedCharsWord<Word>& flagged)
 {
     using namespace intrinsics;
-    uint64_t P_flag = flagged.P_flag;
-    uint64_t T_flag = flagged.T_flag;
+    Word P_flag = flagged.P_flag;
+    Word T_flag = flagged.T_flag;
     int64_t Transpositions = 0;
     while (T_flag) {
-        uint64_t PatternFlagMask = blsi(P_flag);
+        Word PatternFlagMask = blsi(P_flag);
 
         Transpositions += !(PM.get(T_first[tzcnt(T_flag)]) & PatternFlagMask);
 
@@ -252,22 +324,22 @@ static inline int64_t count_transpositions_word(const PM_Vec& PM,
     return Transpositions;
 }
 
-template <typename InputIt1>
+template <typename PM_Vec, typename InputIt1, typename Word>
 static inline int64_t
-count_transpositions_block(const common::BlockPatternMatchVector& PM, InputIt1 T_first, InputIt1,
-                           const FlaggedCharsMultiword& flagged, int64_t FlaggedChars)
+count_transpositions_block(const PM_Vec& PM, InputIt1 T_first, InputIt1,
+                           const BasicFlaggedCharsMultiword<Word>& flagged, int64_t FlaggedChars)
 {
     using namespace intrinsics;
     int64_t TextWord = 0;
     int64_t PatternWord = 0;
-    uint64_t T_flag = flagged.T_flag[TextWord];
-    uint64_t P_flag = flagged.P_flag[PatternWord];
+    Word T_flag = flagged.T_flag[TextWord];
+    Word P_flag = flagged.P_flag[PatternWord];
 
     int64_t Transpositions = 0;
     while (FlaggedChars) {
         while (!T_flag) {
             TextWord++;
-            T_first += 64;
+            T_first += common::word_bits<Word>::value;
             T_flag = flagged.T_flag[TextWord];
         }
 
@@ -277,7 +349,7 @@ count_transpositions_block(const common::BlockPatternMatchVector& PM, InputIt1 T
                 P_flag = flagged.P_flag[PatternWord];
             }
 
-            uint64_t PatternFlagMask = blsi(P_flag);
+            Word PatternFlagMask = blsi(P_flag);
 
             Transpositions += !(PM.get(PatternWord, T_first[tzcnt(T_flag)]) & PatternFlagMask);
 
@@ -292,10 +364,269 @@ count_transpositions_block(const common::BlockPatternMatchVector& PM, InputIt1 T
 }
 
 /**
- * @brief find bounds and skip out of bound parts of the sequences
+ * @brief load up to 8 characters as little endian integer. For contiguous
+ * iterators the full load is merged into a single 64 bit load by the compiler
+ */
+template <typename InputIt>
+static inline uint64_t load_bytes(InputIt first, int64_t count)
+{
+    auto byte = [&](int i) { return static_cast<uint64_t>(static_cast<uint8_t>(first[i])); };
+    if (count >= 8) {
+        return byte(0) | (byte(1) << 8) | (byte(2) << 16) | (byte(3) << 24) | (byte(4) << 32) |
+               (byte(5) << 40) | (byte(6) << 48) | (byte(7) << 56);
+    }
+
+    uint64_t bytes = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        bytes |= byte(static_cast<int>(i)) << (8 * i);
+    }
+    return bytes;
+}
+
+#if JARO_WINKLER_HAS_PEXT
+/**
+ * @brief number of positions in which the byte strings a and b differ
+ */
+JARO_WINKLER_TARGET("popcnt")
+static inline int64_t count_byte_mismatches(const uint8_t* a, const uint8_t* b, int64_t len)
+{
+    int64_t mismatches = 0;
+    int64_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t x;
+        uint64_t y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        x ^= y;
+        /* collapse every byte into its lowest bit */
+        x |= x >> 4;
+        x |= x >> 2;
+        x |= x >> 1;
+        mismatches += __builtin_popcountll(x & 0x0101010101010101);
+    }
+    for (; i < len; ++i) {
+        mismatches += a[i] != b[i];
+    }
+    return mismatches;
+}
+
+/**
+ * @brief append the characters of [first, first + len) flagged in flag to out
+ * using pext to compact 8 characters at a time. out requires 8 bytes of slack.
  *
+ * @return number of characters appended
  */
+template <typename InputIt>
+JARO_WINKLER_TARGET("bmi,bmi2,popcnt")
+static inline int64_t compact_flagged_bytes_bmi2(InputIt first, int64_t len, uint64_t flag,
+                                                 uint8_t* out)
+{
+    int64_t count = 0;
+    for (int64_t i = 0; flag; i += 8, flag >>= 8) {
+        uint64_t bits = flag & 0xFF;
+        if (!bits) continue;
+
+        uint64_t mask = _pdep_u64(bits, 0x0101010101010101) * 0xFF;
+        uint64_t packed = _pext_u64(load_bytes(first + i, std::min<int64_t>(8, len - i)), mask);
+        std::memcpy(out + count, &packed, 8);
+        count += __builtin_popcountll(bits);
+    }
+    return count;
+}
+
+/**
+ * @brief count_transpositions_word for 8 bit characters. Instead of looking
+ * up every flagged character of T in the pattern match vector, the flagged
+ * characters of both strings are compacted using pext and compared 8 at a time.
+ */
+template <typename InputIt1, typename InputIt2>
+JARO_WINKLER_TARGET("bmi,bmi2,popcnt")
+static inline int64_t count_transpositions_word_bmi2(InputIt1 P_first, InputIt1 P_last,
+                                                     InputIt2 T_first, InputIt2 T_last,
+                                                     const FlaggedCharsWord& flagged)
+{
+    uint8_t P_chars[64 + 8];
+    uint8_t T_chars[64 + 8];
+    int64_t count = compact_flagged_bytes_bmi2(T_first, std::distance(T_first, T_last),
+                                               flagged.T_flag, T_chars);
+    compact_flagged_bytes_bmi2(P_first, std::distance(P_first, P_last), flagged.P_flag, P_chars);
+    return count_byte_mismatches(P_chars, T_chars, count);
+}
+
+/**
+ * @brief count_transpositions_block for 8 bit characters. A whole word of
+ * flagged characters is compacted per iteration and compared against the
+ * flagged characters of the other string, which are buffered, since the
+ * words of both strings do not contain the same number of flagged characters.
+ */
+template <typename InputIt1, typename InputIt2>
+JARO_WINKLER_TARGET("bmi,bmi2,popcnt")
+static inline int64_t count_transpositions_block_bmi2(InputIt1 P_first, InputIt1 P_last,
+                                                      InputIt2 T_first, InputIt2 T_last,
+                                                      const FlaggedCharsMultiword& flagged)
+{
+    int64_t P_len = std::distance(P_first, P_last);
+    int64_t T_len = std::distance(T_first, T_last);
+    size_t P_words = flagged.P_flag.size();
+    size_t T_words = flagged.T_flag.size();
+
+    uint8_t P_chars[128 + 8];
+    uint8_t T_chars[128 + 8];
+    int64_t P_count = 0;
+    int64_t T_count = 0;
+    size_t P_word = 0;
+    size_t T_word = 0;
+    int64_t Transpositions = 0;
+
+    while (true) {
+        while (P_count < 64 && P_word < P_words) {
+            int64_t pos = static_cast<int64_t>(P_word) * 64;
+            P_count += compact_flagged_bytes_bmi2(P_first + pos, P_len - pos,
+                                                  flagged.P_flag[P_word], P_chars + P_count);
+            P_word++;
+        }
+        while (T_count < 64 && T_word < T_words) {
+            int64_t pos = static_cast<int64_t>(T_word) * 64;
+            T_count += compact_flagged_bytes_bmi2(T_first + pos, T_len - pos,
+                                                  flagged.T_flag[T_word], T_chars + T_count);
+            T_word++;
+        }
+
+        int64_t count = std::min(P_count, T_count);
+        if (!count) break;
+
+        Transpositions += count_byte_mismatches(P_chars, T_chars, count);
+        P_count -= count;
+        T_count -= count;
+        std::memmove(P_chars, P_chars + count, static_cast<size_t>(P_count));
+        std::memmove(T_chars, T_chars + count, static_cast<size_t>(T_count));
+    }
+
+    return Transpositions;
+}
+#endif
+
 template <typename InputIt1, typename InputIt2>
+struct use_transpositions_bmi2 {
+    using CharT1 = typename std::iterator_traits<InputIt1>::value_type;
+    using CharT2 = typename std::iterator_traits<InputIt2>::value_type;
+    static constexpr bool value = JARO_WINKLER_HAS_PEXT && sizeof(CharT1) == 1 &&
+                                  std::is_same<CharT1, CharT2>::value;
+};
+
+/**
+ * @brief count the transpositions between the flagged characters of P and T.
+ * For 8 bit characters this uses pext when it is implemented in hardware.
+ */
+template <typename PM_Vec, typename InputIt1, typename InputIt2, typename Word>
+static inline typename std::enable_if<use_transpositions_bmi2<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+count_transpositions(const PM_Vec& PM, InputIt1 P_first, InputIt1 P_last, InputIt2 T_first,
+                     InputIt2 T_last, const BasicFlaggedCharsWord<Word>& flagged)
+{
+#if JARO_WINKLER_HAS_PEXT
+    if (intrinsics::cpu_supports_fast_pext()) {
+        FlaggedCharsWord flagged64 = {flagged.P_flag, flagged.T_flag};
+        return count_transpositions_word_bmi2(P_first, P_last, T_first, T_last, flagged64);
+    }
+#endif
+    return count_transpositions_word(PM, T_first, T_last, flagged);
+}
+
+template <typename PM_Vec, typename InputIt1, typename InputIt2, typename Word>
+static inline typename std::enable_if<!use_transpositions_bmi2<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+count_transpositions(const PM_Vec& PM, InputIt1, InputIt1, InputIt2 T_first, InputIt2 T_last,
+                     const BasicFlaggedCharsWord<Word>& flagged)
+{
+    return count_transpositions_word(PM, T_first, T_last, flagged);
+}
+
+/* the pext kernel for blocks expects 64 bit words */
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline typename std::enable_if<use_transpositions_bmi2<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+count_transpositions(const PM_Vec& PM, InputIt1 P_first, InputIt1 P_last, InputIt2 T_first,
+                     InputIt2 T_last, const FlaggedCharsMultiword& flagged, int64_t FlaggedChars)
+{
+#if JARO_WINKLER_HAS_PEXT
+    if (intrinsics::cpu_supports_fast_pext()) {
+        return count_transpositions_block_bmi2(P_first, P_last, T_first, T_last, flagged);
+    }
+#endif
+    return count_transpositions_block(PM, T_first, T_last, flagged, FlaggedChars);
+}
+
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline typename std::enable_if<!use_transpositions_bmi2<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+count_transpositions(const PM_Vec& PM, InputIt1, InputIt1, InputIt2 T_first, InputIt2 T_last,
+                     const FlaggedCharsMultiword& flagged, int64_t FlaggedChars)
+{
+    return count_transpositions_block(PM, T_first, T_last, flagged, FlaggedChars);
+}
+
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline int64_t count_transpositions(const PM_Vec& PM, InputIt1, InputIt1, InputIt2 T_first,
+                                           InputIt2 T_last,
+                                           const BasicFlaggedCharsMultiword<uint32_t>& flagged,
+                                           int64_t FlaggedChars)
+{
+    return count_transpositions_block(PM, T_first, T_last, flagged, FlaggedChars);
+}
+
+/* longest pattern, for which resetting the entries of ScratchPatternMatchVector
+ * one by one is faster than zeroing a new pattern match vector */
+static constexpr int64_t scratch_pattern_max_length = 16;
+
+/**
+ * @brief pattern match vector of the uncached scorers for short patterns.
+ * A thread local vector is reused and only the entries set for the pattern
+ * are reset afterwards, instead of zeroing ~4 KB per call.
+ */
+template <typename Word, typename InputIt1>
+struct ScratchPatternMatchVector {
+    ScratchPatternMatchVector(InputIt1 first, InputIt1 last)
+        : PM(instance()), m_first(first), m_last(last)
+    {
+        /* the destructor does not run when insert throws, so the entries set
+         * so far are reset here. The failing element is unknown, so the whole
+         * vector is cleared */
+        try {
+            PM.insert(first, last);
+        }
+        catch (...) {
+            PM = common::BasicPatternMatchVector<Word>();
+            throw;
+        }
+    }
+
+    ScratchPatternMatchVector(const ScratchPatternMatchVector&) = delete;
+    ScratchPatternMatchVector& operator=(const ScratchPatternMatchVector&) = delete;
+
+    ~ScratchPatternMatchVector()
+    {
+        PM.remove(m_first, m_last);
+    }
+
+    common::BasicPatternMatchVector<Word>& PM;
+
+private:
+    static common::BasicPatternMatchVector<Word>& instance()
+    {
+        static thread_local common::BasicPatternMatchVector<Word> PM;
+        return PM;
+    }
+
+    InputIt1 m_first;
+    InputIt1 m_last;
+};
+
+/**
+ * @brief find bounds and skip out of bound parts of the sequences
+ *
+ */
+template <typename Policy = DefaultJaroPolicy, typename InputIt1, typename InputIt2>
 int64_t jaro_bounds(InputIt1 P_first, InputIt1& P_last, InputIt2 T_first, InputIt2& T_last)
 {
     int64_t P_len = std::distance(P_first, P_last);
@@ -304,23 +635,40 @@ int64_t jaro_bounds(InputIt1 P_first, InputIt1& P_last, InputIt2 T_first, InputI
     /* since jaro uses a sliding window some parts of T/P might never be in
      * range an can be removed ahead of time
      */
-    int64_t Bound = 0;
-    if (T_len > P_len) {
-        Bound = T_len / 2 - 1;
-        if (T_len > P_len + Bound) {
-            T_last = T_first + P_len + Bound;
-        }
+    int64_t Bound = std::max<int64_t>(Policy::match_window(P_len, T_len), 0);
+    if (T_len > P_len + Bound) {
+        T_last = T_first + P_len + Bound;
     }
-    else {
-        Bound = P_len / 2 - 1;
-        if (P_len > T_len + Bound) {
-            P_last = P_first + T_len + Bound;
-        }
+    if (P_len > T_len + Bound) {
+        P_last = P_first + T_len + Bound;
     }
     return Bound;
 }
 
-template <typename InputIt1, typename InputIt2>
+/**
+ * @brief add the common characters and transpositions found by the word
+ * kernel to CommonChars and Transpositions
+ *
+ * @return false when the pair can't reach score_cutoff
+ */
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+bool jaro_word_counts(const PM_Vec& PM, InputIt1 P_first, InputIt1 P_last, InputIt2 T_first,
+                      InputIt2 T_last, int64_t Bound, int64_t P_len, int64_t T_len,
+                      double score_cutoff, int64_t& CommonChars, int64_t& Transpositions)
+{
+    auto flagged = flag_similar_characters_word(PM, P_first, P_last, T_first, T_last,
+                                                static_cast<int>(Bound));
+    CommonChars += count_common_chars(flagged);
+
+    if (!jaro_common_char_filter(P_len, T_len, CommonChars, score_cutoff)) {
+        return false;
+    }
+
+    Transpositions += count_transpositions(PM, P_first, P_last, T_first, T_last, flagged);
+    return true;
+}
+
+template <typename Policy = DefaultJaroPolicy, typename InputIt1, typename InputIt2>
 double jaro_similarity(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first, InputIt2 T_last,
                        double score_cutoff)
 {
@@ -336,7 +684,7 @@ double jaro_similarity(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first, Inpu
         return static_cast<double>(P_first[0] == T_first[0]);
     }
 
-    int64_t Bound = jaro_bounds(P_first, P_last, T_first, T_last);
+    int64_t Bound = jaro_bounds<Policy>(P_first, P_last, T_first, T_last);
 
     /* common prefix never includes Transpositions */
     int64_t CommonChars = common::remove_common_prefix(P_first, P_last, T_first, T_last);
@@ -347,19 +695,28 @@ double jaro_similarity(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first, Inpu
     if (!P_view_len || !T_view_len) {
         /* already has correct number of common chars and transpositions */
     }
-    else if (P_view_len <= 64 && T_view_len <= 64) {
-        common::PatternMatchVector PM(P_first, P_last);
-        auto flagged = flag_similar_characters_word(PM, P_first, P_last, T_first, T_last, static_cast<int>(Bound));
-        CommonChars += count_common_chars(flagged);
-
-        if (!jaro_common_char_filter(P_len, T_len, CommonChars, score_cutoff)) {
+    else if (P_view_len <= scratch_pattern_max_length &&
+             T_view_len <= common::word_bits<native_word>::value)
+    {
+        ScratchPatternMatchVector<native_word, InputIt1> scratch(P_first, P_last);
+        if (!jaro_word_counts(scratch.PM, P_first, P_last, T_first, T_last, Bound, P_len, T_len,
+                              score_cutoff, CommonChars, Transpositions))
+        {
+            return 0.0;
+        }
+    }
+    else if (P_view_len <= common::word_bits<native_word>::value &&
+             T_view_len <= common::word_bits<native_word>::value)
+    {
+        common::BasicPatternMatchVector<native_word> PM(P_first, P_last);
+        if (!jaro_word_counts(PM, P_first, P_last, T_first, T_last, Bound, P_len, T_len,
+                              score_cutoff, CommonChars, Transpositions))
+        {
             return 0.0;
         }
-
-        Transpositions = count_transpositions_word(PM, T_first, T_last, flagged);
     }
     else {
-        common::BlockPatternMatchVector PM(P_first, P_last);
+        common::BasicBlockPatternMatchVector<native_word> PM(P_first, P_last);
         auto flagged = flag_similar_characters_block(PM, P_first, P_last, T_first, T_last, Bound);
         int64_t FlaggedChars = count_common_chars(flagged);
         CommonChars += FlaggedChars;
@@ -368,15 +725,17 @@ double jaro_similarity(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first, Inpu
             return 0.0;
         }
 
-        Transpositions = count_transpositions_block(PM, T_first, T_last, flagged, FlaggedChars);
+        Transpositions =
+            count_transpositions(PM, P_first, P_last, T_first, T_last, flagged, FlaggedChars);
     }
 
     double Sim = jaro_calculate_similarity(P_len, T_len, CommonChars, Transpositions);
     return common::result_cutoff(Sim, score_cutoff);
 }
 
-template <typename InputIt1, typename InputIt2>
-double jaro_similarity(const common::BlockPatternMatchVector& PM, InputIt1 P_first, InputIt1 P_last,
+template <typename Policy = DefaultJaroPolicy, typename PM_Vec, typename InputIt1,
+          typename InputIt2>
+double jaro_similarity(const PM_Vec& PM, InputIt1 P_first, InputIt1 P_last,
                        InputIt2 T_first, InputIt2 T_last, double score_cutoff)
 {
     int64_t P_len = std::distance(P_first, P_last);
@@ -391,7 +750,7 @@ double jaro_similarity(const common::BlockPatternMatchVector& PM, InputIt1 P_fir
         return static_cast<double>(P_first[0] == T_first[0]);
     }
 
-    int64_t Bound = jaro_bounds(P_first, P_last, T_first, T_last);
+    int64_t Bound = jaro_bounds<Policy>(P_first, P_last, T_first, T_last);
 
     /* common prefix never includes Transpositions */
     int64_t CommonChars = 0;
@@ -402,7 +761,9 @@ double jaro_similarity(const common::BlockPatternMatchVector& PM, InputIt1 P_fir
     if (!P_view_len || !T_view_len) {
         /* already has correct number of common chars and transpositions */
     }
-    else if (P_view_len <= 64 && T_view_len <= 64) {
+    else if (P_view_len <= common::word_bits<typename PM_Vec::word_type>::value &&
+             T_view_len <= common::word_bits<typename PM_Vec::word_type>::value)
+    {
         auto flagged = flag_similar_characters_word(PM, P_first, P_last, T_first, T_last, static_cast<int>(Bound));
         CommonChars += count_common_chars(flagged);
 
@@ -410,7 +771,7 @@ double jaro_similarity(const common::BlockPatternMatchVector& PM, InputIt1 P_fir
             return 0.0;
         }
 
-        Transpositions = count_transpositions_word(PM, T_first, T_last, flagged);
+        Transpositions = count_transpositions(PM, P_first, P_last, T_first, T_last, flagged);
     }
     else {
         auto flagged = flag_similar_characters_block(PM, P_first, P_last, T_first, T_last, Bound);
@@ -421,22 +782,26 @@ double jaro_similarity(const common::BlockPatternMatchVector& PM, InputIt1 P_fir
             return 0.0;
         }
 
-        Transpositions = count_transpositions_block(PM, T_first, T_last, flagged, FlaggedChars);
+        Transpositions =
+            count_transpositions(PM, P_first, P_last, T_first, T_last, flagged, FlaggedChars);
     }
 
     double Sim = jaro_calculate_similarity(P_len, T_len, CommonChars, Transpositions);
     return common::result_cutoff(Sim, score_cutoff);
 }
 
-template <typename InputIt1, typename InputIt2>
-double jaro_winkler_similarity(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first, InputIt2 T_last,
-                               double prefix_weight, double score_cutoff)
+/**
+ * @brief length of the common prefix considered by the Jaro-Winkler similarity
+ */
+template <typename Policy = DefaultJaroPolicy, typename InputIt1, typename InputIt2>
+int64_t jaro_winkler_common_prefix(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first,
+                                   InputIt2 T_last)
 {
     int64_t P_len = std::distance(P_first, P_last);
     int64_t T_len = std::distance(T_first, T_last);
     int64_t min_len = std::min(P_len, T_len);
     int64_t prefix = 0;
-    int64_t max_prefix = std::min<int64_t>(min_len, 4);
+    int64_t max_prefix = std::min<int64_t>(min_len, Policy::max_prefix());
 
     for (; prefix < max_prefix; ++prefix) {
         if (T_first[prefix] != P_first[prefix]) {
@@ -444,62 +809,118 @@ double jaro_winkler_similarity(InputIt1 P_first, InputIt1 P_last, InputIt2 T_fir
         }
     }
 
+    return prefix;
+}
+
+/**
+ * @brief score_cutoff the Jaro similarity has to reach, so the Jaro-Winkler
+ * similarity can reach score_cutoff
+ */
+template <typename Policy = DefaultJaroPolicy>
+double jaro_winkler_jaro_cutoff(int64_t prefix, double prefix_weight, double score_cutoff)
+{
+    const double threshold = Policy::boost_threshold();
     double jaro_score_cutoff = score_cutoff;
-    if (jaro_score_cutoff > 0.7) {
-        double prefix_sim = prefix * prefix_weight;
+    if (jaro_score_cutoff > threshold) {
+        double prefix_sim = static_cast<double>(prefix) * prefix_weight;
 
         if (prefix_sim >= 1.0) {
-            jaro_score_cutoff = 0.7;
+            jaro_score_cutoff = threshold;
         }
         else {
             jaro_score_cutoff =
-                std::max(0.7, (prefix_sim - jaro_score_cutoff) / (prefix_sim - 1.0));
+                std::max(threshold, (prefix_sim - jaro_score_cutoff) / (prefix_sim - 1.0));
         }
     }
 
-    double Sim = jaro_similarity(P_first, P_last, T_first, T_last, jaro_score_cutoff);
-    if (Sim > 0.7) {
-        Sim += prefix * prefix_weight * (1.0 - Sim);
+    return jaro_score_cutoff;
+}
+
+template <typename Policy = DefaultJaroPolicy>
+double jaro_winkler_apply_prefix(double Sim, int64_t prefix, double prefix_weight)
+{
+    if (Sim > Policy::boost_threshold()) {
+        Sim += static_cast<double>(prefix) * prefix_weight * (1.0 - Sim);
     }
 
-    return common::result_cutoff(Sim, score_cutoff);
+    return Sim;
 }
 
-template <typename InputIt1, typename InputIt2>
-double jaro_winkler_similarity(const common::BlockPatternMatchVector& PM, InputIt1 P_first,
-                               InputIt1 P_last, InputIt2 T_first, InputIt2 T_last,
-                               double prefix_weight, double score_cutoff)
+/**
+ * @brief upper bound of the Jaro-Winkler similarity of two strings with the
+ * lengths P_len and T_len sharing a common prefix of the length prefix.
+ * The prefix boost is monotonic in the Jaro similarity, so applying it to the
+ * Jaro upper bound results in an upper bound for the Jaro-Winkler similarity.
+ */
+template <typename Policy = DefaultJaroPolicy>
+double jaro_winkler_max_possible_score(int64_t P_len, int64_t T_len, int64_t prefix,
+                                       double prefix_weight)
 {
-    int64_t P_len = std::distance(P_first, P_last);
-    int64_t T_len = std::distance(T_first, T_last);
-    int64_t min_len = std::min(P_len, T_len);
-    int64_t prefix = 0;
-    int64_t max_prefix = std::min<int64_t>(min_len, 4);
+    prefix = std::min<int64_t>({prefix, P_len, T_len, Policy::max_prefix()});
+    return jaro_winkler_apply_prefix<Policy>(jaro_max_possible_score(P_len, T_len), prefix,
+                                             prefix_weight);
+}
 
-    for (; prefix < max_prefix; ++prefix) {
-        if (T_first[prefix] != P_first[prefix]) {
-            break;
-        }
+/**
+ * @brief validate the prefix_weight, which has to be small enough that
+ * the similarity can not exceed 1.0
+ */
+template <typename Policy = DefaultJaroPolicy>
+void validate_prefix_weight(double prefix_weight)
+{
+    double max_weight = 1.0 / static_cast<double>(Policy::max_prefix());
+    if (prefix_weight < 0.0 || prefix_weight > max_weight) {
+        std::ostringstream msg;
+        msg << "prefix_weight has to be between 0.0 and " << max_weight;
+        throw std::invalid_argument(msg.str());
     }
+}
 
-    double jaro_score_cutoff = score_cutoff;
-    if (jaro_score_cutoff > 0.7) {
-        double prefix_sim = prefix * prefix_weight;
+template <typename Policy = DefaultJaroPolicy, typename InputIt1, typename InputIt2>
+double jaro_winkler_similarity(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first, InputIt2 T_last,
+                               double prefix_weight, double score_cutoff)
+{
+    int64_t prefix = jaro_winkler_common_prefix<Policy>(P_first, P_last, T_first, T_last);
 
-        if (prefix_sim >= 1.0) {
-            jaro_score_cutoff = 0.7;
-        }
-        else {
-            jaro_score_cutoff =
-                std::max(0.7, (prefix_sim - jaro_score_cutoff) / (prefix_sim - 1.0));
-        }
+    /* filter out based on the lengths and the common prefix before any bit-parallel work */
+    if (jaro_winkler_max_possible_score<Policy>(std::distance(P_first, P_last),
+                                                std::distance(T_first, T_last), prefix,
+                                                prefix_weight) < score_cutoff)
+    {
+        return 0.0;
     }
 
-    double Sim = jaro_similarity(PM, P_first, P_last, T_first, T_last, jaro_score_cutoff);
-    if (Sim > 0.7) {
-        Sim += prefix * prefix_weight * (1.0 - Sim);
+    double jaro_score_cutoff =
+        jaro_winkler_jaro_cutoff<Policy>(prefix, prefix_weight, score_cutoff);
+
+    double Sim =
+        detail::jaro_similarity<Policy>(P_first, P_last, T_first, T_last, jaro_score_cutoff);
+    Sim = jaro_winkler_apply_prefix<Policy>(Sim, prefix, prefix_weight);
+    return common::result_cutoff(Sim, score_cutoff);
+}
+
+template <typename Policy = DefaultJaroPolicy, typename PM_Vec, typename InputIt1,
+          typename InputIt2>
+double jaro_winkler_similarity(const PM_Vec& PM, InputIt1 P_first,
+                               InputIt1 P_last, InputIt2 T_first, InputIt2 T_last,
+                               double prefix_weight, double score_cutoff)
+{
+    int64_t prefix = jaro_winkler_common_prefix<Policy>(P_first, P_last, T_first, T_last);
+
+    /* filter out based on the lengths and the common prefix before any bit-parallel work */
+    if (jaro_winkler_max_possible_score<Policy>(std::distance(P_first, P_last),
+                                                std::distance(T_first, T_last), prefix,
+                                                prefix_weight) < score_cutoff)
+    {
+        return 0.0;
     }
 
+    double jaro_score_cutoff =
+        jaro_winkler_jaro_cutoff<Policy>(prefix, prefix_weight, score_cutoff);
+
+    double Sim =
+        detail::jaro_similarity<Policy>(PM, P_first, P_last, T_first, T_last, jaro_score_cutoff);
+    Sim = jaro_winkler_apply_prefix<Policy>(Sim, prefix, prefix_weight);
     return common::result_cutoff(Sim, score_cutoff);
 }
 
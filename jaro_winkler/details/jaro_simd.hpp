@@ -0,0 +1,719 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/common.hpp>
+#include <jaro_winkler/details/intrinsics.hpp>
+#include <jaro_winkler/details/jaro_impl.hpp>
+#include <jaro_winkler/details/tuning_profile.hpp>
+
+namespace jaro_winkler {
+namespace detail {
+
+/**
+ * state of a single text compared using the word kernel. Multiple lanes
+ * are flagged at once using SIMD, where each SIMD lane holds its own
+ * P_flag, T_flag and BoundMask.
+ */
+template <typename InputIt1, typename InputIt2>
+struct WordLane {
+    InputIt1 P_first;
+    InputIt1 P_last;
+    InputIt2 T_first;
+    InputIt2 T_last;
+    int64_t Bound;
+    FlaggedCharsWord flagged;
+};
+
+/**
+ * @brief number of texts the SIMD implementation available on this CPU can
+ * flag at once. 0 when no SIMD implementation is available
+ */
+static inline int64_t hardware_lane_count()
+{
+    if (intrinsics::cpu_supports_avx512()) return 8;
+    if (intrinsics::cpu_supports_avx2()) return 4;
+    return 0;
+}
+
+/**
+ * @brief number of texts flagged at once by flag_similar_characters_word_lanes,
+ * which is limited by TuningProfile::max_lanes
+ */
+static inline int64_t word_lane_count(const TuningProfile& profile)
+{
+    return std::min(hardware_lane_count(), profile.max_lanes);
+}
+
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline void flag_similar_characters_word_lanes_scalar(const PM_Vec& PM,
+                                                             WordLane<InputIt1, InputIt2>* lanes,
+                                                             int64_t count)
+{
+    for (int64_t i = 0; i < count; ++i) {
+        auto& lane = lanes[i];
+        lane.flagged = flag_similar_characters_word(PM, lane.P_first, lane.P_last, lane.T_first,
+                                                    lane.T_last, static_cast<int>(lane.Bound));
+    }
+}
+
+#if JARO_WINKLER_X86_DISPATCH
+
+/**
+ * @brief look up the pattern match vectors for every character of the lanes
+ *
+ * The lookups are stored column major, so the flagging loop can load the
+ * values for position j of all lanes with a single vector load. The lookups
+ * of each lane are independent of each other, unlike in the scalar kernel,
+ * where they are part of the dependency chain. Positions after the end of a
+ * text are set to 0.
+ *
+ * @return length of the longest text
+ */
+template <int64_t Lanes, typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline int64_t load_word_lanes(const PM_Vec& PM, const WordLane<InputIt1, InputIt2>* lanes,
+                                      int64_t count, uint64_t (*PM_vals)[Lanes])
+{
+    int64_t max_len = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        max_len = std::max<int64_t>(max_len, std::distance(lanes[i].T_first, lanes[i].T_last));
+    }
+
+    const uint64_t* extendedAscii = PM.extended_ascii();
+    const int64_t stride = PM.block_count();
+    for (int64_t i = 0; i < Lanes; ++i) {
+        int64_t j = 0;
+        if (i < count) {
+            InputIt2 T_first = lanes[i].T_first;
+            int64_t T_len = std::distance(T_first, lanes[i].T_last);
+            for (; j < T_len; ++j) {
+                auto key = T_first[j];
+                PM_vals[j][i] =
+                    (key >= 0 && key <= 255) ? extendedAscii[key * stride] : PM.get(key);
+            }
+        }
+
+        for (; j < max_len; ++j) {
+            PM_vals[j][i] = 0;
+        }
+    }
+
+    return max_len;
+}
+
+/**
+ * @brief flag the lanes using the pattern match vectors loaded into PM_vals
+ */
+template <typename InputIt1, typename InputIt2>
+JARO_WINKLER_TARGET("avx2")
+static inline void flag_word_lanes_avx2(const uint64_t (*PM_vals)[4], int64_t max_len,
+                                        WordLane<InputIt1, InputIt2>* lanes, int64_t count)
+{
+    assert(count <= 4);
+    alignas(32) int64_t Bound[4] = {0, 0, 0, 0};
+    alignas(32) uint64_t InitialMask[4] = {0, 0, 0, 0};
+    for (int64_t i = 0; i < count; ++i) {
+        Bound[i] = lanes[i].Bound;
+        InitialMask[i] = intrinsics::bit_mask_lsb<uint64_t>(static_cast<int>(Bound[i]) + 1);
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i Bounds = _mm256_load_si256(reinterpret_cast<const __m256i*>(Bound));
+    __m256i BoundMask = _mm256_load_si256(reinterpret_cast<const __m256i*>(InitialMask));
+    __m256i P_flag = zero;
+    __m256i T_flag = zero;
+
+    for (int64_t j = 0; j < max_len; ++j) {
+        __m256i PM_j = _mm256_load_si256(reinterpret_cast<const __m256i*>(PM_vals[j]));
+        PM_j = _mm256_andnot_si256(P_flag, _mm256_and_si256(PM_j, BoundMask));
+
+        /* P_flag |= blsi(PM_j) */
+        P_flag = _mm256_or_si256(P_flag, _mm256_and_si256(PM_j, _mm256_sub_epi64(zero, PM_j)));
+        /* T_flag |= (PM_j != 0) << j */
+        __m256i bit_j = _mm256_set1_epi64x(static_cast<long long>(1ull << j));
+        T_flag = _mm256_or_si256(T_flag,
+                                 _mm256_andnot_si256(_mm256_cmpeq_epi64(PM_j, zero), bit_j));
+
+        /* BoundMask = (BoundMask << 1) | (j < Bound) */
+        __m256i grow = _mm256_cmpgt_epi64(Bounds, _mm256_set1_epi64x(j));
+        BoundMask = _mm256_or_si256(_mm256_slli_epi64(BoundMask, 1), _mm256_and_si256(grow, one));
+    }
+
+    alignas(32) uint64_t P_flags[4];
+    alignas(32) uint64_t T_flags[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(P_flags), P_flag);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(T_flags), T_flag);
+    for (int64_t i = 0; i < count; ++i) {
+        lanes[i].flagged = {P_flags[i], T_flags[i]};
+    }
+}
+
+/* gcc reports the _mm512_undefined_epi32 used inside of the avx512 intrinsics */
+#    if !defined(__clang__)
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#    endif
+
+template <typename InputIt1, typename InputIt2>
+JARO_WINKLER_TARGET("avx512f")
+static inline void flag_word_lanes_avx512(const uint64_t (*PM_vals)[8], int64_t max_len,
+                                          WordLane<InputIt1, InputIt2>* lanes, int64_t count)
+{
+    assert(count <= 8);
+    alignas(64) int64_t Bound[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    alignas(64) uint64_t InitialMask[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (int64_t i = 0; i < count; ++i) {
+        Bound[i] = lanes[i].Bound;
+        InitialMask[i] = intrinsics::bit_mask_lsb<uint64_t>(static_cast<int>(Bound[i]) + 1);
+    }
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i Bounds = _mm512_load_si512(Bound);
+    __m512i BoundMask = _mm512_load_si512(InitialMask);
+    __m512i P_flag = zero;
+    __m512i T_flag = zero;
+
+    for (int64_t j = 0; j < max_len; ++j) {
+        __m512i PM_j = _mm512_load_si512(PM_vals[j]);
+        PM_j = _mm512_andnot_si512(P_flag, _mm512_and_si512(PM_j, BoundMask));
+
+        /* P_flag |= blsi(PM_j) */
+        P_flag = _mm512_or_si512(P_flag, _mm512_and_si512(PM_j, _mm512_sub_epi64(zero, PM_j)));
+        /* T_flag |= (PM_j != 0) << j */
+        __mmask8 found = _mm512_test_epi64_mask(PM_j, PM_j);
+        T_flag = _mm512_mask_or_epi64(T_flag, found, T_flag,
+                                      _mm512_set1_epi64(static_cast<long long>(1ull << j)));
+
+        /* BoundMask = (BoundMask << 1) | (j < Bound) */
+        __mmask8 grow = _mm512_cmpgt_epi64_mask(Bounds, _mm512_set1_epi64(j));
+        BoundMask = _mm512_mask_or_epi64(_mm512_slli_epi64(BoundMask, 1), grow,
+                                         _mm512_slli_epi64(BoundMask, 1), one);
+    }
+
+    alignas(64) uint64_t P_flags[8];
+    alignas(64) uint64_t T_flags[8];
+    _mm512_store_si512(P_flags, P_flag);
+    _mm512_store_si512(T_flags, T_flag);
+    for (int64_t i = 0; i < count; ++i) {
+        lanes[i].flagged = {P_flags[i], T_flags[i]};
+    }
+}
+
+#    if !defined(__clang__)
+#        pragma GCC diagnostic pop
+#    endif
+
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline void flag_similar_characters_word_avx2(const PM_Vec& PM,
+                                                     WordLane<InputIt1, InputIt2>* lanes,
+                                                     int64_t count)
+{
+    alignas(32) uint64_t PM_vals[64][4];
+    int64_t max_len = load_word_lanes<4>(PM, lanes, count, PM_vals);
+    flag_word_lanes_avx2(PM_vals, max_len, lanes, count);
+}
+
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline void flag_similar_characters_word_avx512(const PM_Vec& PM,
+                                                       WordLane<InputIt1, InputIt2>* lanes,
+                                                       int64_t count)
+{
+    alignas(64) uint64_t PM_vals[64][8];
+    int64_t max_len = load_word_lanes<8>(PM, lanes, count, PM_vals);
+    flag_word_lanes_avx512(PM_vals, max_len, lanes, count);
+}
+
+#endif
+
+/**
+ * @brief flag similar characters of multiple texts with the same pattern at
+ * once. This replaces the serial dependency chain of
+ * flag_similar_characters_word with independent SIMD lanes.
+ */
+template <typename PM_Vec, typename InputIt1, typename InputIt2>
+static inline void flag_similar_characters_word_lanes(const PM_Vec& PM,
+                                                      WordLane<InputIt1, InputIt2>* lanes,
+                                                      int64_t count)
+{
+#if JARO_WINKLER_X86_DISPATCH
+    if (count > 4 && intrinsics::cpu_supports_avx512()) {
+        flag_similar_characters_word_avx512(PM, lanes, count);
+        return;
+    }
+
+    if (intrinsics::cpu_supports_avx2()) {
+        for (int64_t i = 0; i < count; i += 4) {
+            flag_similar_characters_word_avx2(PM, lanes + i, std::min<int64_t>(count - i, 4));
+        }
+        return;
+    }
+#endif
+
+    flag_similar_characters_word_lanes_scalar(PM, lanes, count);
+}
+
+/**
+ * @brief Jaro similarity of a cached pattern with each text in [first, last)
+ *
+ * Pairs handled by the word kernel are collected and flagged in SIMD lanes,
+ * while all other pairs use the scalar implementation.
+ *
+ * @param score_cutoffs score_cutoff for each of the texts
+ * @param scores output with one element per text
+ * @param profile lane settings. Texts shorter than lane_min_length are
+ *   dominated by the per text overhead and use the scalar word kernel
+ */
+template <typename Policy = DefaultJaroPolicy, typename PM_Vec, typename InputIt1,
+          typename TextIt>
+void jaro_similarity_batch(const PM_Vec& PM, InputIt1 P_first, InputIt1 P_last, TextIt first,
+                           TextIt last, const double* score_cutoffs, double* scores,
+                           const TuningProfile& profile = get_tuning_profile())
+{
+    using InputIt2 = decltype(std::begin(*first));
+    int64_t P_len = std::distance(P_first, P_last);
+    int64_t lane_count = word_lane_count(profile);
+    int64_t lane_min_length = profile.lane_min_length;
+
+    WordLane<InputIt1, InputIt2> lanes[8];
+    int64_t lane_pos[8];
+    int64_t lane_T_len[8];
+    int64_t filled = 0;
+
+    auto flush = [&]() {
+        flag_similar_characters_word_lanes(PM, lanes, filled);
+
+        for (int64_t k = 0; k < filled; ++k) {
+            const auto& lane = lanes[k];
+            int64_t pos = lane_pos[k];
+            int64_t CommonChars = count_common_chars(lane.flagged);
+
+            if (!jaro_common_char_filter(P_len, lane_T_len[k], CommonChars, score_cutoffs[pos])) {
+                scores[pos] = 0.0;
+                continue;
+            }
+
+            int64_t Transpositions = count_transpositions(PM, lane.P_first, lane.P_last,
+                                                          lane.T_first, lane.T_last, lane.flagged);
+            double Sim =
+                jaro_calculate_similarity(P_len, lane_T_len[k], CommonChars, Transpositions);
+            scores[pos] = common::result_cutoff(Sim, score_cutoffs[pos]);
+        }
+        filled = 0;
+    };
+
+    int64_t pos = 0;
+    for (; first != last; ++first, ++pos) {
+        InputIt2 T_first = std::begin(*first);
+        InputIt2 T_last = std::end(*first);
+        int64_t T_len = std::distance(T_first, T_last);
+        double score_cutoff = score_cutoffs[pos];
+
+        if (!lane_count || T_len < lane_min_length ||
+            !jaro_length_filter(P_len, T_len, score_cutoff))
+        {
+            scores[pos] =
+                detail::jaro_similarity<Policy>(PM, P_first, P_last, T_first, T_last, score_cutoff);
+            continue;
+        }
+
+        InputIt1 P_view_last = P_last;
+        InputIt2 T_view_last = T_last;
+        int64_t Bound = jaro_bounds<Policy>(P_first, P_view_last, T_first, T_view_last);
+        if (std::distance(P_first, P_view_last) > 64 || std::distance(T_first, T_view_last) > 64) {
+            scores[pos] =
+                detail::jaro_similarity<Policy>(PM, P_first, P_last, T_first, T_last, score_cutoff);
+            continue;
+        }
+
+        lanes[filled] = {P_first, P_view_last, T_first, T_view_last, Bound, {0, 0}};
+        lane_pos[filled] = pos;
+        lane_T_len[filled] = T_len;
+        if (++filled == lane_count) flush();
+    }
+
+    if (filled) flush();
+}
+
+/**
+ * @brief Jaro similarity of a cached pattern with each text in [first, last)
+ */
+template <typename Policy = DefaultJaroPolicy, typename PM_Vec, typename InputIt1,
+          typename TextIt>
+void jaro_similarity_batch(const PM_Vec& PM, InputIt1 P_first, InputIt1 P_last, TextIt first,
+                           TextIt last, double score_cutoff, double* scores,
+                           const TuningProfile& profile = get_tuning_profile())
+{
+    double score_cutoffs[64];
+    std::fill(std::begin(score_cutoffs), std::end(score_cutoffs), score_cutoff);
+
+    while (first != last) {
+        TextIt chunk_first = first;
+        int64_t count = 0;
+        for (; count < 64 && first != last; ++first, ++count) {}
+
+        jaro_similarity_batch<Policy>(PM, P_first, P_last, chunk_first, first, score_cutoffs,
+                                      scores, profile);
+        scores += count;
+    }
+}
+
+/**
+ * @brief Jaro-Winkler similarity of a cached pattern with each text in [first, last)
+ */
+template <typename Policy = DefaultJaroPolicy, typename PM_Vec, typename InputIt1,
+          typename TextIt>
+void jaro_winkler_similarity_batch(const PM_Vec& PM, InputIt1 P_first, InputIt1 P_last,
+                                   TextIt first, TextIt last, double prefix_weight,
+                                   double score_cutoff, double* scores)
+{
+    double score_cutoffs[64];
+    int64_t prefixes[64];
+
+    while (first != last) {
+        TextIt chunk_first = first;
+        int64_t count = 0;
+        for (; count < 64 && first != last; ++first, ++count) {
+            prefixes[count] = jaro_winkler_common_prefix<Policy>(P_first, P_last,
+                                                                 std::begin(*first),
+                                                                 std::end(*first));
+            score_cutoffs[count] =
+                jaro_winkler_jaro_cutoff<Policy>(prefixes[count], prefix_weight, score_cutoff);
+        }
+
+        jaro_similarity_batch<Policy>(PM, P_first, P_last, chunk_first, first, score_cutoffs,
+                                      scores);
+        for (int64_t i = 0; i < count; ++i) {
+            double Sim = jaro_winkler_apply_prefix<Policy>(scores[i], prefixes[i], prefix_weight);
+            scores[i] = common::result_cutoff(Sim, score_cutoff);
+        }
+        scores += count;
+    }
+}
+
+/**
+ * @brief load the lanes of pairs, where every lane has its own pattern
+ *
+ * The pattern match vector of a pair is only needed to look up the characters
+ * of its text, so all lanes share a single scratch vector, which is cleared
+ * again after every lane. Positions after the end of a text are set to 0.
+ *
+ * @return length of the longest text
+ */
+template <int64_t Lanes, typename InputIt1, typename InputIt2>
+static inline int64_t load_pair_lanes(const WordLane<InputIt1, InputIt2>* lanes, int64_t count,
+                                      uint64_t (*PM_vals)[Lanes])
+{
+    int64_t max_len = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        max_len = std::max<int64_t>(max_len, std::distance(lanes[i].T_first, lanes[i].T_last));
+    }
+
+    for (int64_t i = 0; i < Lanes; ++i) {
+        int64_t j = 0;
+        if (i < count) {
+            ScratchPatternMatchVector<uint64_t, InputIt1> scratch(lanes[i].P_first,
+                                                                  lanes[i].P_last);
+            InputIt2 T_first = lanes[i].T_first;
+            int64_t T_len = std::distance(T_first, lanes[i].T_last);
+            for (; j < T_len; ++j) {
+                PM_vals[j][i] = scratch.PM.get(T_first[j]);
+            }
+        }
+
+        for (; j < max_len; ++j) {
+            PM_vals[j][i] = 0;
+        }
+    }
+
+    return max_len;
+}
+
+#if JARO_WINKLER_X86_DISPATCH
+
+template <typename InputIt1, typename InputIt2>
+struct use_pair_byte_compare {
+    using CharT1 = typename std::iterator_traits<InputIt1>::value_type;
+    using CharT2 = typename std::iterator_traits<InputIt2>::value_type;
+    static constexpr bool value = sizeof(CharT1) == 1 && std::is_same<CharT1, CharT2>::value;
+};
+
+/**
+ * @brief load_pair_lanes for 8 bit characters. Instead of building a pattern
+ * match vector, every character of the text is compared with the whole
+ * pattern at once, which is cheaper for the short patterns of a single pair.
+ */
+template <int64_t Lanes, typename InputIt1, typename InputIt2>
+JARO_WINKLER_TARGET("avx2")
+static inline typename std::enable_if<use_pair_byte_compare<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+load_pair_lanes_avx2(const WordLane<InputIt1, InputIt2>* lanes, int64_t count,
+                     uint64_t (*PM_vals)[Lanes])
+{
+    int64_t max_len = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        max_len = std::max<int64_t>(max_len, std::distance(lanes[i].T_first, lanes[i].T_last));
+    }
+
+    for (int64_t i = 0; i < Lanes; ++i) {
+        int64_t j = 0;
+        if (i < count) {
+            alignas(32) uint8_t P_bytes[64] = {};
+            int64_t P_len = std::distance(lanes[i].P_first, lanes[i].P_last);
+            for (int64_t k = 0; k < P_len; ++k) {
+                P_bytes[k] = static_cast<uint8_t>(lanes[i].P_first[k]);
+            }
+
+            /* the zero padding after the pattern is masked out */
+            uint64_t P_mask = intrinsics::bit_mask_lsb<uint64_t>(static_cast<int>(P_len));
+            __m256i P_low = _mm256_load_si256(reinterpret_cast<const __m256i*>(P_bytes));
+            __m256i P_high = _mm256_load_si256(reinterpret_cast<const __m256i*>(P_bytes + 32));
+            InputIt2 T_first = lanes[i].T_first;
+            int64_t T_len = std::distance(T_first, lanes[i].T_last);
+
+            if (P_len <= 32) {
+                for (; j < T_len; ++j) {
+                    __m256i ch = _mm256_set1_epi8(static_cast<char>(T_first[j]));
+                    auto low = static_cast<uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(P_low, ch)));
+                    PM_vals[j][i] = low & P_mask;
+                }
+            }
+            else {
+                for (; j < T_len; ++j) {
+                    __m256i ch = _mm256_set1_epi8(static_cast<char>(T_first[j]));
+                    auto low = static_cast<uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(P_low, ch)));
+                    auto high = static_cast<uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(P_high, ch)));
+                    PM_vals[j][i] = ((static_cast<uint64_t>(high) << 32) | low) & P_mask;
+                }
+            }
+        }
+
+        for (; j < max_len; ++j) {
+            PM_vals[j][i] = 0;
+        }
+    }
+
+    return max_len;
+}
+
+template <int64_t Lanes, typename InputIt1, typename InputIt2>
+static inline typename std::enable_if<!use_pair_byte_compare<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+load_pair_lanes_avx2(const WordLane<InputIt1, InputIt2>* lanes, int64_t count,
+                     uint64_t (*PM_vals)[Lanes])
+{
+    return load_pair_lanes<Lanes>(lanes, count, PM_vals);
+}
+
+#endif
+
+/**
+ * @brief flag the lanes using the pattern match vectors loaded into PM_vals
+ * without SIMD. The lanes are still processed in an interleaved way, so the
+ * dependency chains of the lanes overlap.
+ */
+template <int64_t Lanes, typename InputIt1, typename InputIt2>
+static inline void flag_word_lanes_scalar(const uint64_t (*PM_vals)[Lanes], int64_t max_len,
+                                          WordLane<InputIt1, InputIt2>* lanes, int64_t count)
+{
+    using namespace intrinsics;
+    int64_t Bound[Lanes] = {};
+    uint64_t BoundMask[Lanes] = {};
+    uint64_t P_flag[Lanes] = {};
+    uint64_t T_flag[Lanes] = {};
+    for (int64_t i = 0; i < count; ++i) {
+        Bound[i] = lanes[i].Bound;
+        BoundMask[i] = bit_mask_lsb<uint64_t>(static_cast<int>(Bound[i]) + 1);
+    }
+
+    for (int64_t j = 0; j < max_len; ++j) {
+        for (int64_t i = 0; i < Lanes; ++i) {
+            uint64_t PM_j = PM_vals[j][i] & BoundMask[i] & ~P_flag[i];
+            P_flag[i] |= blsi(PM_j);
+            T_flag[i] |= static_cast<uint64_t>(PM_j != 0) << j;
+            BoundMask[i] = (BoundMask[i] << 1) | static_cast<uint64_t>(j < Bound[i]);
+        }
+    }
+
+    for (int64_t i = 0; i < count; ++i) {
+        lanes[i].flagged = {P_flag[i], T_flag[i]};
+    }
+}
+
+/**
+ * @brief flag similar characters of multiple pairs at once. Unlike
+ * flag_similar_characters_word_lanes every lane has its own pattern.
+ */
+template <typename InputIt1, typename InputIt2>
+static inline void flag_similar_characters_pair_lanes(WordLane<InputIt1, InputIt2>* lanes,
+                                                      int64_t count)
+{
+#if JARO_WINKLER_X86_DISPATCH
+    if (count > 4 && intrinsics::cpu_supports_avx512()) {
+        alignas(64) uint64_t PM_vals[64][8];
+        int64_t max_len = load_pair_lanes_avx2<8>(lanes, count, PM_vals);
+        flag_word_lanes_avx512(PM_vals, max_len, lanes, count);
+        return;
+    }
+
+    if (intrinsics::cpu_supports_avx2()) {
+        alignas(32) uint64_t PM_vals[64][4];
+        for (int64_t i = 0; i < count; i += 4) {
+            int64_t lane_count = std::min<int64_t>(count - i, 4);
+            int64_t max_len = load_pair_lanes_avx2<4>(lanes + i, lane_count, PM_vals);
+            flag_word_lanes_avx2(PM_vals, max_len, lanes + i, lane_count);
+        }
+        return;
+    }
+#endif
+
+    uint64_t PM_vals[64][4];
+    for (int64_t i = 0; i < count; i += 4) {
+        int64_t lane_count = std::min<int64_t>(count - i, 4);
+        int64_t max_len = load_pair_lanes<4>(lanes + i, lane_count, PM_vals);
+        flag_word_lanes_scalar<4>(PM_vals, max_len, lanes + i, lane_count);
+    }
+}
+
+/**
+ * @brief count the transpositions of a pair flagged in a lane. The pattern
+ * match vector is no longer available, so the characters are compared
+ * directly, using the same character mapping as the pattern match vectors.
+ */
+template <typename InputIt1, typename InputIt2>
+static inline int64_t count_transpositions_pair_scalar(InputIt1 P_first, InputIt2 T_first,
+                                                       const FlaggedCharsWord& flagged)
+{
+    using namespace intrinsics;
+    uint64_t P_flag = flagged.P_flag;
+    uint64_t T_flag = flagged.T_flag;
+    int64_t Transpositions = 0;
+    while (T_flag) {
+        Transpositions += static_cast<uint64_t>(P_first[tzcnt(P_flag)]) !=
+                          static_cast<uint64_t>(T_first[tzcnt(T_flag)]);
+        T_flag = blsr(T_flag);
+        P_flag = blsr(P_flag);
+    }
+
+    return Transpositions;
+}
+
+template <typename InputIt1, typename InputIt2>
+static inline typename std::enable_if<use_transpositions_bmi2<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+count_transpositions_pair(InputIt1 P_first, InputIt1 P_last, InputIt2 T_first, InputIt2 T_last,
+                          const FlaggedCharsWord& flagged)
+{
+#if JARO_WINKLER_HAS_PEXT
+    if (intrinsics::cpu_supports_fast_pext()) {
+        return count_transpositions_word_bmi2(P_first, P_last, T_first, T_last, flagged);
+    }
+#endif
+    return count_transpositions_pair_scalar(P_first, T_first, flagged);
+}
+
+template <typename InputIt1, typename InputIt2>
+static inline typename std::enable_if<!use_transpositions_bmi2<InputIt1, InputIt2>::value,
+                                      int64_t>::type
+count_transpositions_pair(InputIt1 P_first, InputIt1, InputIt2 T_first, InputIt2,
+                          const FlaggedCharsWord& flagged)
+{
+    return count_transpositions_pair_scalar(P_first, T_first, flagged);
+}
+
+/**
+ * @brief Jaro similarity of the pairs (P[indices[k]], T[indices[k]])
+ *
+ * Every pair has its own pattern. Pairs, which fit into the word kernel, are
+ * flagged in lanes, while short pairs and pairs requiring the block kernel use
+ * the scalar implementation. Sorting the indices by length beforehand keeps
+ * the lanes similarly long.
+ *
+ * @param score_cutoffs score_cutoff for each of the pairs
+ * @param scores output with one element per pair
+ */
+template <typename Policy = DefaultJaroPolicy, typename PatternIt, typename TextIt>
+void jaro_similarity_pairs(PatternIt P, TextIt T, const int64_t* indices, int64_t count,
+                           const double* score_cutoffs, double* scores)
+{
+    using InputIt1 = decltype(std::begin(*P));
+    using InputIt2 = decltype(std::begin(*T));
+    TuningProfile profile = get_tuning_profile();
+    int64_t lane_count = word_lane_count(profile);
+    int64_t lane_min_length = profile.lane_min_length;
+
+    WordLane<InputIt1, InputIt2> lanes[8];
+    int64_t lane_pos[8];
+    int64_t lane_P_len[8];
+    int64_t lane_T_len[8];
+    int64_t filled = 0;
+
+    auto flush = [&]() {
+        flag_similar_characters_pair_lanes(lanes, filled);
+
+        for (int64_t k = 0; k < filled; ++k) {
+            const auto& lane = lanes[k];
+            int64_t pos = lane_pos[k];
+            int64_t CommonChars = count_common_chars(lane.flagged);
+
+            if (!jaro_common_char_filter(lane_P_len[k], lane_T_len[k], CommonChars,
+                                         score_cutoffs[pos]))
+            {
+                scores[pos] = 0.0;
+                continue;
+            }
+
+            int64_t Transpositions = count_transpositions_pair(lane.P_first, lane.P_last,
+                                                               lane.T_first, lane.T_last,
+                                                               lane.flagged);
+            double Sim = jaro_calculate_similarity(lane_P_len[k], lane_T_len[k], CommonChars,
+                                                   Transpositions);
+            scores[pos] = common::result_cutoff(Sim, score_cutoffs[pos]);
+        }
+        filled = 0;
+    };
+
+    for (int64_t pos = 0; pos < count; ++pos) {
+        auto&& s1 = P[indices[pos]];
+        auto&& s2 = T[indices[pos]];
+        InputIt1 P_first = std::begin(s1);
+        InputIt1 P_last = std::end(s1);
+        InputIt2 T_first = std::begin(s2);
+        InputIt2 T_last = std::end(s2);
+        int64_t P_len = std::distance(P_first, P_last);
+        int64_t T_len = std::distance(T_first, T_last);
+        double score_cutoff = score_cutoffs[pos];
+
+        if (!lane_count || std::max(P_len, T_len) < lane_min_length ||
+            !jaro_length_filter(P_len, T_len, score_cutoff))
+        {
+            scores[pos] =
+                detail::jaro_similarity<Policy>(P_first, P_last, T_first, T_last, score_cutoff);
+            continue;
+        }
+
+        InputIt1 P_view_last = P_last;
+        InputIt2 T_view_last = T_last;
+        int64_t Bound = jaro_bounds<Policy>(P_first, P_view_last, T_first, T_view_last);
+        if (std::distance(P_first, P_view_last) > 64 || std::distance(T_first, T_view_last) > 64) {
+            scores[pos] =
+                detail::jaro_similarity<Policy>(P_first, P_last, T_first, T_last, score_cutoff);
+            continue;
+        }
+
+        lanes[filled] = {P_first, P_view_last, T_first, T_view_last, Bound, {0, 0}};
+        lane_pos[filled] = pos;
+        lane_P_len[filled] = P_len;
+        lane_T_len[filled] = T_len;
+        if (++filled == lane_count) flush();
+    }
+
+    if (filled) flush();
+}
+
+} // namespace detail
+} // namespace jaro_winkler
@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/parallel.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#    include <sched.h>
+#    define JARO_WINKLER_HAS_NUMA 1
+#else
+#    define JARO_WINKLER_HAS_NUMA 0
+#endif
+
+namespace jaro_winkler {
+namespace common {
+
+/**
+ * @brief parse a cpu list in the format used by sysfs like "0-3,8-11"
+ */
+static inline std::vector<int> parse_cpu_list(const std::string& list)
+{
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+
+        int first = 0;
+        int last = 0;
+        int fields = std::sscanf(list.substr(pos, end - pos).c_str(), "%d-%d", &first, &last);
+        if (fields == 1) last = first;
+        if (fields >= 1) {
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+/**
+ * @brief cpus of the NUMA nodes, which the process is allowed to run on.
+ * Nodes without any of these cpus are left out, so on systems without NUMA
+ * support this has a single node.
+ */
+struct NumaTopology {
+    std::vector<std::vector<int>> node_cpus;
+
+    size_t nodes() const
+    {
+        return node_cpus.size();
+    }
+
+    static const NumaTopology& get()
+    {
+        static const NumaTopology topology = detect();
+        return topology;
+    }
+
+private:
+    static std::string read_line(const std::string& path)
+    {
+        std::string line;
+        if (std::FILE* file = std::fopen(path.c_str(), "r")) {
+            char buffer[4096];
+            if (std::fgets(buffer, sizeof(buffer), file)) line = buffer;
+            std::fclose(file);
+        }
+        return line;
+    }
+
+    static NumaTopology detect()
+    {
+        NumaTopology topology;
+#if JARO_WINKLER_HAS_NUMA
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return topology;
+
+        for (int node : parse_cpu_list(read_line("/sys/devices/system/node/online"))) {
+            std::vector<int> cpus;
+            for (int cpu : parse_cpu_list(read_line("/sys/devices/system/node/node" +
+                                                    std::to_string(node) + "/cpulist")))
+            {
+                if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty()) topology.node_cpus.push_back(cpus);
+        }
+#endif
+        return topology;
+    }
+};
+
+/**
+ * @brief restricts the current thread to a set of cpus and restores the
+ * previous affinity on destruction. Threads started in the meantime inherit
+ * the restriction. Failures are ignored, since this only affects performance.
+ */
+class ScopedThreadAffinity {
+public:
+    explicit ScopedThreadAffinity(const std::vector<int>& cpus)
+    {
+#if JARO_WINKLER_HAS_NUMA
+        CPU_ZERO(&m_prev);
+        m_restore = sched_getaffinity(0, sizeof(m_prev), &m_prev) == 0;
+
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &mask);
+        }
+        if (CPU_COUNT(&mask)) sched_setaffinity(0, sizeof(mask), &mask);
+#else
+        (void)cpus;
+#endif
+    }
+
+    ScopedThreadAffinity(const ScopedThreadAffinity&) = delete;
+    ScopedThreadAffinity& operator=(const ScopedThreadAffinity&) = delete;
+
+    ~ScopedThreadAffinity()
+    {
+#if JARO_WINKLER_HAS_NUMA
+        if (m_restore) sched_setaffinity(0, sizeof(m_prev), &m_prev);
+#endif
+    }
+
+private:
+#if JARO_WINKLER_HAS_NUMA
+    cpu_set_t m_prev;
+    bool m_restore;
+#endif
+};
+
+/**
+ * @brief split the range [0, count) between the NUMA nodes of topology
+ *
+ * The workers are distributed between the nodes based on their number of
+ * cpus and every node receives a share of the range matching its number of
+ * workers. func(begin, end, workers) is called for every node on a thread
+ * pinned to the cpus of the node, so threads started by func and memory
+ * first touched by them stay on the node as well. With a single node
+ * func(0, count, workers) is called on the calling thread.
+ */
+template <typename Func>
+void parallel_for_nodes(const NumaTopology& topology, int64_t count, int64_t workers, Func func)
+{
+    workers = resolve_workers(workers);
+    int64_t nodes = std::min({static_cast<int64_t>(topology.nodes()), workers, count});
+    if (nodes <= 1) {
+        func(int64_t(0), count, workers);
+        return;
+    }
+
+    int64_t total_cpus = 0;
+    for (int64_t node = 0; node < nodes; ++node) {
+        total_cpus += static_cast<int64_t>(topology.node_cpus[static_cast<size_t>(node)].size());
+    }
+
+    /* every node gets at least one worker and the remaining workers are
+     * distributed based on the number of cpus */
+    std::vector<int64_t> node_workers(static_cast<size_t>(nodes), 1);
+    int64_t spare = workers - nodes;
+    int64_t assigned = 0;
+    for (int64_t node = 0; node < nodes; ++node) {
+        int64_t cpus = static_cast<int64_t>(topology.node_cpus[static_cast<size_t>(node)].size());
+        int64_t share = (node == nodes - 1) ? spare - assigned : spare * cpus / total_cpus;
+        node_workers[static_cast<size_t>(node)] += share;
+        assigned += share;
+    }
+
+    std::vector<int64_t> node_begin(static_cast<size_t>(nodes) + 1, 0);
+    int64_t worker_sum = 0;
+    for (int64_t node = 0; node < nodes; ++node) {
+        worker_sum += node_workers[static_cast<size_t>(node)];
+        node_begin[static_cast<size_t>(node) + 1] = count * worker_sum / workers;
+    }
+
+    parallel_for(nodes, nodes, [&](int64_t first, int64_t last) {
+        for (int64_t node = first; node < last; ++node) {
+            size_t idx = static_cast<size_t>(node);
+            ScopedThreadAffinity affinity(topology.node_cpus[idx]);
+            func(node_begin[idx], node_begin[idx + 1], node_workers[idx]);
+        }
+    });
+}
+
+template <typename Func>
+void parallel_for_nodes(int64_t count, int64_t workers, Func func)
+{
+    parallel_for_nodes(NumaTopology::get(), count, workers, func);
+}
+
+} // namespace common
+} // namespace jaro_winkler
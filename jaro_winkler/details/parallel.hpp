@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/common.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace jaro_winkler {
+namespace common {
+
+/**
+ * @brief number of worker threads to use for a requested worker count.
+ * A worker count <= 0 selects the number of hardware threads.
+ */
+static inline int64_t resolve_workers(int64_t workers)
+{
+    if (workers > 0) return workers;
+
+    int64_t hw = static_cast<int64_t>(std::thread::hardware_concurrency());
+    return std::max<int64_t>(hw, 1);
+}
+
+/**
+ * @brief split the range [0, count) into contiguous chunks and call
+ * func(begin, end) for each of them on up to workers threads. The calling
+ * thread processes the first chunk itself. The first exception thrown by
+ * any of the chunks is rethrown once all threads finished.
+ */
+template <typename Func>
+void parallel_for(int64_t count, int64_t workers, Func func)
+{
+    workers = std::min(resolve_workers(workers), std::max<int64_t>(count, 1));
+    if (workers <= 1) {
+        func(int64_t(0), count);
+        return;
+    }
+
+    int64_t chunk = ceildiv(count, workers);
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> exceptions(static_cast<size_t>(workers));
+    threads.reserve(static_cast<size_t>(workers - 1));
+
+    try {
+        for (int64_t begin = chunk; begin < count; begin += chunk) {
+            int64_t end = std::min(begin + chunk, count);
+            std::exception_ptr* exception = &exceptions[static_cast<size_t>(begin / chunk)];
+            threads.emplace_back([&func, begin, end, exception]() {
+                try {
+                    func(begin, end);
+                }
+                catch (...) {
+                    *exception = std::current_exception();
+                }
+            });
+        }
+        func(int64_t(0), std::min(chunk, count));
+    }
+    catch (...) {
+        exceptions[0] = std::current_exception();
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& exception : exceptions) {
+        if (exception) std::rethrow_exception(exception);
+    }
+}
+
+} // namespace common
+} // namespace jaro_winkler
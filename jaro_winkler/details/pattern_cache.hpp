@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/common.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace jaro_winkler {
+
+namespace detail {
+
+/**
+ * settings of the pattern cache of the current thread. The caches for the
+ * different character types register a function to clear them, so all of them
+ * can be released when caching is disabled again.
+ */
+struct PatternCacheState {
+    size_t capacity = 0;
+    int64_t max_pattern_length = 0;
+    std::vector<void (*)()> clear_functions;
+
+    static PatternCacheState& get()
+    {
+        static thread_local PatternCacheState state;
+        return state;
+    }
+
+    void clear_all()
+    {
+        for (auto clear : clear_functions) {
+            clear();
+        }
+    }
+};
+
+/**
+ * least recently used cache of the pattern match vectors built by the
+ * uncached scorers on the current thread
+ */
+template <typename CharT>
+struct PatternCache {
+    struct Entry {
+        uint64_t hash;
+        uint64_t last_use;
+        std::basic_string<CharT> pattern;
+        common::BlockPatternMatchVector PM;
+    };
+
+    /**
+     * @brief pattern match vector for [first, last) or nullptr, when caching
+     * is disabled on this thread or the pattern is too long. The returned
+     * pointer is only valid until the next call on the same thread.
+     */
+    template <typename InputIt>
+    static const common::BlockPatternMatchVector* lookup(InputIt first, InputIt last)
+    {
+        PatternCacheState& state = PatternCacheState::get();
+        if (!state.capacity) return nullptr;
+
+        int64_t len = std::distance(first, last);
+        if (len > state.max_pattern_length) return nullptr;
+
+        PatternCache& cache = instance();
+        uint64_t hash = hash_pattern(first, last);
+        uint64_t now = ++cache.m_clock;
+        for (auto& entry : cache.m_entries) {
+            if (entry.hash == hash && static_cast<int64_t>(entry.pattern.size()) == len &&
+                std::equal(first, last, entry.pattern.begin()))
+            {
+                entry.last_use = now;
+                return &entry.PM;
+            }
+        }
+
+        Entry entry = {hash, now, std::basic_string<CharT>(first, last),
+                       common::BlockPatternMatchVector(first, last)};
+        if (cache.m_entries.size() < state.capacity) {
+            cache.m_entries.push_back(std::move(entry));
+            return &cache.m_entries.back().PM;
+        }
+
+        auto lru = std::min_element(
+            cache.m_entries.begin(), cache.m_entries.end(),
+            [](const Entry& a, const Entry& b) { return a.last_use < b.last_use; });
+        *lru = std::move(entry);
+        return &lru->PM;
+    }
+
+    static size_t size()
+    {
+        return instance().m_entries.size();
+    }
+
+private:
+    static PatternCache& instance()
+    {
+        static thread_local PatternCache cache;
+        if (!cache.m_registered) {
+            PatternCacheState::get().clear_functions.push_back(&PatternCache::clear);
+            cache.m_registered = true;
+        }
+        return cache;
+    }
+
+    static void clear()
+    {
+        /* swap with an empty vector to release the memory */
+        std::vector<Entry>().swap(instance().m_entries);
+    }
+
+    /* FNV-1a over the character values */
+    template <typename InputIt>
+    static uint64_t hash_pattern(InputIt first, InputIt last)
+    {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (; first != last; ++first) {
+            hash ^= static_cast<uint64_t>(*first);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
+    std::vector<Entry> m_entries;
+    uint64_t m_clock = 0;
+    bool m_registered = false;
+};
+
+} // namespace detail
+
+/**
+ * @brief enables a thread local cache of pattern match vectors for the free
+ * functions jaro_similarity and jaro_winkler_similarity on the current thread
+ *
+ * Code calling the free functions in a loop, in which s1 repeats, gets close
+ * to the performance of the cached scorers without holding on to them. The
+ * cache keeps up to `capacity` patterns and only caches patterns of up to
+ * `max_pattern_length` characters, which bounds the memory usage to roughly
+ * capacity * ceil(max_pattern_length / 64) * 4 KB per character type. When the
+ * object is destroyed the previous settings are restored and the cached
+ * patterns of the thread are released.
+ *
+ * Caching does not change any results.
+ */
+class ScopedPatternCache {
+public:
+    explicit ScopedPatternCache(size_t capacity = 16, int64_t max_pattern_length = 256)
+    {
+        detail::PatternCacheState& state = detail::PatternCacheState::get();
+        m_prev_capacity = state.capacity;
+        m_prev_max_pattern_length = state.max_pattern_length;
+        state.clear_all();
+        state.capacity = capacity;
+        state.max_pattern_length = max_pattern_length;
+    }
+
+    ScopedPatternCache(const ScopedPatternCache&) = delete;
+    ScopedPatternCache& operator=(const ScopedPatternCache&) = delete;
+
+    ~ScopedPatternCache()
+    {
+        detail::PatternCacheState& state = detail::PatternCacheState::get();
+        state.clear_all();
+        state.capacity = m_prev_capacity;
+        state.max_pattern_length = m_prev_max_pattern_length;
+    }
+
+private:
+    size_t m_prev_capacity;
+    int64_t m_prev_max_pattern_length;
+};
+
+} // namespace jaro_winkler
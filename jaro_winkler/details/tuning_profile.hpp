@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+namespace jaro_winkler {
+
+/**
+ * @brief host specific thresholds used by the bulk APIs
+ *
+ * The defaults work well on recent x86 processors. autotune() in
+ * jaro_winkler/tuning.hpp measures better values for the current host,
+ * which can be saved and activated using set_tuning_profile().
+ */
+struct TuningProfile {
+    /* texts shorter than this are compared using the scalar word kernel
+     * instead of SIMD lanes */
+    int64_t lane_min_length = 24;
+    /* maximum number of texts flagged at once (4 for AVX2, 8 for AVX-512).
+     * 0 disables the SIMD lanes */
+    int64_t max_lanes = 8;
+    /* cache budgets in bytes used to select the default cdist tile sizes */
+    int64_t tile_l1_budget = 16 * 1024;
+    int64_t tile_l2_budget = 128 * 1024;
+
+    /**
+     * @brief throws std::invalid_argument for values outside of the
+     * supported range
+     */
+    void validate() const
+    {
+        if (lane_min_length < 0) throw std::invalid_argument("lane_min_length can't be negative");
+        if (max_lanes < 0 || max_lanes > 8) {
+            throw std::invalid_argument("max_lanes has to be between 0 and 8");
+        }
+        if (tile_l1_budget <= 0 || tile_l2_budget <= 0) {
+            throw std::invalid_argument("tile budgets have to be positive");
+        }
+    }
+};
+
+namespace detail {
+
+/* active profile. The fields are stored separately, so they can be read by
+ * the bulk APIs while another thread activates a new profile */
+struct TuningProfileStorage {
+    std::atomic<int64_t> lane_min_length;
+    std::atomic<int64_t> max_lanes;
+    std::atomic<int64_t> tile_l1_budget;
+    std::atomic<int64_t> tile_l2_budget;
+
+    explicit TuningProfileStorage(const TuningProfile& profile)
+        : lane_min_length(profile.lane_min_length),
+          max_lanes(profile.max_lanes),
+          tile_l1_budget(profile.tile_l1_budget),
+          tile_l2_budget(profile.tile_l2_budget)
+    {}
+
+    static TuningProfileStorage& get()
+    {
+        static TuningProfileStorage storage{TuningProfile()};
+        return storage;
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief profile currently used by the bulk APIs
+ */
+static inline TuningProfile get_tuning_profile()
+{
+    const auto& storage = detail::TuningProfileStorage::get();
+    TuningProfile profile;
+    profile.lane_min_length = storage.lane_min_length.load(std::memory_order_relaxed);
+    profile.max_lanes = storage.max_lanes.load(std::memory_order_relaxed);
+    profile.tile_l1_budget = storage.tile_l1_budget.load(std::memory_order_relaxed);
+    profile.tile_l2_budget = storage.tile_l2_budget.load(std::memory_order_relaxed);
+    return profile;
+}
+
+/**
+ * @brief activate a profile for all threads. Calls running at the same time
+ * may still use values of the previous profile. The profile only changes the
+ * performance and never the results.
+ */
+static inline void set_tuning_profile(const TuningProfile& profile)
+{
+    profile.validate();
+
+    auto& storage = detail::TuningProfileStorage::get();
+    storage.lane_min_length.store(profile.lane_min_length, std::memory_order_relaxed);
+    storage.max_lanes.store(profile.max_lanes, std::memory_order_relaxed);
+    storage.tile_l1_budget.store(profile.tile_l1_budget, std::memory_order_relaxed);
+    storage.tile_l2_budget.store(profile.tile_l2_budget, std::memory_order_relaxed);
+}
+
+} // namespace jaro_winkler
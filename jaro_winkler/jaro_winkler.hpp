@@ -4,6 +4,10 @@
 #pragma once
 #include <jaro_winkler/details/common.hpp>
 #include <jaro_winkler/details/jaro_impl.hpp>
+#include <jaro_winkler/details/jaro_simd.hpp>
+#include <jaro_winkler/details/parallel.hpp>
+#include <jaro_winkler/details/pattern_cache.hpp>
+#include <jaro_winkler/processor.hpp>
 
 #include <stdexcept>
 
@@ -37,37 +41,43 @@ namespace jaro_winkler {
  * @return jaro winkler similarity between s1 and s2
  *   as a float between 0 and 100
  */
-template <typename InputIt1, typename InputIt2>
+template <typename Policy = DefaultJaroPolicy, typename InputIt1, typename InputIt2>
 typename std::enable_if<
     common::is_iterator<InputIt1>::value && common::is_iterator<InputIt2>::value, double>::type
 jaro_winkler_similarity(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
                         double prefix_weight = 0.1, double score_cutoff = 0.0)
 {
-    if (prefix_weight < 0.0 || prefix_weight > 0.25) {
-        throw std::invalid_argument("prefix_weight has to be between 0.0 and 0.25");
+    detail::validate_prefix_weight<Policy>(prefix_weight);
+
+    using CharT1 = typename std::iterator_traits<InputIt1>::value_type;
+    if (const auto* PM = detail::PatternCache<CharT1>::lookup(first1, last1)) {
+        return detail::jaro_winkler_similarity<Policy>(*PM, first1, last1, first2, last2,
+                                                       prefix_weight, score_cutoff);
     }
 
-    return detail::jaro_winkler_similarity(first1, last1, first2, last2, prefix_weight,
-                                           score_cutoff);
+    return detail::jaro_winkler_similarity<Policy>(first1, last1, first2, last2, prefix_weight,
+                                                   score_cutoff);
 }
 
-template <typename S1, typename S2>
+template <typename Policy = DefaultJaroPolicy, typename S1, typename S2>
 double jaro_winkler_similarity(const S1& s1, const S2& s2, double prefix_weight = 0.1,
                                double score_cutoff = 0.0)
 {
-    return jaro_winkler_similarity(std::begin(s1), std::end(s1), std::begin(s2), std::end(s2),
-                                   prefix_weight, score_cutoff);
+    return jaro_winkler_similarity<Policy>(std::begin(s1), std::end(s1), std::begin(s2),
+                                           std::end(s2), prefix_weight, score_cutoff);
 }
 
-template <typename CharT1>
+/**
+ * @tparam CharT1 character type of the cached string
+ * @tparam Policy match window and prefix parameters (see DefaultJaroPolicy)
+ */
+template <typename CharT1, typename Policy = DefaultJaroPolicy>
 struct CachedJaroWinklerSimilarity {
     template <typename InputIt1>
     CachedJaroWinklerSimilarity(InputIt1 first1, InputIt1 last1, double prefix_weight_ = 0.1)
         : s1(first1, last1), PM(first1, last1), prefix_weight(prefix_weight_)
     {
-        if (prefix_weight < 0.0 || prefix_weight > 0.25) {
-            throw std::invalid_argument("prefix_weight has to be between 0.0 and 0.25");
-        }
+        detail::validate_prefix_weight<Policy>(prefix_weight);
     }
 
     template <typename S1>
@@ -78,8 +88,8 @@ struct CachedJaroWinklerSimilarity {
     template <typename InputIt2>
     double similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
     {
-        return detail::jaro_winkler_similarity(PM, std::begin(s1), std::end(s1), first2, last2,
-                                               prefix_weight, score_cutoff);
+        return detail::jaro_winkler_similarity<Policy>(PM, std::begin(s1), std::end(s1), first2,
+                                                       last2, prefix_weight, score_cutoff);
     }
 
     template <typename S2>
@@ -100,6 +110,35 @@ struct CachedJaroWinklerSimilarity {
         return similarity(s2, score_cutoff);
     }
 
+    /**
+     * @brief similarity with each string in [first, last)
+     *
+     * Short strings are compared in SIMD lanes, so this is faster than
+     * calling similarity() for each of them.
+     *
+     * @param first iterator to the first string
+     * @param last past the end iterator of the strings
+     * @param scores output with space for one score per string
+     */
+    template <typename InputIt2>
+    void similarity_batch(InputIt2 first, InputIt2 last, double* scores,
+                          double score_cutoff = 0) const
+    {
+        detail::jaro_winkler_similarity_batch<Policy>(PM, std::begin(s1), std::end(s1), first,
+                                                      last, prefix_weight, score_cutoff, scores);
+    }
+
+    /**
+     * @brief upper bound of the similarity with any string of the length len
+     * sharing a common prefix of the length prefix with the cached string.
+     * Can be used to skip whole groups of strings with the same length.
+     */
+    double max_possible_score(int64_t len, int64_t prefix = Policy::max_prefix()) const
+    {
+        return detail::jaro_winkler_max_possible_score<Policy>(static_cast<int64_t>(s1.size()),
+                                                               len, prefix, prefix_weight);
+    }
+
 private:
     std::basic_string<CharT1> s1;
     common::BlockPatternMatchVector PM;
@@ -127,21 +166,32 @@ private:
  * @return jaro similarity between s1 and s2
  *   as a float between 0 and 100
  */
-template <typename InputIt1, typename InputIt2>
-double jaro_similarity(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
-                       double score_cutoff = 0.0)
+template <typename Policy = DefaultJaroPolicy, typename InputIt1, typename InputIt2>
+typename std::enable_if<
+    common::is_iterator<InputIt1>::value && common::is_iterator<InputIt2>::value, double>::type
+jaro_similarity(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
+                double score_cutoff = 0.0)
 {
-    return detail::jaro_similarity(first1, last1, first2, last2, score_cutoff);
+    using CharT1 = typename std::iterator_traits<InputIt1>::value_type;
+    if (const auto* PM = detail::PatternCache<CharT1>::lookup(first1, last1)) {
+        return detail::jaro_similarity<Policy>(*PM, first1, last1, first2, last2, score_cutoff);
+    }
+
+    return detail::jaro_similarity<Policy>(first1, last1, first2, last2, score_cutoff);
 }
 
-template <typename S1, typename S2>
+template <typename Policy = DefaultJaroPolicy, typename S1, typename S2>
 double jaro_similarity(const S1& s1, const S2& s2, double score_cutoff = 0.0)
 {
-    return jaro_similarity(std::begin(s1), std::end(s1), std::begin(s2), std::end(s2),
-                           score_cutoff);
+    return jaro_similarity<Policy>(std::begin(s1), std::end(s1), std::begin(s2), std::end(s2),
+                                   score_cutoff);
 }
 
-template <typename CharT1>
+/**
+ * @tparam CharT1 character type of the cached string
+ * @tparam Policy match window (see DefaultJaroPolicy)
+ */
+template <typename CharT1, typename Policy = DefaultJaroPolicy>
 struct CachedJaroSimilarity {
     template <typename InputIt1>
     CachedJaroSimilarity(InputIt1 first1, InputIt1 last1) : s1(first1, last1), PM(first1, last1)
@@ -154,8 +204,8 @@ struct CachedJaroSimilarity {
     template <typename InputIt2>
     double similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
     {
-        return detail::jaro_similarity(PM, std::begin(s1), std::end(s1), first2, last2,
-                                       score_cutoff);
+        return detail::jaro_similarity<Policy>(PM, std::begin(s1), std::end(s1), first2, last2,
+                                               score_cutoff);
     }
 
     template <typename S2>
@@ -176,11 +226,253 @@ struct CachedJaroSimilarity {
         return similarity(s2, score_cutoff);
     }
 
+    /**
+     * @brief similarity with each string in [first, last)
+     *
+     * @param first iterator to the first string
+     * @param last past the end iterator of the strings
+     * @param scores output with space for one score per string
+     */
+    template <typename InputIt2>
+    void similarity_batch(InputIt2 first, InputIt2 last, double* scores,
+                          double score_cutoff = 0) const
+    {
+        detail::jaro_similarity_batch<Policy>(PM, std::begin(s1), std::end(s1), first, last,
+                                              score_cutoff, scores);
+    }
+
+    /**
+     * @brief upper bound of the similarity with any string of the length len
+     */
+    double max_possible_score(int64_t len) const
+    {
+        return detail::jaro_max_possible_score(static_cast<int64_t>(s1.size()), len);
+    }
+
+    /**
+     * @brief the Jaro similarity does not depend on the common prefix. This
+     * overload only exists for symmetry with CachedJaroWinklerSimilarity
+     */
+    double max_possible_score(int64_t len, int64_t) const
+    {
+        return max_possible_score(len);
+    }
+
 private:
     std::basic_string<CharT1> s1;
     common::BlockPatternMatchVector PM;
 };
 
+namespace detail {
+
+/**
+ * @brief scoring interface shared by all collections of cached patterns.
+ * Derived has to provide pattern_begin(handle), pattern_end(handle) and
+ * pattern_view(handle), which returns the pattern match vector.
+ */
+template <typename Derived>
+struct PatternSetScoring {
+    using handle_type = size_t;
+
+    template <typename Policy = DefaultJaroPolicy, typename InputIt2>
+    typename std::enable_if<common::is_iterator<InputIt2>::value, double>::type
+    jaro_similarity(handle_type handle, InputIt2 first2, InputIt2 last2,
+                    double score_cutoff = 0) const
+    {
+        const Derived& self = derived();
+        return detail::jaro_similarity<Policy>(self.pattern_view(handle),
+                                               self.pattern_begin(handle),
+                                               self.pattern_end(handle), first2, last2,
+                                               score_cutoff);
+    }
+
+    template <typename Policy = DefaultJaroPolicy, typename S2>
+    double jaro_similarity(handle_type handle, const S2& s2, double score_cutoff = 0) const
+    {
+        return jaro_similarity<Policy>(handle, std::begin(s2), std::end(s2), score_cutoff);
+    }
+
+    template <typename Policy = DefaultJaroPolicy, typename InputIt2>
+    typename std::enable_if<common::is_iterator<InputIt2>::value, double>::type
+    jaro_winkler_similarity(handle_type handle, InputIt2 first2, InputIt2 last2,
+                            double prefix_weight = 0.1, double score_cutoff = 0) const
+    {
+        detail::validate_prefix_weight<Policy>(prefix_weight);
+
+        const Derived& self = derived();
+        return detail::jaro_winkler_similarity<Policy>(self.pattern_view(handle),
+                                                       self.pattern_begin(handle),
+                                                       self.pattern_end(handle), first2, last2,
+                                                       prefix_weight, score_cutoff);
+    }
+
+    template <typename Policy = DefaultJaroPolicy, typename S2>
+    double jaro_winkler_similarity(handle_type handle, const S2& s2, double prefix_weight = 0.1,
+                                   double score_cutoff = 0) const
+    {
+        return jaro_winkler_similarity<Policy>(handle, std::begin(s2), std::end(s2),
+                                               prefix_weight, score_cutoff);
+    }
+
+    /**
+     * @brief Jaro similarity of the pattern with each string in [first, last)
+     */
+    template <typename Policy = DefaultJaroPolicy, typename InputIt2>
+    void jaro_similarity_batch(handle_type handle, InputIt2 first, InputIt2 last, double* scores,
+                               double score_cutoff = 0) const
+    {
+        const Derived& self = derived();
+        detail::jaro_similarity_batch<Policy>(self.pattern_view(handle),
+                                              self.pattern_begin(handle),
+                                              self.pattern_end(handle), first, last,
+                                              score_cutoff, scores);
+    }
+
+    /**
+     * @brief Jaro-Winkler similarity of the pattern with each string in [first, last)
+     */
+    template <typename Policy = DefaultJaroPolicy, typename InputIt2>
+    void jaro_winkler_similarity_batch(handle_type handle, InputIt2 first, InputIt2 last,
+                                       double* scores, double prefix_weight = 0.1,
+                                       double score_cutoff = 0) const
+    {
+        detail::validate_prefix_weight<Policy>(prefix_weight);
+
+        const Derived& self = derived();
+        detail::jaro_winkler_similarity_batch<Policy>(self.pattern_view(handle),
+                                                      self.pattern_begin(handle),
+                                                      self.pattern_end(handle), first, last,
+                                                      prefix_weight, score_cutoff, scores);
+    }
+
+    /**
+     * @brief upper bound of the Jaro similarity of the pattern with any
+     * string of the length len
+     */
+    double jaro_max_possible_score(handle_type handle, int64_t len) const
+    {
+        return detail::jaro_max_possible_score(pattern_length(handle), len);
+    }
+
+    /**
+     * @brief upper bound of the Jaro-Winkler similarity of the pattern with
+     * any string of the length len sharing a common prefix of the length prefix
+     */
+    template <typename Policy = DefaultJaroPolicy>
+    double jaro_winkler_max_possible_score(handle_type handle, int64_t len,
+                                           int64_t prefix = Policy::max_prefix(),
+                                           double prefix_weight = 0.1) const
+    {
+        detail::validate_prefix_weight<Policy>(prefix_weight);
+        return detail::jaro_winkler_max_possible_score<Policy>(pattern_length(handle), len,
+                                                               prefix, prefix_weight);
+    }
+
+    int64_t pattern_length(handle_type handle) const
+    {
+        const Derived& self = derived();
+        return static_cast<int64_t>(
+            std::distance(self.pattern_begin(handle), self.pattern_end(handle)));
+    }
+
+private:
+    const Derived& derived() const
+    {
+        return static_cast<const Derived&>(*this);
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Pattern match vectors for a whole collection of strings
+ *
+ * Compared to a std::vector of CachedJaroWinklerSimilarity objects all strings
+ * and pattern match vectors are stored in a few contiguous arrays (structure
+ * of arrays), which requires far fewer allocations and improves cache
+ * locality when the patterns are scanned in order. Patterns are referenced
+ * using their index in the input collection, which stays stable for the
+ * lifetime of the slab.
+ *
+ * @tparam CharT1 character type of the stored strings
+ */
+template <typename CharT1>
+struct CachedPatternSlab : detail::PatternSetScoring<CachedPatternSlab<CharT1>> {
+    using handle_type = size_t;
+
+    /**
+     * @param first iterator to the first string of the collection
+     * @param last past the end iterator of the collection
+     * @param workers
+     *   number of threads used to build the pattern match vectors.
+     *   Values <= 0 use the number of hardware threads. Default is 1.
+     */
+    template <typename InputIt,
+              typename = typename std::enable_if<common::is_iterator<InputIt>::value>::type>
+    CachedPatternSlab(InputIt first, InputIt last, int64_t workers = 1)
+    {
+        size_t count = static_cast<size_t>(std::distance(first, last));
+        std::vector<int64_t> block_counts(count);
+        std::vector<bool> needs_map(count);
+        m_offsets.reserve(count + 1);
+        m_offsets.push_back(0);
+
+        size_t idx = 0;
+        for (; first != last; ++first, ++idx) {
+            for (const auto& ch : *first) {
+                if (!(ch >= 0 && ch <= 255)) needs_map[idx] = true;
+                m_chars.push_back(static_cast<CharT1>(ch));
+            }
+            m_offsets.push_back(static_cast<int64_t>(m_chars.size()));
+            block_counts[idx] = common::ceildiv(m_offsets[idx + 1] - m_offsets[idx], 64);
+        }
+
+        PM.allocate(block_counts, needs_map);
+        common::parallel_for(static_cast<int64_t>(count), workers,
+                             [this](int64_t begin, int64_t end) {
+                                 for (int64_t i = begin; i < end; ++i) {
+                                     size_t pos = static_cast<size_t>(i);
+                                     PM.insert(pos, pattern_begin(pos), pattern_end(pos));
+                                 }
+                             });
+    }
+
+    template <typename Sentences>
+    CachedPatternSlab(const Sentences& strings, int64_t workers = 1)
+        : CachedPatternSlab(std::begin(strings), std::end(strings), workers)
+    {}
+
+    size_t size() const
+    {
+        return PM.size();
+    }
+
+    const CharT1* pattern_begin(handle_type handle) const
+    {
+        return m_chars.data() + m_offsets[handle];
+    }
+
+    const CharT1* pattern_end(handle_type handle) const
+    {
+        return m_chars.data() + m_offsets[handle + 1];
+    }
+
+    common::BlockPatternMatchVectorView pattern_view(handle_type handle) const
+    {
+        return PM.view(handle);
+    }
+
+    const common::BlockPatternMatchVectorSlab& pattern_match_vectors() const
+    {
+        return PM;
+    }
+
+private:
+    std::vector<CharT1> m_chars;
+    std::vector<int64_t> m_offsets;
+    common::BlockPatternMatchVectorSlab PM;
+};
+
 /**@}*/
 
 } // namespace jaro_winkler
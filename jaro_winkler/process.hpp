@@ -0,0 +1,1186 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/dedup.hpp>
+#include <jaro_winkler/details/numa.hpp>
+#include <jaro_winkler/details/parallel.hpp>
+#include <jaro_winkler/jaro_winkler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(__has_include)
+#    if __has_include(<version>)
+#        include <version>
+#    endif
+#endif
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+#    define JARO_WINKLER_HAS_COROUTINES 1
+#    include <coroutine>
+#    include <exception>
+#else
+#    define JARO_WINKLER_HAS_COROUTINES 0
+#endif
+
+namespace jaro_winkler {
+
+/**
+ * @defgroup process process
+ * Functions to compare one or more queries with a list of choices
+ * @{
+ */
+
+struct ExtractMatch {
+    /* position of the choice in the list of choices */
+    int64_t index;
+    double score;
+};
+
+namespace detail {
+
+/**
+ * ordering used for the results of extract: higher scores first and for
+ * equal scores the choice which appeared first
+ */
+static inline bool extract_match_better(const ExtractMatch& a, const ExtractMatch& b)
+{
+    if (a.score != b.score) return a.score > b.score;
+    return a.index < b.index;
+}
+
+} // namespace detail
+
+/**
+ * @brief Resumable scan of a list of choices with a cached scorer
+ *
+ * The scan keeps the best `limit` results found so far together with the
+ * resulting score cutoff, so the comparison of a long list of choices can be
+ * split into multiple calls to step() and interleaved with other work. Once
+ * `limit` results are found, only choices, which can still replace the worst
+ * of them, are scored completely.
+ *
+ * The scorer and the choices are not copied and have to outlive the scan.
+ *
+ * @tparam Scorer cached scorer like CachedJaroWinklerSimilarity
+ * @tparam InputIt random access iterator over the choices
+ */
+template <typename Scorer, typename InputIt>
+struct ExtractScan {
+    /**
+     * @param scorer cached scorer holding the query
+     * @param first iterator to the first choice
+     * @param last past the end iterator of the choices
+     * @param limit maximum number of results
+     * @param score_cutoff
+     *   Optional argument for a score threshold as a float between 0 and 1.
+     *   Choices with similarity < score_cutoff are not part of the result.
+     * @param deduplicate
+     *   score each distinct choice only once and reuse the score for later
+     *   occurrences of it. This only keeps the position and hash of every
+     *   distinct choice, so the choices are not copied.
+     */
+    ExtractScan(const Scorer& scorer, InputIt first, InputIt last, size_t limit,
+                double score_cutoff = 0.0, bool deduplicate = false)
+        : m_scorer(&scorer),
+          m_first(first),
+          m_pos(0),
+          m_len(static_cast<int64_t>(std::distance(first, last))),
+          m_limit(limit),
+          m_score_cutoff(score_cutoff),
+          m_deduplicate(deduplicate),
+          m_dedup(first)
+    {}
+
+    /**
+     * @brief score up to count more choices
+     *
+     * @return number of choices scored by this call
+     */
+    int64_t step(int64_t count)
+    {
+        int64_t end = std::min(m_len, m_pos + std::max<int64_t>(count, 0));
+        int64_t processed = end - m_pos;
+        if (!m_limit) {
+            m_pos = end;
+            return processed;
+        }
+
+        for (; m_pos < end; ++m_pos) {
+            double cutoff = current_cutoff();
+            double score = score_choice(cutoff);
+            if (score < cutoff) continue;
+
+            if (m_heap.size() < m_limit) {
+                m_heap.push_back({m_pos, score});
+                std::push_heap(m_heap.begin(), m_heap.end(), detail::extract_match_better);
+            }
+            /* on equal scores the earlier choice is kept */
+            else if (score > m_heap.front().score) {
+                std::pop_heap(m_heap.begin(), m_heap.end(), detail::extract_match_better);
+                m_heap.back() = {m_pos, score};
+                std::push_heap(m_heap.begin(), m_heap.end(), detail::extract_match_better);
+            }
+        }
+
+        return processed;
+    }
+
+    /**
+     * @brief score all remaining choices
+     */
+    void run()
+    {
+        step(remaining());
+    }
+
+    bool done() const
+    {
+        return m_pos == m_len;
+    }
+
+    int64_t processed() const
+    {
+        return m_pos;
+    }
+
+    int64_t remaining() const
+    {
+        return m_len - m_pos;
+    }
+
+    /**
+     * @brief score a choice has to reach to become part of the result
+     */
+    double current_cutoff() const
+    {
+        if (m_heap.size() < m_limit) return m_score_cutoff;
+        return std::max(m_score_cutoff, m_heap.front().score);
+    }
+
+    /**
+     * @brief best results found so far sorted by descending score
+     */
+    std::vector<ExtractMatch> results() const
+    {
+        std::vector<ExtractMatch> res = m_heap;
+        std::sort(res.begin(), res.end(), detail::extract_match_better);
+        return res;
+    }
+
+private:
+    double score_choice(double cutoff)
+    {
+        int64_t id = m_deduplicate ? m_dedup.insert(m_pos) : -1;
+        /* the cutoff never decreases, so a score below the cutoff of an
+         * earlier occurrence is below the current cutoff as well */
+        if (id >= 0 && static_cast<size_t>(id) < m_scores.size()) {
+            return m_scores[static_cast<size_t>(id)];
+        }
+
+        double score = m_scorer->similarity(m_first[m_pos], cutoff);
+        if (id >= 0) m_scores.push_back(score);
+        return score;
+    }
+
+    const Scorer* m_scorer;
+    InputIt m_first;
+    int64_t m_pos;
+    int64_t m_len;
+    size_t m_limit;
+    double m_score_cutoff;
+    bool m_deduplicate;
+
+    /* distinct choices seen so far and their scores */
+    detail::SentenceDedup<InputIt> m_dedup;
+    std::vector<double> m_scores;
+
+    /* heap with the worst of the current results on top */
+    std::vector<ExtractMatch> m_heap;
+};
+
+template <typename Scorer, typename InputIt>
+ExtractScan<Scorer, InputIt> make_extract_scan(const Scorer& scorer, InputIt first, InputIt last,
+                                               size_t limit, double score_cutoff = 0.0,
+                                               bool deduplicate = false)
+{
+    return ExtractScan<Scorer, InputIt>(scorer, first, last, limit, score_cutoff, deduplicate);
+}
+
+template <typename Scorer, typename Choices>
+ExtractScan<Scorer, typename Choices::const_iterator>
+make_extract_scan(const Scorer& scorer, const Choices& choices, size_t limit,
+                  double score_cutoff = 0.0, bool deduplicate = false)
+{
+    return ExtractScan<Scorer, typename Choices::const_iterator>(
+        scorer, std::begin(choices), std::end(choices), limit, score_cutoff, deduplicate);
+}
+
+/**
+ * @brief find the best `limit` choices for a query
+ *
+ * @param deduplicate score each distinct choice only once (see ExtractScan)
+ *
+ * @return matches sorted by descending score
+ */
+template <typename Scorer, typename Choices>
+std::vector<ExtractMatch> extract(const Scorer& scorer, const Choices& choices, size_t limit,
+                                  double score_cutoff = 0.0, bool deduplicate = false)
+{
+    auto scan = make_extract_scan(scorer, choices, limit, score_cutoff, deduplicate);
+    scan.run();
+    return scan.results();
+}
+
+/**
+ * @brief tile sizes used by the many-to-many functions
+ *
+ * A block of query_tile queries is compared with a block of choice_tile
+ * choices before moving on, so the pattern match vectors of the queries and
+ * the choices of a tile stay resident in the cache. A value of 0 selects the
+ * tile size based on the string lengths.
+ */
+struct CdistTiling {
+    int64_t query_tile = 0;
+    int64_t choice_tile = 0;
+};
+
+struct CdistOptions {
+    /* only used by the Jaro-Winkler similarity */
+    double prefix_weight = 0.1;
+    double score_cutoff = 0.0;
+    /* number of threads. Values <= 0 use the number of hardware threads */
+    int64_t workers = 1;
+    CdistTiling tiling;
+    /* score each distinct query and choice only once and copy the results to
+     * their duplicates. Only used by cdist_jaro_winkler and cdist_jaro */
+    bool deduplicate = false;
+    /* split the queries between the NUMA nodes, so the pattern match vectors
+     * of each part are only accessed by workers pinned to the node they are
+     * stored on. Only used by cdist_jaro_winkler and cdist_jaro and ignored
+     * on systems with a single node */
+    bool numa = false;
+};
+
+struct SparseEntry {
+    int64_t row;
+    int64_t col;
+    double score;
+};
+
+/**
+ * @brief sparse cdist result in coordinate format. Entries are sorted by
+ * row and column.
+ */
+struct CooMatrix {
+    int64_t rows = 0;
+    int64_t cols = 0;
+    std::vector<int64_t> row;
+    std::vector<int64_t> col;
+    std::vector<double> score;
+
+    size_t nnz() const
+    {
+        return score.size();
+    }
+
+    void reset(int64_t rows_, int64_t cols_)
+    {
+        rows = rows_;
+        cols = cols_;
+        row.clear();
+        col.clear();
+        score.clear();
+    }
+
+    void append(const SparseEntry* first, const SparseEntry* last)
+    {
+        for (; first != last; ++first) {
+            row.push_back(first->row);
+            col.push_back(first->col);
+            score.push_back(first->score);
+        }
+    }
+
+    void finish()
+    {}
+};
+
+/**
+ * @brief sparse cdist result in compressed sparse row format. The entries
+ * of row i are stored in [row_offsets[i], row_offsets[i + 1]).
+ */
+struct CsrMatrix {
+    int64_t rows = 0;
+    int64_t cols = 0;
+    std::vector<int64_t> row_offsets;
+    std::vector<int64_t> col;
+    std::vector<double> score;
+
+    size_t nnz() const
+    {
+        return score.size();
+    }
+
+    void reset(int64_t rows_, int64_t cols_)
+    {
+        rows = rows_;
+        cols = cols_;
+        row_offsets.assign(1, 0);
+        col.clear();
+        score.clear();
+    }
+
+    void append(const SparseEntry* first, const SparseEntry* last)
+    {
+        for (; first != last; ++first) {
+            close_rows(first->row);
+            col.push_back(first->col);
+            score.push_back(first->score);
+        }
+    }
+
+    void finish()
+    {
+        close_rows(rows);
+    }
+
+private:
+    /* terminate all rows before row */
+    void close_rows(int64_t row)
+    {
+        while (static_cast<int64_t>(row_offsets.size()) <= row) {
+            row_offsets.push_back(static_cast<int64_t>(col.size()));
+        }
+    }
+};
+
+/**
+ * @brief streams sparse cdist results to a binary file
+ *
+ * The file starts with a 40 byte header:
+ *   - magic "JWSPARSE"
+ *   - uint32 version (1) and uint32 record size (12)
+ *   - uint64 rows, uint64 cols and uint64 number of records
+ *
+ * followed by one record (uint32 row, uint32 col, float32 score) for every
+ * entry sorted by row and column. All values use the native byte order.
+ */
+class SparseFileWriter {
+public:
+    explicit SparseFileWriter(const std::string& path)
+        : m_path(path), m_file(path, std::ios::binary | std::ios::trunc), m_nnz(0)
+    {
+        if (!m_file) {
+            throw std::system_error(errno, std::generic_category(), "failed to open " + path);
+        }
+    }
+
+    size_t nnz() const
+    {
+        return m_nnz;
+    }
+
+    void reset(int64_t rows, int64_t cols)
+    {
+        const int64_t max_index = std::numeric_limits<uint32_t>::max();
+        if (rows > max_index || cols > max_index) {
+            throw std::invalid_argument("too many rows or columns for SparseFileWriter");
+        }
+
+        /* the file is truncated, so a reused writer does not leave records
+         * of the previous result behind */
+        m_nnz = 0;
+        m_file.close();
+        m_file.open(m_path, std::ios::binary | std::ios::trunc);
+        if (!m_file) {
+            throw std::system_error(errno, std::generic_category(), "failed to open " + m_path);
+        }
+        m_file.write("JWSPARSE", 8);
+        write_value(uint32_t(1));
+        write_value(uint32_t(12));
+        write_value(static_cast<uint64_t>(rows));
+        write_value(static_cast<uint64_t>(cols));
+        write_value(uint64_t(0));
+    }
+
+    void append(const SparseEntry* first, const SparseEntry* last)
+    {
+        m_nnz += static_cast<size_t>(last - first);
+        for (; first != last; ++first) {
+            char record[12];
+            uint32_t row = static_cast<uint32_t>(first->row);
+            uint32_t col = static_cast<uint32_t>(first->col);
+            float score = static_cast<float>(first->score);
+            std::memcpy(record, &row, 4);
+            std::memcpy(record + 4, &col, 4);
+            std::memcpy(record + 8, &score, 4);
+            m_file.write(record, sizeof(record));
+        }
+    }
+
+    void finish()
+    {
+        m_file.seekp(32);
+        write_value(static_cast<uint64_t>(m_nnz));
+        m_file.flush();
+        if (!m_file) {
+            throw std::system_error(errno, std::generic_category(), "failed to write " + m_path);
+        }
+    }
+
+private:
+    template <typename T>
+    void write_value(T value)
+    {
+        m_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    std::string m_path;
+    std::ofstream m_file;
+    size_t m_nnz;
+};
+
+/**
+ * @brief default tile sizes for a given average string length
+ *
+ * The pattern match vectors of a query tile are kept in the L2 budget of
+ * profile, while the choices of a tile are kept in its L1 budget. By default
+ * these are half of a 256 kB L2 and a 32 kB L1 cache.
+ */
+static inline CdistTiling cdist_default_tiling(double avg_query_len, double avg_choice_len,
+                                               size_t char_size, const TuningProfile& profile)
+{
+    const double l1_budget = static_cast<double>(profile.tile_l1_budget);
+    const double l2_budget = static_cast<double>(profile.tile_l2_budget);
+
+    double query_blocks = std::max(1.0, std::ceil(avg_query_len / 64));
+    double pm_size =
+        query_blocks * 256 * sizeof(uint64_t) + avg_query_len * static_cast<double>(char_size);
+    /* string objects are part of the working set as well */
+    double choice_size = avg_choice_len * static_cast<double>(char_size) + 32;
+
+    CdistTiling tiling;
+    tiling.query_tile = static_cast<int64_t>(std::min(std::max(l2_budget / pm_size, 1.0), 256.0));
+    tiling.choice_tile =
+        static_cast<int64_t>(std::min(std::max(l1_budget / choice_size, 8.0), 4096.0));
+    return tiling;
+}
+
+/**
+ * @brief default tile sizes using the active TuningProfile
+ */
+static inline CdistTiling cdist_default_tiling(double avg_query_len, double avg_choice_len,
+                                               size_t char_size)
+{
+    return cdist_default_tiling(avg_query_len, avg_choice_len, char_size, get_tuning_profile());
+}
+
+namespace detail {
+
+template <typename Sentence>
+using sentence_char_t =
+    typename std::decay<decltype(*std::begin(std::declval<const Sentence&>()))>::type;
+
+template <typename Choices>
+double average_length(const Choices& choices)
+{
+    size_t count = 0;
+    double total = 0;
+    for (const auto& choice : choices) {
+        total += static_cast<double>(std::distance(std::begin(choice), std::end(choice)));
+        count++;
+    }
+    return count ? total / static_cast<double>(count) : 0.0;
+}
+
+template <typename PatternSet, typename Choices>
+CdistTiling cdist_resolve_tiling(const PatternSet& slab, const Choices& choices,
+                                 CdistTiling tiling)
+{
+    if (tiling.query_tile > 0 && tiling.choice_tile > 0) return tiling;
+
+    double avg_query_len = 0;
+    for (size_t i = 0; i < slab.size(); ++i) {
+        avg_query_len += static_cast<double>(slab.pattern_length(i));
+    }
+    if (slab.size()) avg_query_len /= static_cast<double>(slab.size());
+
+    using CharT2 = sentence_char_t<typename Choices::value_type>;
+    CdistTiling defaults =
+        cdist_default_tiling(avg_query_len, average_length(choices), sizeof(CharT2));
+    if (tiling.query_tile <= 0) tiling.query_tile = defaults.query_tile;
+    if (tiling.choice_tile <= 0) tiling.choice_tile = defaults.choice_tile;
+    return tiling;
+}
+
+/**
+ * @brief compare every query of the slab with every choice tile by tile
+ *
+ * score(query, first, last, scores) is used to calculate the similarity of
+ * a query with a tile of choices and sink(query, choice, score) receives
+ * the results. Query tiles are handed out to the worker threads one at a
+ * time, so each thread writes to a disjoint set of rows. Once all results of
+ * a query tile are passed to sink, tile_done(tile) is called by the same
+ * thread.
+ */
+template <typename PatternSet, typename Choices, typename ScoreFunc, typename Sink,
+          typename TileDone>
+void cdist_tiled(const PatternSet& slab, const Choices& choices, CdistTiling tiling,
+                 int64_t workers, ScoreFunc score, Sink sink, TileDone tile_done)
+{
+    int64_t rows = static_cast<int64_t>(slab.size());
+    int64_t cols = static_cast<int64_t>(choices.size());
+    tiling = cdist_resolve_tiling(slab, choices, tiling);
+    int64_t query_tiles = common::ceildiv(rows, tiling.query_tile);
+    workers = std::min(common::resolve_workers(workers), std::max<int64_t>(query_tiles, 1));
+    std::atomic<int64_t> next_tile(0);
+
+    common::parallel_for(workers, workers, [&](int64_t, int64_t) {
+        std::vector<double> scores(static_cast<size_t>(std::min(tiling.choice_tile, cols)));
+
+        for (int64_t tile = next_tile++; tile < query_tiles; tile = next_tile++) {
+            int64_t q_tile = tile * tiling.query_tile;
+            int64_t q_tile_end = std::min(q_tile + tiling.query_tile, rows);
+
+            for (int64_t c_tile = 0; c_tile < cols; c_tile += tiling.choice_tile) {
+                int64_t c_tile_end = std::min(c_tile + tiling.choice_tile, cols);
+
+                for (int64_t q = q_tile; q < q_tile_end; ++q) {
+                    score(static_cast<size_t>(q), std::begin(choices) + c_tile,
+                          std::begin(choices) + c_tile_end, scores.data());
+                    for (int64_t c = c_tile; c < c_tile_end; ++c) {
+                        sink(q, c, scores[static_cast<size_t>(c - c_tile)]);
+                    }
+                }
+            }
+
+            tile_done(tile);
+        }
+    });
+}
+
+template <typename PatternSet, typename Choices, typename ScoreFunc, typename Sink>
+void cdist_tiled(const PatternSet& slab, const Choices& choices, CdistTiling tiling,
+                 int64_t workers, ScoreFunc score, Sink sink)
+{
+    cdist_tiled(slab, choices, tiling, workers, score, sink, [](int64_t) {});
+}
+
+/**
+ * @brief collect the non zero results of cdist_tiled and pass them to
+ * output in row major order
+ *
+ * The results of every query tile are collected in a separate buffer by the
+ * thread processing the tile. Finished tiles are passed to the output in
+ * order, so the output is independent of the number of workers and only
+ * tiles finished out of order are buffered.
+ */
+template <typename PatternSet, typename Choices, typename ScoreFunc, typename SparseOutput>
+void cdist_sparse(const PatternSet& slab, const Choices& choices, const CdistOptions& options,
+                  ScoreFunc score, SparseOutput& output)
+{
+    int64_t rows = static_cast<int64_t>(slab.size());
+    CdistTiling tiling = cdist_resolve_tiling(slab, choices, options.tiling);
+    size_t query_tiles = static_cast<size_t>(common::ceildiv(rows, tiling.query_tile));
+    output.reset(rows, static_cast<int64_t>(choices.size()));
+
+    std::vector<std::vector<SparseEntry>> pending(query_tiles);
+    std::vector<char> finished(query_tiles, 0);
+    size_t next_output = 0;
+    std::mutex output_mutex;
+
+    cdist_tiled(
+        slab, choices, tiling, options.workers, score,
+        [&](int64_t q, int64_t c, double sim) {
+            if (sim == 0) return;
+            pending[static_cast<size_t>(q / tiling.query_tile)].push_back({q, c, sim});
+        },
+        [&](int64_t tile) {
+            /* results are ordered by choice tile, so restore the row major order */
+            auto& entries = pending[static_cast<size_t>(tile)];
+            std::stable_sort(entries.begin(), entries.end(),
+                             [](const SparseEntry& a, const SparseEntry& b) {
+                                 return a.row < b.row;
+                             });
+
+            std::lock_guard<std::mutex> lock(output_mutex);
+            finished[static_cast<size_t>(tile)] = 1;
+            for (; next_output < query_tiles && finished[next_output]; ++next_output) {
+                auto& ready = pending[next_output];
+                output.append(ready.data(), ready.data() + ready.size());
+                std::vector<SparseEntry>().swap(ready);
+            }
+        });
+
+    output.finish();
+}
+
+/**
+ * @brief build the pattern match vectors of the queries and compare them with
+ * every choice using cdist_tiled
+ *
+ * batch(slab, handle, first, last, scores) compares a pattern of the slab
+ * with a range of choices and sink(q, c, score) receives the results. With
+ * options.numa every NUMA node builds the pattern match vectors for its part
+ * of the queries using threads pinned to the node. The pages are placed on
+ * the node touching them first, so the pattern match vectors end up in the
+ * local memory of the workers reading them.
+ */
+template <typename Queries, typename Choices, typename BatchScore, typename Sink>
+void cdist_dense(const Queries& queries, const Choices& choices, const CdistOptions& options,
+                 BatchScore batch, Sink sink)
+{
+    using CharT1 = sentence_char_t<typename Queries::value_type>;
+    auto run = [&](int64_t first, int64_t last, int64_t workers) {
+        CachedPatternSlab<CharT1> slab(std::begin(queries) + first, std::begin(queries) + last,
+                                       workers);
+        cdist_tiled(
+            slab, choices, options.tiling, workers,
+            [&](size_t q, typename Choices::const_iterator c_first,
+                typename Choices::const_iterator c_last, double* scores) {
+                batch(slab, q, c_first, c_last, scores);
+            },
+            [&](int64_t q, int64_t c, double score) { sink(first + q, c, score); });
+    };
+
+    int64_t rows = static_cast<int64_t>(queries.size());
+    if (options.numa) {
+        common::parallel_for_nodes(rows, options.workers, run);
+    }
+    else {
+        run(0, rows, options.workers);
+    }
+}
+
+/**
+ * @brief dense cdist, which only compares the distinct queries with the
+ * distinct choices and copies the results to all of their occurrences
+ *
+ * batch(slab, handle, first, last, scores) compares a pattern of the slab
+ * with a range of distinct choices. A query, which occurs in the choices as
+ * well, receives a similarity of 1.0 for it without being compared.
+ */
+template <typename Queries, typename Choices, typename BatchScore>
+std::vector<double> cdist_deduplicated(const Queries& queries, const Choices& choices,
+                                       const CdistOptions& options, BatchScore batch)
+{
+    using CharT1 = sentence_char_t<typename Queries::value_type>;
+    DedupSentences<typename Queries::const_iterator> unique_queries(std::begin(queries),
+                                                                    std::end(queries));
+    DedupSentences<typename Choices::const_iterator> unique_choices(std::begin(choices),
+                                                                    std::end(choices));
+    const auto& distinct_choices = unique_choices.unique;
+    double exact_score = common::result_cutoff(1.0, options.score_cutoff);
+
+    size_t cols = choices.size();
+    std::vector<double> matrix(queries.size() * cols);
+    cdist_dense(
+        unique_queries.unique, distinct_choices, options,
+        [&](const CachedPatternSlab<CharT1>& slab, size_t q, auto first, auto last,
+            double* scores) {
+            /* distinct choice equal to the query or -1 */
+            int64_t exact = -1;
+            if (slab.pattern_length(q)) {
+                exact = distinct_choices.find(slab.pattern_begin(q), slab.pattern_end(q));
+            }
+
+            int64_t first_pos = first - distinct_choices.begin();
+            if (exact < first_pos || exact >= first_pos + (last - first)) {
+                batch(slab, q, first, last, scores);
+                return;
+            }
+
+            auto match = first + (exact - first_pos);
+            double* match_score = scores + (match - first);
+            batch(slab, q, first, match, scores);
+            *match_score = exact_score;
+            batch(slab, q, match + 1, last, match_score + 1);
+        },
+        [&](int64_t q, int64_t c, double score) {
+            size_t q_id = static_cast<size_t>(q);
+            size_t c_id = static_cast<size_t>(c);
+            for (auto row = unique_queries.occurrences_begin(q_id);
+                 row != unique_queries.occurrences_end(q_id); ++row)
+            {
+                for (auto col = unique_choices.occurrences_begin(c_id);
+                     col != unique_choices.occurrences_end(c_id); ++col)
+                {
+                    matrix[static_cast<size_t>(*row) * cols + static_cast<size_t>(*col)] = score;
+                }
+            }
+        });
+    return matrix;
+}
+
+} // namespace detail
+
+/**
+ * @brief Jaro-Winkler similarity of every query with every choice
+ *
+ * @return row major matrix of size queries.size() x choices.size()
+ */
+template <typename Policy = DefaultJaroPolicy, typename Queries, typename Choices>
+std::vector<double> cdist_jaro_winkler(const Queries& queries, const Choices& choices,
+                                       const CdistOptions& options = CdistOptions())
+{
+    detail::validate_prefix_weight<Policy>(options.prefix_weight);
+
+    using CharT1 = detail::sentence_char_t<typename Queries::value_type>;
+    if (options.deduplicate) {
+        return detail::cdist_deduplicated(
+            queries, choices, options,
+            [&](const CachedPatternSlab<CharT1>& slab, size_t q, auto first, auto last,
+                double* scores) {
+                slab.template jaro_winkler_similarity_batch<Policy>(
+                    q, first, last, scores, options.prefix_weight, options.score_cutoff);
+            });
+    }
+
+    size_t cols = choices.size();
+    std::vector<double> matrix(queries.size() * cols);
+    detail::cdist_dense(
+        queries, choices, options,
+        [&](const CachedPatternSlab<CharT1>& slab, size_t q, typename Choices::const_iterator first,
+            typename Choices::const_iterator last, double* scores) {
+            slab.template jaro_winkler_similarity_batch<Policy>(
+                q, first, last, scores, options.prefix_weight, options.score_cutoff);
+        },
+        [&](int64_t q, int64_t c, double score) {
+            matrix[static_cast<size_t>(q) * cols + static_cast<size_t>(c)] = score;
+        });
+    return matrix;
+}
+
+/**
+ * @brief Jaro similarity of every query with every choice
+ *
+ * @return row major matrix of size queries.size() x choices.size()
+ */
+template <typename Policy = DefaultJaroPolicy, typename Queries, typename Choices>
+std::vector<double> cdist_jaro(const Queries& queries, const Choices& choices,
+                               const CdistOptions& options = CdistOptions())
+{
+    using CharT1 = detail::sentence_char_t<typename Queries::value_type>;
+    if (options.deduplicate) {
+        return detail::cdist_deduplicated(
+            queries, choices, options,
+            [&](const CachedPatternSlab<CharT1>& slab, size_t q, auto first, auto last,
+                double* scores) {
+                slab.template jaro_similarity_batch<Policy>(q, first, last, scores,
+                                                            options.score_cutoff);
+            });
+    }
+
+    size_t cols = choices.size();
+    std::vector<double> matrix(queries.size() * cols);
+    detail::cdist_dense(
+        queries, choices, options,
+        [&](const CachedPatternSlab<CharT1>& slab, size_t q, typename Choices::const_iterator first,
+            typename Choices::const_iterator last, double* scores) {
+            slab.template jaro_similarity_batch<Policy>(q, first, last, scores,
+                                                        options.score_cutoff);
+        },
+        [&](int64_t q, int64_t c, double score) {
+            matrix[static_cast<size_t>(q) * cols + static_cast<size_t>(c)] = score;
+        });
+    return matrix;
+}
+
+/**
+ * @brief Jaro-Winkler similarity of every query with every choice, which
+ * only stores the non zero results
+ *
+ * @param output
+ *   receives the results in row major order. This can be a CooMatrix,
+ *   a CsrMatrix or a SparseFileWriter. The output is identical for any
+ *   number of workers and tile size.
+ */
+template <typename Policy = DefaultJaroPolicy, typename Queries, typename Choices,
+          typename SparseOutput>
+void cdist_jaro_winkler_sparse(const Queries& queries, const Choices& choices,
+                               SparseOutput& output, const CdistOptions& options = CdistOptions())
+{
+    detail::validate_prefix_weight<Policy>(options.prefix_weight);
+
+    using CharT1 = detail::sentence_char_t<typename Queries::value_type>;
+    CachedPatternSlab<CharT1> slab(queries, options.workers);
+    detail::cdist_sparse(
+        slab, choices, options,
+        [&](size_t q, typename Choices::const_iterator first,
+            typename Choices::const_iterator last, double* scores) {
+            slab.template jaro_winkler_similarity_batch<Policy>(
+                q, first, last, scores, options.prefix_weight, options.score_cutoff);
+        },
+        output);
+}
+
+/**
+ * @brief Jaro similarity of every query with every choice, which only
+ * stores the non zero results (see cdist_jaro_winkler_sparse)
+ */
+template <typename Policy = DefaultJaroPolicy, typename Queries, typename Choices,
+          typename SparseOutput>
+void cdist_jaro_sparse(const Queries& queries, const Choices& choices, SparseOutput& output,
+                       const CdistOptions& options = CdistOptions())
+{
+    using CharT1 = detail::sentence_char_t<typename Queries::value_type>;
+    CachedPatternSlab<CharT1> slab(queries, options.workers);
+    detail::cdist_sparse(
+        slab, choices, options,
+        [&](size_t q, typename Choices::const_iterator first,
+            typename Choices::const_iterator last, double* scores) {
+            slab.template jaro_similarity_batch<Policy>(q, first, last, scores,
+                                                        options.score_cutoff);
+        },
+        output);
+}
+
+namespace detail {
+
+/**
+ * @brief order in which the pairwise functions score the pairs [first, last)
+ *
+ * The pairs are grouped by the length of the longer string into the classes
+ * <= 8, <= 16, <= 32, <= 64 and longer, so pairs scored together in the lanes
+ * of the word kernel have a similar length. Within a class the pairs keep
+ * their original order.
+ */
+template <typename Sentences1, typename Sentences2>
+void pairwise_order(const Sentences1& a, const Sentences2& b, int64_t first, int64_t last,
+                    std::vector<unsigned char>& classes, std::vector<int64_t>& order)
+{
+    auto length_class = [](int64_t len) -> unsigned char {
+        if (len <= 8) return 0;
+        if (len <= 16) return 1;
+        if (len <= 32) return 2;
+        if (len <= 64) return 3;
+        return 4;
+    };
+
+    size_t count = static_cast<size_t>(last - first);
+    size_t offsets[6] = {0, 0, 0, 0, 0, 0};
+    classes.resize(count);
+    order.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& s1 = std::begin(a)[first + static_cast<int64_t>(i)];
+        const auto& s2 = std::begin(b)[first + static_cast<int64_t>(i)];
+        int64_t len = std::max<int64_t>(std::distance(std::begin(s1), std::end(s1)),
+                                        std::distance(std::begin(s2), std::end(s2)));
+        classes[i] = length_class(len);
+        offsets[classes[i] + 1]++;
+    }
+
+    for (size_t i = 1; i < 6; ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        order[offsets[classes[i]]++] = first + static_cast<int64_t>(i);
+    }
+}
+
+/**
+ * @brief score the pairs (a[i], b[i]) in chunks of up to 64 pairs
+ *
+ * score(indices, count, scores) calculates the similarity of the pairs in
+ * indices. The pairs are ordered by pairwise_order in windows, which are
+ * small enough for the strings to still be cached when they are scored, and
+ * the results are scattered back into the original order.
+ */
+template <typename Sentences1, typename Sentences2, typename ScoreFunc>
+void pairwise(const Sentences1& a, const Sentences2& b, double* result, int64_t workers,
+              ScoreFunc score)
+{
+    if (a.size() != b.size()) {
+        throw std::invalid_argument("both sequences of a pairwise comparison need the same size");
+    }
+
+    const int64_t window = 4096;
+    int64_t count = static_cast<int64_t>(a.size());
+    common::parallel_for(common::ceildiv(count, window), workers, [&](int64_t first, int64_t last) {
+        std::vector<unsigned char> classes;
+        std::vector<int64_t> order;
+        double scores[64];
+
+        for (int64_t w = first; w < last; ++w) {
+            int64_t window_len = std::min(count - w * window, window);
+            pairwise_order(a, b, w * window, w * window + window_len, classes, order);
+
+            for (int64_t chunk = 0; chunk < window_len; chunk += 64) {
+                const int64_t* indices = order.data() + chunk;
+                int64_t chunk_len = std::min<int64_t>(window_len - chunk, 64);
+                score(indices, chunk_len, scores);
+                for (int64_t k = 0; k < chunk_len; ++k) {
+                    result[indices[k]] = scores[k];
+                }
+            }
+        }
+    });
+}
+
+} // namespace detail
+
+/**
+ * @brief Jaro-Winkler similarity of a[i] and b[i] for every i
+ *
+ * Unlike comparing the pairs one by one with jaro_winkler_similarity, pairs
+ * of similar length are scored together, so the independent comparisons can
+ * be calculated in SIMD lanes. The tiling of the options is not used.
+ *
+ * @param a random access sequence of strings
+ * @param b random access sequence of strings with the same size as a
+ * @param scores output with a.size() elements receiving the similarity of
+ *   every pair in the original order
+ */
+template <typename Policy = DefaultJaroPolicy, typename Sentences1, typename Sentences2>
+void pairwise_jaro_winkler(const Sentences1& a, const Sentences2& b, double* scores,
+                           const CdistOptions& options = CdistOptions())
+{
+    detail::validate_prefix_weight<Policy>(options.prefix_weight);
+
+    detail::pairwise(
+        a, b, scores, options.workers,
+        [&](const int64_t* indices, int64_t count, double* chunk_scores) {
+            double score_cutoffs[64];
+            int64_t prefixes[64];
+            for (int64_t k = 0; k < count; ++k) {
+                const auto& s1 = std::begin(a)[indices[k]];
+                const auto& s2 = std::begin(b)[indices[k]];
+                prefixes[k] = detail::jaro_winkler_common_prefix<Policy>(
+                    std::begin(s1), std::end(s1), std::begin(s2), std::end(s2));
+                score_cutoffs[k] = detail::jaro_winkler_jaro_cutoff<Policy>(
+                    prefixes[k], options.prefix_weight, options.score_cutoff);
+            }
+
+            detail::jaro_similarity_pairs<Policy>(std::begin(a), std::begin(b), indices, count,
+                                                  score_cutoffs, chunk_scores);
+            for (int64_t k = 0; k < count; ++k) {
+                double Sim = detail::jaro_winkler_apply_prefix<Policy>(
+                    chunk_scores[k], prefixes[k], options.prefix_weight);
+                chunk_scores[k] = common::result_cutoff(Sim, options.score_cutoff);
+            }
+        });
+}
+
+/**
+ * @brief Jaro-Winkler similarity of a[i] and b[i] for every i
+ *
+ * @return similarity of every pair in the original order
+ */
+template <typename Policy = DefaultJaroPolicy, typename Sentences1, typename Sentences2>
+std::vector<double> pairwise_jaro_winkler(const Sentences1& a, const Sentences2& b,
+                                          const CdistOptions& options = CdistOptions())
+{
+    std::vector<double> scores(a.size());
+    pairwise_jaro_winkler<Policy>(a, b, scores.data(), options);
+    return scores;
+}
+
+/**
+ * @brief Jaro similarity of a[i] and b[i] for every i (see pairwise_jaro_winkler)
+ */
+template <typename Policy = DefaultJaroPolicy, typename Sentences1, typename Sentences2>
+void pairwise_jaro(const Sentences1& a, const Sentences2& b, double* scores,
+                   const CdistOptions& options = CdistOptions())
+{
+    detail::pairwise(
+        a, b, scores, options.workers,
+        [&](const int64_t* indices, int64_t count, double* chunk_scores) {
+            double score_cutoffs[64];
+            std::fill(score_cutoffs, score_cutoffs + count, options.score_cutoff);
+            detail::jaro_similarity_pairs<Policy>(std::begin(a), std::begin(b), indices, count,
+                                                  score_cutoffs, chunk_scores);
+        });
+}
+
+/**
+ * @brief Jaro similarity of a[i] and b[i] for every i
+ *
+ * @return similarity of every pair in the original order
+ */
+template <typename Policy = DefaultJaroPolicy, typename Sentences1, typename Sentences2>
+std::vector<double> pairwise_jaro(const Sentences1& a, const Sentences2& b,
+                                  const CdistOptions& options = CdistOptions())
+{
+    std::vector<double> scores(a.size());
+    pairwise_jaro<Policy>(a, b, scores.data(), options);
+    return scores;
+}
+
+#if JARO_WINKLER_HAS_COROUTINES
+
+/**
+ * @brief generator returned by scan_chunks
+ *
+ * Every resumption of the generator processes one chunk of the scan and
+ * yields the number of choices processed so far.
+ */
+class ScanChunkGenerator {
+public:
+    struct promise_type {
+        int64_t current = 0;
+        std::exception_ptr exception;
+
+        ScanChunkGenerator get_return_object()
+        {
+            return ScanChunkGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value(int64_t value) noexcept
+        {
+            current = value;
+            return {};
+        }
+
+        void return_void() noexcept
+        {}
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    struct sentinel {};
+
+    struct iterator {
+        using iterator_category = std::input_iterator_tag;
+        using value_type = int64_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int64_t*;
+        using reference = const int64_t&;
+
+        std::coroutine_handle<promise_type> handle;
+
+        iterator& operator++()
+        {
+            resume(handle);
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        reference operator*() const
+        {
+            return handle.promise().current;
+        }
+
+        friend bool operator==(const iterator& it, sentinel)
+        {
+            return it.handle.done();
+        }
+    };
+
+    ScanChunkGenerator(ScanChunkGenerator&& other) noexcept : m_handle(other.m_handle)
+    {
+        other.m_handle = nullptr;
+    }
+
+    ScanChunkGenerator& operator=(ScanChunkGenerator&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = other.m_handle;
+            other.m_handle = nullptr;
+        }
+        return *this;
+    }
+
+    ScanChunkGenerator(const ScanChunkGenerator&) = delete;
+    ScanChunkGenerator& operator=(const ScanChunkGenerator&) = delete;
+
+    ~ScanChunkGenerator()
+    {
+        if (m_handle) m_handle.destroy();
+    }
+
+    iterator begin()
+    {
+        resume(m_handle);
+        return iterator{m_handle};
+    }
+
+    sentinel end() const
+    {
+        return {};
+    }
+
+private:
+    explicit ScanChunkGenerator(std::coroutine_handle<promise_type> handle) : m_handle(handle)
+    {}
+
+    static void resume(std::coroutine_handle<promise_type> handle)
+    {
+        handle.resume();
+        if (handle.promise().exception) std::rethrow_exception(handle.promise().exception);
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail {
+
+template <typename Scan>
+ScanChunkGenerator scan_chunks(Scan& scan, int64_t chunk_size)
+{
+    while (!scan.done()) {
+        scan.step(chunk_size);
+        co_yield scan.processed();
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief split a scan into chunks of chunk_size choices
+ *
+ * Usable as a generator to time-slice a scan without spawning threads:
+ *
+ *     for (int64_t processed : scan_chunks(scan, 1000)) {
+ *         // yield to other work
+ *     }
+ *
+ * @throws std::invalid_argument when chunk_size is not positive, since the
+ *   scan would never make progress
+ */
+template <typename Scan>
+ScanChunkGenerator scan_chunks(Scan& scan, int64_t chunk_size)
+{
+    if (chunk_size <= 0) throw std::invalid_argument("chunk_size has to be positive");
+    return detail::scan_chunks(scan, chunk_size);
+}
+
+#endif
+
+/**@}*/
+
+} // namespace jaro_winkler
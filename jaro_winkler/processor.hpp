@@ -0,0 +1,357 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/common.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+namespace jaro_winkler {
+
+/**
+ * @defgroup processor processor
+ * Character processors, which are applied while the strings are read by the
+ * scorers instead of normalizing them into a separate buffer ahead of time.
+ *
+ * A processor is any type providing a static member function
+ * `template <typename CharT> static CharT map(CharT ch)`. Since the
+ * scorers compare strings position by position, a processor can only map
+ * characters one to one. Transformations changing the string length like
+ * collapsing runs of whitespace can not be fused into the scorers.
+ *
+ * Characters are interpreted as Unicode code points. For 8 bit character
+ * types this corresponds to Latin-1.
+ * @{
+ */
+
+namespace detail {
+
+/* lowercase mapping of U+00C0 - U+017F */
+static inline uint64_t lowercase_latin(uint64_t ch)
+{
+    static const uint16_t table[] = {
+        0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7, 0x00E8, 0x00E9,
+        0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x00F0, 0x00F1, 0x00F2, 0x00F3,
+        0x00F4, 0x00F5, 0x00F6, 0x00D7, 0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD,
+        0x00FE, 0x00DF, 0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+        0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x00F0, 0x00F1,
+        0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7, 0x00F8, 0x00F9, 0x00FA, 0x00FB,
+        0x00FC, 0x00FD, 0x00FE, 0x00FF, 0x0101, 0x0101, 0x0103, 0x0103, 0x0105, 0x0105,
+        0x0107, 0x0107, 0x0109, 0x0109, 0x010B, 0x010B, 0x010D, 0x010D, 0x010F, 0x010F,
+        0x0111, 0x0111, 0x0113, 0x0113, 0x0115, 0x0115, 0x0117, 0x0117, 0x0119, 0x0119,
+        0x011B, 0x011B, 0x011D, 0x011D, 0x011F, 0x011F, 0x0121, 0x0121, 0x0123, 0x0123,
+        0x0125, 0x0125, 0x0127, 0x0127, 0x0129, 0x0129, 0x012B, 0x012B, 0x012D, 0x012D,
+        0x012F, 0x012F, 0x0069, 0x0131, 0x0133, 0x0133, 0x0135, 0x0135, 0x0137, 0x0137,
+        0x0138, 0x013A, 0x013A, 0x013C, 0x013C, 0x013E, 0x013E, 0x0140, 0x0140, 0x0142,
+        0x0142, 0x0144, 0x0144, 0x0146, 0x0146, 0x0148, 0x0148, 0x0149, 0x014B, 0x014B,
+        0x014D, 0x014D, 0x014F, 0x014F, 0x0151, 0x0151, 0x0153, 0x0153, 0x0155, 0x0155,
+        0x0157, 0x0157, 0x0159, 0x0159, 0x015B, 0x015B, 0x015D, 0x015D, 0x015F, 0x015F,
+        0x0161, 0x0161, 0x0163, 0x0163, 0x0165, 0x0165, 0x0167, 0x0167, 0x0169, 0x0169,
+        0x016B, 0x016B, 0x016D, 0x016D, 0x016F, 0x016F, 0x0171, 0x0171, 0x0173, 0x0173,
+        0x0175, 0x0175, 0x0177, 0x0177, 0x00FF, 0x017A, 0x017A, 0x017C, 0x017C, 0x017E,
+        0x017E, 0x017F,
+    };
+
+    return table[ch - 0xC0];
+}
+
+/* lowercase mapping without diacritics of U+00C0 - U+017F */
+static inline uint64_t fold_latin(uint64_t ch)
+{
+    static const uint16_t table[] = {
+        0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x00E6, 0x0063, 0x0065, 0x0065,
+        0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069, 0x0064, 0x006E, 0x006F, 0x006F,
+        0x006F, 0x006F, 0x006F, 0x00D7, 0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079,
+        0x00FE, 0x00DF, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x00E6, 0x0063,
+        0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069, 0x0064, 0x006E,
+        0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x00F7, 0x006F, 0x0075, 0x0075, 0x0075,
+        0x0075, 0x0079, 0x00FE, 0x0079, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061,
+        0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0064, 0x0064,
+        0x0064, 0x0064, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,
+        0x0065, 0x0065, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067,
+        0x0068, 0x0068, 0x0068, 0x0068, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069,
+        0x0069, 0x0069, 0x0069, 0x0069, 0x0133, 0x0133, 0x006A, 0x006A, 0x006B, 0x006B,
+        0x0138, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C,
+        0x006C, 0x006E, 0x006E, 0x006E, 0x006E, 0x006E, 0x006E, 0x006E, 0x014B, 0x014B,
+        0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x0153, 0x0153, 0x0072, 0x0072,
+        0x0072, 0x0072, 0x0072, 0x0072, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073,
+        0x0073, 0x0073, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0075, 0x0075,
+        0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+        0x0077, 0x0077, 0x0079, 0x0079, 0x0079, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A,
+        0x007A, 0x0073,
+    };
+
+    return table[ch - 0xC0];
+}
+
+/**
+ * whitespace characters. Characters wider than 8 bit are interpreted as
+ * Unicode code points. 8 bit strings only use ASCII whitespace, since in
+ * UTF-8 the bytes 0x85 and 0xA0 are part of multibyte characters.
+ */
+template <typename CharT>
+bool is_whitespace(CharT ch)
+{
+    using UCharT = typename std::make_unsigned<CharT>::type;
+    auto code = static_cast<uint64_t>(static_cast<UCharT>(ch));
+    if (code == ' ' || (code >= '\t' && code <= '\r')) return true;
+    if (sizeof(CharT) == 1) return false;
+
+    return code == 0x85 || code == 0xA0 || code == 0x1680 || (code >= 0x2000 && code <= 0x200A) ||
+           code == 0x2028 || code == 0x2029 || code == 0x202F || code == 0x205F || code == 0x3000;
+}
+
+template <typename CharT, typename Func>
+CharT map_code_point(CharT ch, Func func)
+{
+    using UCharT = typename std::make_unsigned<CharT>::type;
+    uint64_t mapped = func(static_cast<uint64_t>(static_cast<UCharT>(ch)));
+    if (mapped > std::numeric_limits<UCharT>::max()) return ch;
+
+    return static_cast<CharT>(static_cast<UCharT>(mapped));
+}
+
+} // namespace detail
+
+namespace processor {
+
+/**
+ * @brief leaves all characters unchanged
+ */
+struct Identity {
+    template <typename CharT>
+    static CharT map(CharT ch)
+    {
+        return ch;
+    }
+};
+
+/**
+ * @brief lowercases characters of the Basic Latin, Latin-1 Supplement and
+ * Latin Extended-A blocks
+ */
+struct Lowercase {
+    template <typename CharT>
+    static CharT map(CharT ch)
+    {
+        return detail::map_code_point(ch, [](uint64_t code) {
+            if (code >= 'A' && code <= 'Z') return code + ('a' - 'A');
+            if (code >= 0xC0 && code < 0x180) return detail::lowercase_latin(code);
+            return code;
+        });
+    }
+};
+
+/**
+ * @brief lowercases characters, strips diacritics from the Latin-1 Supplement
+ * and Latin Extended-A blocks (e.g. 'É' -> 'e') and replaces all whitespace
+ * characters with ' '. These are the characters the token scorers split on,
+ * which for 8 bit characters are only the ASCII whitespace characters.
+ */
+struct Normalize {
+    template <typename CharT>
+    static CharT map(CharT ch)
+    {
+        if (detail::is_whitespace(ch)) return static_cast<CharT>(' ');
+
+        return detail::map_code_point(ch, [](uint64_t code) {
+            if (code >= 'A' && code <= 'Z') return code + ('a' - 'A');
+            if (code >= 0xC0 && code < 0x180) return detail::fold_latin(code);
+            return code;
+        });
+    }
+};
+
+} // namespace processor
+
+/**
+ * @brief random access iterator applying Processor::map to every character
+ * read through the underlying iterator
+ */
+template <typename Processor, typename InputIt>
+class ProcessedIterator {
+public:
+    using value_type = typename std::iterator_traits<InputIt>::value_type;
+    using difference_type = typename std::iterator_traits<InputIt>::difference_type;
+    using reference = value_type;
+    using pointer = void;
+    using iterator_category = std::random_access_iterator_tag;
+
+    ProcessedIterator() : m_it()
+    {}
+
+    explicit ProcessedIterator(InputIt it) : m_it(it)
+    {}
+
+    InputIt base() const
+    {
+        return m_it;
+    }
+
+    value_type operator*() const
+    {
+        return Processor::map(*m_it);
+    }
+
+    value_type operator[](difference_type n) const
+    {
+        return Processor::map(m_it[n]);
+    }
+
+    ProcessedIterator& operator++()
+    {
+        ++m_it;
+        return *this;
+    }
+
+    ProcessedIterator operator++(int)
+    {
+        ProcessedIterator tmp = *this;
+        ++m_it;
+        return tmp;
+    }
+
+    ProcessedIterator& operator--()
+    {
+        --m_it;
+        return *this;
+    }
+
+    ProcessedIterator operator--(int)
+    {
+        ProcessedIterator tmp = *this;
+        --m_it;
+        return tmp;
+    }
+
+    ProcessedIterator& operator+=(difference_type n)
+    {
+        m_it += n;
+        return *this;
+    }
+
+    ProcessedIterator& operator-=(difference_type n)
+    {
+        m_it -= n;
+        return *this;
+    }
+
+    friend ProcessedIterator operator+(ProcessedIterator it, difference_type n)
+    {
+        return it += n;
+    }
+
+    friend ProcessedIterator operator+(difference_type n, ProcessedIterator it)
+    {
+        return it += n;
+    }
+
+    friend ProcessedIterator operator-(ProcessedIterator it, difference_type n)
+    {
+        return it -= n;
+    }
+
+    friend difference_type operator-(const ProcessedIterator& a, const ProcessedIterator& b)
+    {
+        return a.m_it - b.m_it;
+    }
+
+    friend bool operator==(const ProcessedIterator& a, const ProcessedIterator& b)
+    {
+        return a.m_it == b.m_it;
+    }
+
+    friend bool operator!=(const ProcessedIterator& a, const ProcessedIterator& b)
+    {
+        return a.m_it != b.m_it;
+    }
+
+    friend bool operator<(const ProcessedIterator& a, const ProcessedIterator& b)
+    {
+        return a.m_it < b.m_it;
+    }
+
+    friend bool operator>(const ProcessedIterator& a, const ProcessedIterator& b)
+    {
+        return a.m_it > b.m_it;
+    }
+
+    friend bool operator<=(const ProcessedIterator& a, const ProcessedIterator& b)
+    {
+        return a.m_it <= b.m_it;
+    }
+
+    friend bool operator>=(const ProcessedIterator& a, const ProcessedIterator& b)
+    {
+        return a.m_it >= b.m_it;
+    }
+
+private:
+    InputIt m_it;
+};
+
+/**
+ * @brief non owning view on a string, which is read through Processor
+ */
+template <typename Processor, typename InputIt>
+class ProcessedRange {
+public:
+    using iterator = ProcessedIterator<Processor, InputIt>;
+    using const_iterator = iterator;
+    using value_type = typename iterator::value_type;
+
+    ProcessedRange(InputIt first, InputIt last) : m_first(first), m_last(last)
+    {}
+
+    iterator begin() const
+    {
+        return m_first;
+    }
+
+    iterator end() const
+    {
+        return m_last;
+    }
+
+    size_t size() const
+    {
+        return static_cast<size_t>(std::distance(m_first, m_last));
+    }
+
+private:
+    iterator m_first;
+    iterator m_last;
+};
+
+/**
+ * @brief view on [first, last), which is read through Processor
+ *
+ * The result can be passed to any of the scorers. When used to construct a
+ * cached scorer, the processor is applied while the pattern match vector is
+ * built. For the compared strings it is applied while they are scanned, so no
+ * normalized copy is created:
+ *
+ *     using jaro_winkler::processor::Normalize;
+ *     jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(
+ *         jaro_winkler::processed<Normalize>(s1));
+ *     double sim = scorer.similarity(jaro_winkler::processed<Normalize>(s2));
+ */
+template <typename Processor, typename InputIt>
+ProcessedRange<Processor, InputIt> processed(InputIt first, InputIt last)
+{
+    return ProcessedRange<Processor, InputIt>(first, last);
+}
+
+template <typename Processor, typename Sentence>
+auto processed(const Sentence& s) -> ProcessedRange<Processor, decltype(std::begin(s))>
+{
+    return processed<Processor>(std::begin(s), std::end(s));
+}
+
+/**@}*/
+
+} // namespace jaro_winkler
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/jaro_winkler.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace jaro_winkler {
+
+/**
+ * @brief Weighted Jaro-Winkler similarity of records consisting of multiple
+ * fields like name, street and city
+ *
+ * The similarity of two records is the weighted mean of the Jaro-Winkler
+ * similarities of their fields:
+ *
+ *     sum(weights[i] * similarity(fields[i], record[i])) / sum(weights)
+ *
+ * The fields are compared in the order of descending weight, so the most
+ * discriminative fields are compared first. Before a field is compared, all
+ * fields after it are assumed to reach the maximum score possible for their
+ * lengths. This results in a score_cutoff for the field and the comparison
+ * stops as soon as the record can no longer reach the score_cutoff, which for
+ * most non matching records happens after the first field.
+ *
+ * @tparam CharT1 character type of the cached fields
+ */
+template <typename CharT1, typename Policy = DefaultJaroPolicy>
+struct CachedRecordSimilarity {
+    /**
+     * @param fields random access sequence of the fields of the cached record
+     * @param weights non negative weight of every field. At least one of them
+     *   has to be positive
+     * @param prefix_weight prefix_weight used for all fields
+     */
+    template <typename Fields>
+    CachedRecordSimilarity(const Fields& fields, const std::vector<double>& weights,
+                           double prefix_weight = 0.1)
+        : m_total_weight(0)
+    {
+        size_t count = static_cast<size_t>(std::distance(std::begin(fields), std::end(fields)));
+        if (weights.size() != count) {
+            throw std::invalid_argument("every field of the record requires a weight");
+        }
+
+        for (double weight : weights) {
+            if (!(weight >= 0.0)) throw std::invalid_argument("field weights can't be negative");
+            m_total_weight += weight;
+        }
+        if (!(m_total_weight > 0.0)) {
+            throw std::invalid_argument("at least one field weight has to be positive");
+        }
+
+        m_order.resize(count);
+        std::iota(m_order.begin(), m_order.end(), size_t(0));
+        std::stable_sort(m_order.begin(), m_order.end(),
+                         [&](size_t a, size_t b) { return weights[a] > weights[b]; });
+
+        m_fields.reserve(count);
+        m_weights.reserve(count);
+        for (size_t field : m_order) {
+            m_fields.emplace_back(std::begin(fields)[static_cast<ptrdiff_t>(field)], prefix_weight);
+            m_weights.push_back(weights[field]);
+        }
+    }
+
+    /**
+     * @brief number of fields of the cached record
+     */
+    size_t size() const
+    {
+        return m_fields.size();
+    }
+
+    /**
+     * @param record random access sequence of strings with one string per field
+     * @param score_cutoff
+     *   Optional argument for a score threshold as a float between 0 and 1.
+     *   For similarity < score_cutoff 0 is returned instead.
+     *
+     * @return weighted mean of the similarities of the fields
+     */
+    template <typename Record>
+    double similarity(const Record& record, double score_cutoff = 0) const
+    {
+        if (static_cast<size_t>(std::distance(std::begin(record), std::end(record))) != size()) {
+            throw std::invalid_argument("record has a different number of fields");
+        }
+
+        /* the bounds only decide how early a record is rejected, so they are
+         * loosened slightly to never reject a record because of rounding */
+        double slack = 1e-9 * m_total_weight;
+        double required = score_cutoff * m_total_weight - slack;
+        double remaining = 0;
+        for (size_t i = 0; i < size(); ++i) {
+            remaining += max_field_score(record, i);
+        }
+        if (remaining < required) return 0.0;
+
+        double score = 0;
+        for (size_t i = 0; i < size(); ++i) {
+            remaining -= max_field_score(record, i);
+            if (m_weights[i] == 0.0) continue;
+
+            double field_cutoff = std::max((required - score - remaining) / m_weights[i], 0.0);
+            score += m_weights[i] * m_fields[i].similarity(field(record, m_order[i]), field_cutoff);
+            if (score + remaining < required) return 0.0;
+        }
+
+        return common::result_cutoff(score / m_total_weight, score_cutoff);
+    }
+
+private:
+    template <typename Record>
+    static auto field(const Record& record, size_t pos) -> decltype(*std::begin(record))
+    {
+        return std::begin(record)[static_cast<ptrdiff_t>(pos)];
+    }
+
+    /* upper bound of the weighted score of the i-th compared field */
+    template <typename Record>
+    double max_field_score(const Record& record, size_t i) const
+    {
+        const auto& s2 = field(record, m_order[i]);
+        int64_t len = static_cast<int64_t>(std::distance(std::begin(s2), std::end(s2)));
+        return m_weights[i] * m_fields[i].max_possible_score(len);
+    }
+
+    /* fields, weights and positions in the record in the order they are compared */
+    std::vector<CachedJaroWinklerSimilarity<CharT1, Policy>> m_fields;
+    std::vector<double> m_weights;
+    std::vector<size_t> m_order;
+    double m_total_weight;
+};
+
+} // namespace jaro_winkler
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/jaro_winkler.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace jaro_winkler {
+
+/**
+ * @defgroup sequence sequence
+ * Cached scorers for sequences over large alphabets like 32 or 64 bit token
+ * ids (hashed words, product ids). They return the same results as
+ * CachedJaroSimilarity and CachedJaroWinklerSimilarity, but store the
+ * pattern in a SequencePatternMatchVector. This is faster for long
+ * sequences with many distinct keys outside of the range [0, 255], while
+ * CachedJaroSimilarity is faster for text.
+ * @{
+ */
+
+/**
+ * @tparam KeyT element type of the cached sequence
+ * @tparam Policy match window and prefix parameters (see DefaultJaroPolicy)
+ */
+template <typename KeyT, typename Policy = DefaultJaroPolicy>
+struct CachedJaroWinklerSequenceSimilarity {
+    template <typename InputIt1>
+    CachedJaroWinklerSequenceSimilarity(InputIt1 first1, InputIt1 last1,
+                                        double prefix_weight_ = 0.1)
+        : s1(first1, last1), PM(s1.begin(), s1.end()), prefix_weight(prefix_weight_)
+    {
+        detail::validate_prefix_weight<Policy>(prefix_weight);
+    }
+
+    template <typename S1>
+    CachedJaroWinklerSequenceSimilarity(const S1& s1_, double prefix_weight_ = 0.1)
+        : CachedJaroWinklerSequenceSimilarity(std::begin(s1_), std::end(s1_), prefix_weight_)
+    {}
+
+    template <typename InputIt2>
+    double similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
+    {
+        return detail::jaro_winkler_similarity<Policy>(PM, s1.begin(), s1.end(), first2, last2,
+                                                       prefix_weight, score_cutoff);
+    }
+
+    template <typename S2>
+    double similarity(const S2& s2, double score_cutoff = 0) const
+    {
+        return similarity(std::begin(s2), std::end(s2), score_cutoff);
+    }
+
+    template <typename InputIt2>
+    double normalized_similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
+    {
+        return similarity(first2, last2, score_cutoff);
+    }
+
+    template <typename S2>
+    double normalized_similarity(const S2& s2, double score_cutoff = 0) const
+    {
+        return similarity(s2, score_cutoff);
+    }
+
+    /**
+     * @brief similarity with each sequence in [first, last)
+     *
+     * @param scores output with space for one score per sequence
+     */
+    template <typename InputIt2>
+    void similarity_batch(InputIt2 first, InputIt2 last, double* scores,
+                          double score_cutoff = 0) const
+    {
+        for (; first != last; ++first, ++scores) {
+            *scores = similarity(*first, score_cutoff);
+        }
+    }
+
+    /**
+     * @brief upper bound of the similarity with any sequence of the length
+     * len sharing a common prefix of the length prefix with the cached sequence
+     */
+    double max_possible_score(int64_t len, int64_t prefix = Policy::max_prefix()) const
+    {
+        return detail::jaro_winkler_max_possible_score<Policy>(static_cast<int64_t>(s1.size()),
+                                                               len, prefix, prefix_weight);
+    }
+
+private:
+    std::vector<KeyT> s1;
+    common::SequencePatternMatchVector PM;
+
+    double prefix_weight;
+};
+
+/**
+ * @tparam KeyT element type of the cached sequence
+ * @tparam Policy match window (see DefaultJaroPolicy)
+ */
+template <typename KeyT, typename Policy = DefaultJaroPolicy>
+struct CachedJaroSequenceSimilarity {
+    template <typename InputIt1>
+    CachedJaroSequenceSimilarity(InputIt1 first1, InputIt1 last1)
+        : s1(first1, last1), PM(s1.begin(), s1.end())
+    {}
+
+    template <typename S1>
+    CachedJaroSequenceSimilarity(const S1& s1_)
+        : CachedJaroSequenceSimilarity(std::begin(s1_), std::end(s1_))
+    {}
+
+    template <typename InputIt2>
+    double similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
+    {
+        return detail::jaro_similarity<Policy>(PM, s1.begin(), s1.end(), first2, last2,
+                                               score_cutoff);
+    }
+
+    template <typename S2>
+    double similarity(const S2& s2, double score_cutoff = 0) const
+    {
+        return similarity(std::begin(s2), std::end(s2), score_cutoff);
+    }
+
+    template <typename InputIt2>
+    double normalized_similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
+    {
+        return similarity(first2, last2, score_cutoff);
+    }
+
+    template <typename S2>
+    double normalized_similarity(const S2& s2, double score_cutoff = 0) const
+    {
+        return similarity(s2, score_cutoff);
+    }
+
+    /**
+     * @brief similarity with each sequence in [first, last)
+     *
+     * @param scores output with space for one score per sequence
+     */
+    template <typename InputIt2>
+    void similarity_batch(InputIt2 first, InputIt2 last, double* scores,
+                          double score_cutoff = 0) const
+    {
+        for (; first != last; ++first, ++scores) {
+            *scores = similarity(*first, score_cutoff);
+        }
+    }
+
+    /**
+     * @brief upper bound of the similarity with any sequence of the length len
+     */
+    double max_possible_score(int64_t len) const
+    {
+        return detail::jaro_max_possible_score(static_cast<int64_t>(s1.size()), len);
+    }
+
+    double max_possible_score(int64_t len, int64_t) const
+    {
+        return max_possible_score(len);
+    }
+
+private:
+    std::vector<KeyT> s1;
+    common::SequencePatternMatchVector PM;
+};
+
+/**@}*/
+
+} // namespace jaro_winkler
@@ -0,0 +1,410 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/parallel.hpp>
+#include <jaro_winkler/jaro_winkler.hpp>
+#include <jaro_winkler/process.hpp>
+#include <jaro_winkler/shared_index.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace jaro_winkler {
+
+/**
+ * @defgroup sharded_index sharded_index
+ * Top-k search over a set of choices split into multiple shards
+ *
+ * Every shard is a pattern set (e.g. CachedPatternSlab or MappedPatternIndex)
+ * holding a part of the choices and returns its local top-k. The shards of a
+ * query share a ShardCutoff: once a shard found k results, their worst score
+ * is a lower bound of the score of the k-th global result, so it is
+ * published to all other shards, which prune every choice below it. The
+ * local results are merged using merge_shard_results.
+ *
+ * ShardedPatternIndex runs all shards inside of a single process. Shards in
+ * different processes on the same host can share the cutoff through a
+ * MappedShardCutoff and return their results to the coordinator using any
+ * kind of IPC.
+ * @{
+ */
+
+/**
+ * @brief score cutoff shared between the shards of a query
+ *
+ * The cutoff only increases while a query runs. It does not contain any
+ * pointers and is lock free, so it can be placed in shared memory and used
+ * by multiple processes at once.
+ */
+class ShardCutoff {
+public:
+    explicit ShardCutoff(double score_cutoff = 0.0) : m_bits(to_bits(score_cutoff))
+    {}
+
+    ShardCutoff(const ShardCutoff&) = delete;
+    ShardCutoff& operator=(const ShardCutoff&) = delete;
+
+    double load() const
+    {
+        return from_bits(m_bits.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief increase the cutoff to score_cutoff. Lower values are ignored
+     */
+    void raise(double score_cutoff)
+    {
+        /* scores are never negative, so their bit patterns are ordered
+         * like the scores */
+        uint64_t bits = to_bits(score_cutoff);
+        uint64_t current = m_bits.load(std::memory_order_relaxed);
+        while (current < bits &&
+               !m_bits.compare_exchange_weak(current, bits, std::memory_order_relaxed))
+        {}
+    }
+
+    /**
+     * @brief set the cutoff before a new query is started
+     */
+    void reset(double score_cutoff = 0.0)
+    {
+        m_bits.store(to_bits(score_cutoff), std::memory_order_relaxed);
+    }
+
+    bool is_lock_free() const
+    {
+        return m_bits.is_lock_free();
+    }
+
+private:
+    static uint64_t to_bits(double score)
+    {
+        /* -0.0 would be ordered above every positive score */
+        if (!(score > 0.0)) score = 0.0;
+        uint64_t bits;
+        std::memcpy(&bits, &score, sizeof(bits));
+        return bits;
+    }
+
+    static double from_bits(uint64_t bits)
+    {
+        double score;
+        std::memcpy(&score, &bits, sizeof(score));
+        return score;
+    }
+
+    std::atomic<uint64_t> m_bits;
+};
+
+namespace detail {
+
+/* top-k of a single shard. score(handle, cutoff) returns the similarity of
+ * the query with a pattern of the shard */
+template <typename PatternSet, typename ScoreFunc>
+std::vector<ExtractMatch> shard_extract(const PatternSet& shard, size_t limit,
+                                        ShardCutoff& cutoff, int64_t index_offset,
+                                        ScoreFunc score)
+{
+    /* heap with the worst of the current results on top */
+    std::vector<ExtractMatch> heap;
+    if (!limit) return heap;
+
+    double local_cutoff = 0.0;
+    for (size_t handle = 0; handle < shard.size(); ++handle) {
+        double current_cutoff = std::max(local_cutoff, cutoff.load());
+        double sim = score(handle, current_cutoff);
+        if (sim < current_cutoff) continue;
+
+        int64_t index = index_offset + static_cast<int64_t>(handle);
+        if (heap.size() < limit) {
+            heap.push_back({index, sim});
+            std::push_heap(heap.begin(), heap.end(), extract_match_better);
+        }
+        /* on equal scores the earlier choice is kept */
+        else if (sim > heap.front().score) {
+            std::pop_heap(heap.begin(), heap.end(), extract_match_better);
+            heap.back() = {index, sim};
+            std::push_heap(heap.begin(), heap.end(), extract_match_better);
+        }
+        else {
+            continue;
+        }
+
+        if (heap.size() == limit) {
+            local_cutoff = heap.front().score;
+            cutoff.raise(local_cutoff);
+        }
+    }
+
+    std::sort(heap.begin(), heap.end(), extract_match_better);
+    return heap;
+}
+
+} // namespace detail
+
+/**
+ * @brief best `limit` patterns of a shard for a query using the Jaro-Winkler
+ * similarity
+ *
+ * @param shard pattern set holding a part of the choices
+ * @param query string compared with the patterns of the shard
+ * @param limit maximum number of results
+ * @param cutoff
+ *   cutoff shared with the other shards of the query. It has to be reset to
+ *   the score cutoff of the query before the first shard is started.
+ * @param prefix_weight
+ *   Weight used for the common prefix of the two strings.
+ *   Has to be between 0 and 0.25. Default is 0.1.
+ * @param index_offset
+ *   position of the first pattern of the shard in the list of all choices,
+ *   which is added to the index of the results
+ *
+ * @return matches sorted by descending score
+ */
+template <typename Policy = DefaultJaroPolicy, typename PatternSet, typename Sentence>
+std::vector<ExtractMatch> shard_extract_jaro_winkler(const PatternSet& shard,
+                                                     const Sentence& query, size_t limit,
+                                                     ShardCutoff& cutoff,
+                                                     double prefix_weight = 0.1,
+                                                     int64_t index_offset = 0)
+{
+    detail::validate_prefix_weight<Policy>(prefix_weight);
+    return detail::shard_extract(shard, limit, cutoff, index_offset,
+                                 [&](size_t handle, double score_cutoff) {
+                                     return shard.template jaro_winkler_similarity<Policy>(
+                                         handle, query, prefix_weight, score_cutoff);
+                                 });
+}
+
+/**
+ * @brief best `limit` patterns of a shard for a query using the Jaro
+ * similarity (see shard_extract_jaro_winkler)
+ */
+template <typename Policy = DefaultJaroPolicy, typename PatternSet, typename Sentence>
+std::vector<ExtractMatch> shard_extract_jaro(const PatternSet& shard, const Sentence& query,
+                                             size_t limit, ShardCutoff& cutoff,
+                                             int64_t index_offset = 0)
+{
+    return detail::shard_extract(shard, limit, cutoff, index_offset,
+                                 [&](size_t handle, double score_cutoff) {
+                                     return shard.template jaro_similarity<Policy>(
+                                         handle, query, score_cutoff);
+                                 });
+}
+
+/**
+ * @brief merge the results of the shards of a query
+ *
+ * @return best `limit` matches sorted by descending score. Matches with equal
+ *   scores are ordered by their index like in extract
+ */
+static inline std::vector<ExtractMatch>
+merge_shard_results(const std::vector<std::vector<ExtractMatch>>& shard_results, size_t limit)
+{
+    std::vector<ExtractMatch> res;
+    for (const auto& results : shard_results) {
+        res.insert(res.end(), results.begin(), results.end());
+    }
+
+    size_t count = std::min(limit, res.size());
+    std::partial_sort(res.begin(), res.begin() + static_cast<std::ptrdiff_t>(count), res.end(),
+                      detail::extract_match_better);
+    res.resize(count);
+    return res;
+}
+
+/**
+ * @brief choices split into shards, which are searched in parallel
+ *
+ * The results are the same as the results of extract with a cached scorer
+ * of the query over all choices.
+ *
+ * @tparam CharT1 character type of the stored strings
+ */
+template <typename CharT1>
+class ShardedPatternIndex {
+public:
+    /**
+     * @param choices strings, which are split into shards of similar size
+     * @param shard_count number of shards
+     * @param workers
+     *   number of threads used to build the pattern match vectors of each
+     *   shard. Values <= 0 use the number of hardware threads. Default is 1.
+     */
+    template <typename Choices>
+    ShardedPatternIndex(const Choices& choices, size_t shard_count, int64_t workers = 1)
+    {
+        if (!shard_count) throw std::invalid_argument("shard_count has to be positive");
+
+        size_t count = static_cast<size_t>(std::distance(std::begin(choices), std::end(choices)));
+        m_offsets.reserve(shard_count + 1);
+        m_shards.reserve(shard_count);
+        m_offsets.push_back(0);
+        for (size_t i = 0; i < shard_count; ++i) {
+            size_t first = count * i / shard_count;
+            size_t last = count * (i + 1) / shard_count;
+            auto it = std::begin(choices);
+            m_shards.emplace_back(std::next(it, static_cast<std::ptrdiff_t>(first)),
+                                  std::next(it, static_cast<std::ptrdiff_t>(last)), workers);
+            m_offsets.push_back(static_cast<int64_t>(last));
+        }
+    }
+
+    /**
+     * @brief total number of choices
+     */
+    size_t size() const
+    {
+        return static_cast<size_t>(m_offsets.back());
+    }
+
+    size_t shard_count() const
+    {
+        return m_shards.size();
+    }
+
+    const CachedPatternSlab<CharT1>& shard(size_t idx) const
+    {
+        return m_shards[idx];
+    }
+
+    /**
+     * @brief position of the first choice of a shard in the list of choices
+     */
+    int64_t shard_offset(size_t idx) const
+    {
+        return m_offsets[idx];
+    }
+
+    /**
+     * @brief find the best `limit` choices for a query using the Jaro-Winkler
+     * similarity
+     *
+     * @param workers
+     *   number of threads searching the shards. Values <= 0 use the number
+     *   of hardware threads. Default is 1.
+     *
+     * @return matches sorted by descending score
+     */
+    template <typename Policy = DefaultJaroPolicy, typename Sentence>
+    std::vector<ExtractMatch> extract_jaro_winkler(const Sentence& query, size_t limit,
+                                                   double prefix_weight = 0.1,
+                                                   double score_cutoff = 0.0,
+                                                   int64_t workers = 1) const
+    {
+        detail::validate_prefix_weight<Policy>(prefix_weight);
+        return search(limit, score_cutoff, workers, [&](size_t idx, ShardCutoff& cutoff) {
+            return shard_extract_jaro_winkler<Policy>(m_shards[idx], query, limit, cutoff,
+                                                      prefix_weight, m_offsets[idx]);
+        });
+    }
+
+    /**
+     * @brief find the best `limit` choices for a query using the Jaro
+     * similarity (see extract_jaro_winkler)
+     */
+    template <typename Policy = DefaultJaroPolicy, typename Sentence>
+    std::vector<ExtractMatch> extract_jaro(const Sentence& query, size_t limit,
+                                           double score_cutoff = 0.0, int64_t workers = 1) const
+    {
+        return search(limit, score_cutoff, workers, [&](size_t idx, ShardCutoff& cutoff) {
+            return shard_extract_jaro<Policy>(m_shards[idx], query, limit, cutoff,
+                                              m_offsets[idx]);
+        });
+    }
+
+private:
+    template <typename SearchShard>
+    std::vector<ExtractMatch> search(size_t limit, double score_cutoff, int64_t workers,
+                                     SearchShard search_shard) const
+    {
+        ShardCutoff cutoff(score_cutoff);
+        std::vector<std::vector<ExtractMatch>> results(m_shards.size());
+        common::parallel_for(static_cast<int64_t>(m_shards.size()), workers,
+                             [&](int64_t begin, int64_t end) {
+                                 for (int64_t i = begin; i < end; ++i) {
+                                     size_t idx = static_cast<size_t>(i);
+                                     results[idx] = search_shard(idx, cutoff);
+                                 }
+                             });
+        return merge_shard_results(results, limit);
+    }
+
+    std::vector<CachedPatternSlab<CharT1>> m_shards;
+    std::vector<int64_t> m_offsets;
+};
+
+#if JARO_WINKLER_HAS_MMAP
+/**
+ * @brief ShardCutoff stored in a file, which is mapped by every process
+ * searching a shard of the query
+ *
+ * The file should be placed in a memory backed file system like /dev/shm.
+ * It is created when it does not exist yet, which initializes the cutoff
+ * to 0. The coordinator resets the cutoff before every query.
+ */
+class MappedShardCutoff {
+public:
+    explicit MappedShardCutoff(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "failed to open " + path);
+        }
+
+        /* a zero filled file contains a cutoff of 0 */
+        struct stat st;
+        if (::fstat(fd, &st) < 0 ||
+            (static_cast<size_t>(st.st_size) < sizeof(ShardCutoff) &&
+             ::ftruncate(fd, sizeof(ShardCutoff)) < 0))
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "failed to resize " + path);
+        }
+
+        void* data =
+            ::mmap(nullptr, sizeof(ShardCutoff), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::system_error(err, std::generic_category(), "failed to map " + path);
+        }
+
+        m_cutoff = static_cast<ShardCutoff*>(data);
+        if (!m_cutoff->is_lock_free()) {
+            ::munmap(m_cutoff, sizeof(ShardCutoff));
+            throw std::runtime_error("ShardCutoff can't be shared between processes");
+        }
+    }
+
+    MappedShardCutoff(const MappedShardCutoff&) = delete;
+    MappedShardCutoff& operator=(const MappedShardCutoff&) = delete;
+
+    ~MappedShardCutoff()
+    {
+        ::munmap(m_cutoff, sizeof(ShardCutoff));
+    }
+
+    ShardCutoff& cutoff()
+    {
+        return *m_cutoff;
+    }
+
+private:
+    ShardCutoff* m_cutoff;
+};
+#endif
+
+/**@}*/
+
+} // namespace jaro_winkler
@@ -0,0 +1,434 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/jaro_winkler.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    define JARO_WINKLER_HAS_MMAP 1
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#else
+#    define JARO_WINKLER_HAS_MMAP 0
+#endif
+
+namespace jaro_winkler {
+
+/**
+ * @defgroup shared_index shared_index
+ * Read only pattern index, which can be placed in shared memory or a memory
+ * mapped file and used by multiple processes at once.
+ *
+ * The index only stores offsets relative to the start of the buffer, so it
+ * can be mapped at a different address in every process. When multiple
+ * processes map the same file (e.g. placed in /dev/shm) they share a single
+ * copy of the pattern match vectors in the page cache.
+ * @{
+ */
+
+namespace detail {
+
+static constexpr char shared_index_magic[8] = {'J', 'W', 'P', 'I', 'D', 'X', 0, 0};
+static constexpr uint32_t shared_index_version = 1;
+/* alignment of all sections inside the index */
+static constexpr uint64_t shared_index_alignment = 64;
+
+struct SharedIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t char_size;
+    uint64_t count;
+    uint64_t char_count;
+    uint64_t block_count;
+    uint64_t map_count;
+    /* byte offsets of the sections relative to the start of the index */
+    uint64_t pattern_offsets;
+    uint64_t block_offsets;
+    uint64_t map_offsets;
+    uint64_t chars;
+    uint64_t extended_ascii;
+    uint64_t maps;
+    uint64_t size;
+};
+
+static_assert(std::is_standard_layout<common::BitvectorHashmap>::value &&
+                  std::is_trivially_copyable<common::BitvectorHashmap>::value,
+              "BitvectorHashmap has to be stored in the index as raw bytes");
+
+static inline uint64_t shared_index_align(uint64_t offset)
+{
+    return common::ceildiv(offset, shared_index_alignment) * shared_index_alignment;
+}
+
+template <typename CharT1>
+SharedIndexHeader shared_index_layout(uint64_t count, uint64_t char_count, uint64_t block_count,
+                                      uint64_t map_count)
+{
+    SharedIndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, shared_index_magic, sizeof(header.magic));
+    header.version = shared_index_version;
+    header.char_size = sizeof(CharT1);
+    header.count = count;
+    header.char_count = char_count;
+    header.block_count = block_count;
+    header.map_count = map_count;
+
+    uint64_t offset = shared_index_align(sizeof(SharedIndexHeader));
+    header.pattern_offsets = offset;
+    offset = shared_index_align(offset + (count + 1) * sizeof(int64_t));
+    header.block_offsets = offset;
+    offset = shared_index_align(offset + (count + 1) * sizeof(int64_t));
+    header.map_offsets = offset;
+    offset = shared_index_align(offset + count * sizeof(int64_t));
+    header.chars = offset;
+    offset = shared_index_align(offset + char_count * sizeof(CharT1));
+    header.extended_ascii = offset;
+    offset = shared_index_align(offset + block_count * 256 * sizeof(uint64_t));
+    header.maps = offset;
+    offset = shared_index_align(offset + map_count * sizeof(common::BitvectorHashmap));
+    header.size = offset;
+    return header;
+}
+
+/**
+ * @brief true when the sections described by the counts of header fit into
+ * size bytes. This is checked before computing the layout, so corrupted
+ * counts can't overflow the section offsets.
+ */
+template <typename CharT1>
+bool shared_index_counts_fit(const SharedIndexHeader& header, uint64_t size)
+{
+    uint64_t remaining = size;
+    auto take = [&](uint64_t count, uint64_t elem_size) {
+        if (count > remaining / elem_size) return false;
+        remaining -= count * elem_size;
+        return true;
+    };
+
+    if (header.count >= size) return false;
+    return take(header.count + 1, sizeof(int64_t)) && take(header.count + 1, sizeof(int64_t)) &&
+           take(header.count, sizeof(int64_t)) && take(header.char_count, sizeof(CharT1)) &&
+           take(header.block_count, 256 * sizeof(uint64_t)) &&
+           take(header.map_count, sizeof(common::BitvectorHashmap));
+}
+
+[[noreturn]] static inline void invalid_shared_index(const char* reason)
+{
+    throw std::invalid_argument(std::string("invalid shared index: ") + reason);
+}
+
+} // namespace detail
+
+/**
+ * @brief size in bytes required to store slab as shared index
+ */
+template <typename CharT1>
+size_t shared_index_size(const CachedPatternSlab<CharT1>& slab)
+{
+    const auto& PM = slab.pattern_match_vectors();
+    uint64_t char_count = 0;
+    for (size_t i = 0; i < slab.size(); ++i) {
+        char_count += static_cast<uint64_t>(slab.pattern_length(i));
+    }
+
+    return static_cast<size_t>(
+        detail::shared_index_layout<CharT1>(slab.size(), char_count,
+                                            static_cast<uint64_t>(PM.block_offsets().back()),
+                                            PM.maps().size())
+            .size);
+}
+
+/**
+ * @brief store slab as shared index in buffer
+ *
+ * @param buffer
+ *   destination. To open it using SharedPatternIndexView, it has to be aligned
+ *   to 64 bytes (e.g. the start of a shared memory mapping)
+ * @param size
+ *   size of buffer, which has to be at least shared_index_size(slab)
+ */
+template <typename CharT1>
+void write_shared_index(const CachedPatternSlab<CharT1>& slab, void* buffer, size_t size)
+{
+    const auto& PM = slab.pattern_match_vectors();
+    uint64_t count = slab.size();
+    std::vector<int64_t> pattern_offsets(count + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        pattern_offsets[i + 1] = pattern_offsets[i] + slab.pattern_length(i);
+    }
+
+    auto header = detail::shared_index_layout<CharT1>(
+        count, static_cast<uint64_t>(pattern_offsets.back()),
+        static_cast<uint64_t>(PM.block_offsets().back()), PM.maps().size());
+    if (size < header.size) {
+        throw std::invalid_argument("buffer is too small for the shared index");
+    }
+
+    char* data = static_cast<char*>(buffer);
+    std::memset(data, 0, static_cast<size_t>(header.size));
+    std::memcpy(data, &header, sizeof(header));
+    std::memcpy(data + header.pattern_offsets, pattern_offsets.data(),
+                pattern_offsets.size() * sizeof(int64_t));
+    std::memcpy(data + header.block_offsets, PM.block_offsets().data(),
+                PM.block_offsets().size() * sizeof(int64_t));
+    if (count) {
+        std::memcpy(data + header.map_offsets, PM.map_offsets().data(),
+                    PM.map_offsets().size() * sizeof(int64_t));
+        std::memcpy(data + header.chars, slab.pattern_begin(0),
+                    static_cast<size_t>(header.char_count) * sizeof(CharT1));
+    }
+    if (header.block_count) {
+        std::memcpy(data + header.extended_ascii, PM.extended_ascii().data(),
+                    PM.extended_ascii().size() * sizeof(uint64_t));
+    }
+    if (header.map_count) {
+        std::memcpy(data + header.maps, PM.maps().data(),
+                    PM.maps().size() * sizeof(common::BitvectorHashmap));
+    }
+}
+
+/**
+ * @brief store slab as shared index in the file at path
+ */
+template <typename CharT1>
+void save_shared_index(const CachedPatternSlab<CharT1>& slab, const std::string& path)
+{
+    size_t size = shared_index_size(slab);
+    std::vector<uint64_t> buffer(common::ceildiv(size, sizeof(uint64_t)));
+    write_shared_index(slab, buffer.data(), size);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(size));
+    if (!file) {
+        throw std::system_error(errno, std::generic_category(), "failed to write " + path);
+    }
+}
+
+/**
+ * @brief non owning, read only view on a shared index
+ *
+ * The view provides the same scoring interface as CachedPatternSlab and
+ * can be used by any number of threads and processes concurrently.
+ *
+ * @tparam CharT1 character type the index was created with
+ */
+template <typename CharT1>
+struct SharedPatternIndexView : detail::PatternSetScoring<SharedPatternIndexView<CharT1>> {
+    using handle_type = size_t;
+
+    SharedPatternIndexView() : m_count(0)
+    {}
+
+    /**
+     * @param data start of the index, which has to be aligned to 64 bytes
+     * @param size size of the buffer containing the index
+     *
+     * @throws std::invalid_argument when the buffer does not contain a valid index
+     */
+    SharedPatternIndexView(const void* data, size_t size) : m_count(0)
+    {
+        const char* base = static_cast<const char*>(data);
+        if (reinterpret_cast<uintptr_t>(base) % detail::shared_index_alignment) {
+            detail::invalid_shared_index("buffer is not aligned");
+        }
+        if (size < sizeof(detail::SharedIndexHeader)) {
+            detail::invalid_shared_index("buffer is too small");
+        }
+
+        detail::SharedIndexHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, detail::shared_index_magic, sizeof(header.magic))) {
+            detail::invalid_shared_index("magic number does not match");
+        }
+        if (header.version != detail::shared_index_version) {
+            detail::invalid_shared_index("unsupported version");
+        }
+        if (header.char_size != sizeof(CharT1)) {
+            detail::invalid_shared_index("character size does not match");
+        }
+        if (!detail::shared_index_counts_fit<CharT1>(header, size)) {
+            detail::invalid_shared_index("buffer is smaller than the index");
+        }
+
+        auto expected = detail::shared_index_layout<CharT1>(header.count, header.char_count,
+                                                            header.block_count, header.map_count);
+        if (std::memcmp(&expected, &header, sizeof(header))) {
+            detail::invalid_shared_index("corrupted header");
+        }
+        if (size < header.size) {
+            detail::invalid_shared_index("buffer is smaller than the index");
+        }
+
+        m_count = static_cast<size_t>(header.count);
+        m_pattern_offsets = reinterpret_cast<const int64_t*>(base + header.pattern_offsets);
+        m_block_offsets = reinterpret_cast<const int64_t*>(base + header.block_offsets);
+        m_map_offsets = reinterpret_cast<const int64_t*>(base + header.map_offsets);
+        m_chars = reinterpret_cast<const CharT1*>(base + header.chars);
+        m_extendedAscii = reinterpret_cast<const uint64_t*>(base + header.extended_ascii);
+        m_maps = reinterpret_cast<const common::BitvectorHashmap*>(base + header.maps);
+
+        /* validate the offsets once, so lookups do not require bound checks */
+        if (m_pattern_offsets[0] != 0 || m_block_offsets[0] != 0) {
+            detail::invalid_shared_index("corrupted offsets");
+        }
+        for (size_t i = 0; i < m_count; ++i) {
+            int64_t len = m_pattern_offsets[i + 1] - m_pattern_offsets[i];
+            int64_t block_count = m_block_offsets[i + 1] - m_block_offsets[i];
+            int64_t map_offset = m_map_offsets[i];
+            if (len < 0 || block_count != common::ceildiv(len, 64) || map_offset < -1 ||
+                (map_offset >= 0 &&
+                 map_offset + block_count > static_cast<int64_t>(header.map_count)))
+            {
+                detail::invalid_shared_index("corrupted offsets");
+            }
+        }
+        if (m_pattern_offsets[m_count] != static_cast<int64_t>(header.char_count) ||
+            m_block_offsets[m_count] != static_cast<int64_t>(header.block_count))
+        {
+            detail::invalid_shared_index("corrupted offsets");
+        }
+
+        /* lookups of characters, which are not part of a pattern, would not
+         * terminate in a full hashmap */
+        for (uint64_t i = 0; i < header.map_count; ++i) {
+            if (!m_maps[i].has_free_slot()) detail::invalid_shared_index("corrupted hashmap");
+        }
+    }
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+    const CharT1* pattern_begin(handle_type handle) const
+    {
+        return m_chars + m_pattern_offsets[handle];
+    }
+
+    const CharT1* pattern_end(handle_type handle) const
+    {
+        return m_chars + m_pattern_offsets[handle + 1];
+    }
+
+    int64_t pattern_length(handle_type handle) const
+    {
+        return m_pattern_offsets[handle + 1] - m_pattern_offsets[handle];
+    }
+
+    common::BlockPatternMatchVectorView pattern_view(handle_type handle) const
+    {
+        int64_t block_offset = m_block_offsets[handle];
+        int64_t block_count = m_block_offsets[handle + 1] - block_offset;
+        const common::BitvectorHashmap* map =
+            (m_map_offsets[handle] < 0) ? nullptr : m_maps + m_map_offsets[handle];
+        return common::BlockPatternMatchVectorView(m_extendedAscii + block_offset * 256, map,
+                                                   block_count);
+    }
+
+private:
+    size_t m_count;
+    const int64_t* m_pattern_offsets = nullptr;
+    const int64_t* m_block_offsets = nullptr;
+    const int64_t* m_map_offsets = nullptr;
+    const CharT1* m_chars = nullptr;
+    const uint64_t* m_extendedAscii = nullptr;
+    const common::BitvectorHashmap* m_maps = nullptr;
+};
+
+/**
+ * @brief shared index loaded from a file
+ *
+ * On POSIX systems the file is mapped read only using mmap, so all processes
+ * opening the same file share the memory. On other systems the file is read
+ * into a private buffer.
+ *
+ * @tparam CharT1 character type the index was created with
+ */
+template <typename CharT1>
+class MappedPatternIndex : public SharedPatternIndexView<CharT1> {
+public:
+    explicit MappedPatternIndex(const std::string& path)
+    {
+#if JARO_WINKLER_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "failed to open " + path);
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) < 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "failed to stat " + path);
+        }
+
+        m_size = static_cast<size_t>(st.st_size);
+        void* data = m_size ? ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+        int err = errno;
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::system_error(err, std::generic_category(), "failed to map " + path);
+        }
+        m_data = data;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::system_error(errno, std::generic_category(), "failed to open " + path);
+        }
+        m_size = static_cast<size_t>(file.tellg());
+        m_buffer.resize(common::ceildiv(m_size, sizeof(uint64_t)));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<std::streamsize>(m_size));
+        m_data = m_buffer.data();
+#endif
+
+        try {
+            static_cast<SharedPatternIndexView<CharT1>&>(*this) =
+                SharedPatternIndexView<CharT1>(m_data, m_size);
+        }
+        catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    MappedPatternIndex(const MappedPatternIndex&) = delete;
+    MappedPatternIndex& operator=(const MappedPatternIndex&) = delete;
+
+    ~MappedPatternIndex()
+    {
+        release();
+    }
+
+private:
+    void release()
+    {
+#if JARO_WINKLER_HAS_MMAP
+        if (m_data) ::munmap(m_data, m_size);
+#endif
+        m_data = nullptr;
+    }
+
+    void* m_data = nullptr;
+    size_t m_size = 0;
+#if !JARO_WINKLER_HAS_MMAP
+    std::vector<uint64_t> m_buffer;
+#endif
+};
+
+/**@}*/
+
+} // namespace jaro_winkler
@@ -0,0 +1,339 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/jaro_winkler.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace jaro_winkler {
+
+namespace detail {
+
+/**
+ * ordering of tokens used by the token scorers. Characters are compared the
+ * same way the pattern match vectors compare them, so tokens of different
+ * character types can be merged.
+ */
+template <typename InputIt1, typename InputIt2>
+int compare_tokens(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2)
+{
+    for (; first1 != last1 && first2 != last2; ++first1, ++first2) {
+        auto ch1 = static_cast<uint64_t>(*first1);
+        auto ch2 = static_cast<uint64_t>(*first2);
+        if (ch1 != ch2) return (ch1 < ch2) ? -1 : 1;
+    }
+
+    if (first1 != last1) return 1;
+    if (first2 != last2) return -1;
+    return 0;
+}
+
+/**
+ * @brief sorted tokens of a string
+ *
+ * The characters are copied into a buffer and the tokens are stored as
+ * ranges into it, so an arena reused for multiple strings stops allocating
+ * once the buffers reached the size of the longest string.
+ */
+template <typename CharT>
+struct TokenArena {
+    struct Token {
+        size_t offset;
+        size_t length;
+    };
+
+    /**
+     * @brief split [first, last) on whitespace and sort the tokens
+     */
+    template <typename InputIt>
+    void tokenize(InputIt first, InputIt last, bool dedupe)
+    {
+        chars.assign(first, last);
+        tokens.clear();
+
+        size_t len = chars.size();
+        for (size_t pos = 0; pos < len;) {
+            if (is_whitespace(chars[pos])) {
+                pos++;
+                continue;
+            }
+
+            size_t start = pos;
+            while (pos < len && !is_whitespace(chars[pos])) {
+                pos++;
+            }
+            tokens.push_back({start, pos - start});
+        }
+
+        std::sort(tokens.begin(), tokens.end(), [&](const Token& a, const Token& b) {
+            return compare_tokens(begin(a), end(a), begin(b), end(b)) < 0;
+        });
+
+        if (dedupe) {
+            auto last_token =
+                std::unique(tokens.begin(), tokens.end(), [&](const Token& a, const Token& b) {
+                    return compare_tokens(begin(a), end(a), begin(b), end(b)) == 0;
+                });
+            tokens.erase(last_token, tokens.end());
+        }
+    }
+
+    typename std::basic_string<CharT>::const_iterator begin(const Token& token) const
+    {
+        return chars.begin() + static_cast<ptrdiff_t>(token.offset);
+    }
+
+    typename std::basic_string<CharT>::const_iterator end(const Token& token) const
+    {
+        return begin(token) + static_cast<ptrdiff_t>(token.length);
+    }
+
+    /**
+     * @brief append the token to out, separated by a space from the previous token
+     */
+    void append(std::basic_string<CharT>& out, const Token& token) const
+    {
+        if (!out.empty()) out.push_back(static_cast<CharT>(' '));
+        out.append(begin(token), end(token));
+    }
+
+    /**
+     * @brief all tokens separated by a single space
+     */
+    void join(std::basic_string<CharT>& out) const
+    {
+        out.clear();
+        for (const auto& token : tokens) {
+            append(out, token);
+        }
+    }
+
+    /**
+     * @brief arena of the current thread used to tokenize the choices
+     */
+    static TokenArena& scratch()
+    {
+        static thread_local TokenArena arena;
+        return arena;
+    }
+
+    std::basic_string<CharT> chars;
+    std::vector<Token> tokens;
+    /* joined forms of the tokens build by the scorers */
+    std::basic_string<CharT> joined;
+    std::basic_string<CharT> joined_sect;
+};
+
+} // namespace detail
+
+/**
+ * @brief Jaro-Winkler similarity of the sorted tokens of two strings
+ *
+ * Both strings are split on whitespace, the tokens are sorted and joined
+ * with a single space before they are compared. This makes the similarity
+ * independent of the order of the words, e.g. "john smith" and "smith john"
+ * have a similarity of 1.0. The query is tokenized once and the pattern
+ * match vector of its joined form is cached.
+ *
+ * @tparam CharT1 character type of the cached string
+ */
+template <typename CharT1, typename Policy = DefaultJaroPolicy>
+struct CachedTokenSortJaroWinklerSimilarity {
+    template <typename InputIt1>
+    CachedTokenSortJaroWinklerSimilarity(InputIt1 first1, InputIt1 last1,
+                                         double prefix_weight_ = 0.1)
+        : scorer(sorted_tokens(first1, last1), prefix_weight_)
+    {}
+
+    template <typename S1>
+    CachedTokenSortJaroWinklerSimilarity(const S1& s1_, double prefix_weight_ = 0.1)
+        : CachedTokenSortJaroWinklerSimilarity(std::begin(s1_), std::end(s1_), prefix_weight_)
+    {}
+
+    template <typename InputIt2>
+    double similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
+    {
+        using CharT2 = typename std::iterator_traits<InputIt2>::value_type;
+        auto& arena = detail::TokenArena<CharT2>::scratch();
+        arena.tokenize(first2, last2, false);
+        arena.join(arena.joined);
+        return scorer.similarity(arena.joined, score_cutoff);
+    }
+
+    template <typename S2>
+    double similarity(const S2& s2, double score_cutoff = 0) const
+    {
+        return similarity(std::begin(s2), std::end(s2), score_cutoff);
+    }
+
+private:
+    template <typename InputIt1>
+    static std::basic_string<CharT1> sorted_tokens(InputIt1 first1, InputIt1 last1)
+    {
+        detail::TokenArena<CharT1> arena;
+        arena.tokenize(first1, last1, false);
+        arena.join(arena.joined);
+        return arena.joined;
+    }
+
+    CachedJaroWinklerSimilarity<CharT1, Policy> scorer;
+};
+
+/**
+ * @brief Jaro-Winkler similarity of the token sets of two strings
+ *
+ * Both strings are split on whitespace into sets of unique tokens. With the
+ * sorted intersection `sect` of both sets and the sorted differences `diff_ab`
+ * and `diff_ba` the similarity is the maximum of
+ *
+ *     similarity(sect, sect + diff_ab)
+ *     similarity(sect, sect + diff_ba)
+ *     similarity(sect + diff_ab, sect + diff_ba)
+ *
+ * where the parts are joined with a single space. So when the tokens of one
+ * string are a subset of the tokens of the other string the similarity is 1.0.
+ * Without common tokens this is the similarity of the sorted token sets.
+ *
+ * The query is tokenized once and the pattern match vector of its joined
+ * token set is cached. Every comparison uses the best similarity found so
+ * far as score_cutoff, so comparisons, which can not improve the result, exit
+ * early.
+ *
+ * @tparam CharT1 character type of the cached string
+ */
+template <typename CharT1, typename Policy = DefaultJaroPolicy>
+struct CachedTokenSetJaroWinklerSimilarity {
+    template <typename InputIt1>
+    CachedTokenSetJaroWinklerSimilarity(InputIt1 first1, InputIt1 last1,
+                                        double prefix_weight_ = 0.1)
+        : tokens(tokenize(first1, last1)), scorer(tokens.joined, prefix_weight_),
+          prefix_weight(prefix_weight_)
+    {}
+
+    template <typename S1>
+    CachedTokenSetJaroWinklerSimilarity(const S1& s1_, double prefix_weight_ = 0.1)
+        : CachedTokenSetJaroWinklerSimilarity(std::begin(s1_), std::end(s1_), prefix_weight_)
+    {}
+
+    template <typename InputIt2>
+    double similarity(InputIt2 first2, InputIt2 last2, double score_cutoff = 0) const
+    {
+        using CharT2 = typename std::iterator_traits<InputIt2>::value_type;
+        auto& arena = detail::TokenArena<CharT2>::scratch();
+        arena.tokenize(first2, last2, true);
+
+        if (tokens.tokens.empty() || arena.tokens.empty()) return 0.0;
+
+        /* merge the sorted token sets into the intersection and differences */
+        static thread_local std::basic_string<CharT1> diff_ab;
+        diff_ab.clear();
+        arena.joined.clear();
+        arena.joined_sect.clear();
+        auto it1 = tokens.tokens.begin();
+        auto it2 = arena.tokens.begin();
+        while (it1 != tokens.tokens.end() || it2 != arena.tokens.end()) {
+            int cmp = 0;
+            if (it1 == tokens.tokens.end())
+                cmp = 1;
+            else if (it2 == arena.tokens.end())
+                cmp = -1;
+            else
+                cmp = detail::compare_tokens(tokens.begin(*it1), tokens.end(*it1),
+                                             arena.begin(*it2), arena.end(*it2));
+
+            if (cmp < 0) {
+                tokens.append(diff_ab, *it1++);
+            }
+            else if (cmp > 0) {
+                arena.append(arena.joined, *it2++);
+            }
+            else {
+                arena.append(arena.joined_sect, *it2++);
+                ++it1;
+            }
+        }
+
+        const auto& sect = arena.joined_sect;
+        const auto& diff_ba = arena.joined;
+        if (sect.empty()) return scorer.similarity(diff_ba, score_cutoff);
+        if (diff_ab.empty() || diff_ba.empty()) return 1.0;
+
+        /* sect + diff_ab and sect + diff_ba */
+        static thread_local std::basic_string<CharT1> ab;
+        static thread_local std::basic_string<CharT2> ba;
+        ab.assign(sect.begin(), sect.end());
+        ab.push_back(static_cast<CharT1>(' '));
+        ab.append(diff_ab);
+        ba.assign(sect.begin(), sect.end());
+        ba.push_back(static_cast<CharT2>(' '));
+        ba.append(diff_ba);
+
+        double best = 0;
+        auto compare = [&](const auto& s1, const auto& s2) {
+            double Sim = detail::jaro_winkler_similarity<Policy>(
+                std::begin(s1), std::end(s1), std::begin(s2), std::end(s2), prefix_weight,
+                std::max(score_cutoff, best));
+            best = std::max(best, Sim);
+        };
+
+        compare(sect, ab);
+        compare(sect, ba);
+        compare(ab, ba);
+        return common::result_cutoff(best, score_cutoff);
+    }
+
+    template <typename S2>
+    double similarity(const S2& s2, double score_cutoff = 0) const
+    {
+        return similarity(std::begin(s2), std::end(s2), score_cutoff);
+    }
+
+private:
+    template <typename InputIt1>
+    static detail::TokenArena<CharT1> tokenize(InputIt1 first1, InputIt1 last1)
+    {
+        detail::TokenArena<CharT1> arena;
+        arena.tokenize(first1, last1, true);
+        arena.join(arena.joined);
+        return arena;
+    }
+
+    detail::TokenArena<CharT1> tokens;
+    CachedJaroWinklerSimilarity<CharT1, Policy> scorer;
+    double prefix_weight;
+};
+
+/**
+ * @brief Jaro-Winkler similarity of the sorted tokens of s1 and s2
+ * (see CachedTokenSortJaroWinklerSimilarity)
+ */
+template <typename Policy = DefaultJaroPolicy, typename S1, typename S2>
+double token_sort_jaro_winkler_similarity(const S1& s1, const S2& s2, double prefix_weight = 0.1,
+                                          double score_cutoff = 0.0)
+{
+    using CharT1 = typename std::decay<decltype(*std::begin(s1))>::type;
+    return CachedTokenSortJaroWinklerSimilarity<CharT1, Policy>(s1, prefix_weight)
+        .similarity(s2, score_cutoff);
+}
+
+/**
+ * @brief Jaro-Winkler similarity of the token sets of s1 and s2
+ * (see CachedTokenSetJaroWinklerSimilarity)
+ */
+template <typename Policy = DefaultJaroPolicy, typename S1, typename S2>
+double token_set_jaro_winkler_similarity(const S1& s1, const S2& s2, double prefix_weight = 0.1,
+                                         double score_cutoff = 0.0)
+{
+    using CharT1 = typename std::decay<decltype(*std::begin(s1))>::type;
+    return CachedTokenSetJaroWinklerSimilarity<CharT1, Policy>(s1, prefix_weight)
+        .similarity(s2, score_cutoff);
+}
+
+} // namespace jaro_winkler
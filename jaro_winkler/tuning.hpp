@@ -0,0 +1,261 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright © 2022 Max Bachmann */
+
+#pragma once
+#include <jaro_winkler/details/tuning_profile.hpp>
+#include <jaro_winkler/process.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace jaro_winkler {
+
+/**
+ * @brief write a profile in a line based text format, which can be read
+ * again using load_tuning_profile
+ */
+static inline void save_tuning_profile(const TuningProfile& profile, std::ostream& stream)
+{
+    stream << "jaro_winkler_tuning_profile 1\n"
+           << "lane_min_length " << profile.lane_min_length << "\n"
+           << "max_lanes " << profile.max_lanes << "\n"
+           << "tile_l1_budget " << profile.tile_l1_budget << "\n"
+           << "tile_l2_budget " << profile.tile_l2_budget << "\n";
+}
+
+static inline void save_tuning_profile(const TuningProfile& profile, const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) throw std::system_error(errno, std::generic_category(), "failed to open " + path);
+
+    save_tuning_profile(profile, file);
+    file.flush();
+    if (!file) throw std::system_error(errno, std::generic_category(), "failed to write " + path);
+}
+
+/**
+ * @brief read a profile written by save_tuning_profile. Unknown keys are
+ * ignored and missing keys keep their default value, so profiles remain
+ * readable when keys are added or removed.
+ */
+static inline TuningProfile load_tuning_profile(std::istream& stream)
+{
+    std::string line;
+    if (!std::getline(stream, line) || line != "jaro_winkler_tuning_profile 1") {
+        throw std::invalid_argument("not a tuning profile");
+    }
+
+    TuningProfile profile;
+    while (std::getline(stream, line)) {
+        if (line.empty()) continue;
+
+        std::istringstream fields(line);
+        std::string key;
+        int64_t value = 0;
+        if (!(fields >> key >> value)) {
+            throw std::invalid_argument("invalid line in tuning profile: " + line);
+        }
+
+        if (key == "lane_min_length") profile.lane_min_length = value;
+        if (key == "max_lanes") profile.max_lanes = value;
+        if (key == "tile_l1_budget") profile.tile_l1_budget = value;
+        if (key == "tile_l2_budget") profile.tile_l2_budget = value;
+    }
+
+    profile.validate();
+    return profile;
+}
+
+static inline TuningProfile load_tuning_profile(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) throw std::system_error(errno, std::generic_category(), "failed to open " + path);
+    return load_tuning_profile(file);
+}
+
+namespace detail {
+
+static inline std::vector<std::string> tuning_strings(size_t count, size_t min_len,
+                                                      size_t max_len, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> len_dist(min_len, max_len);
+    /* a small alphabet, so the strings share characters like real words */
+    std::uniform_int_distribution<int> char_dist('a', 'p');
+
+    std::vector<std::string> strings(count);
+    for (auto& str : strings) {
+        str.resize(len_dist(gen));
+        for (auto& ch : str) {
+            ch = static_cast<char>(char_dist(gen));
+        }
+    }
+    return strings;
+}
+
+/* fastest runtime of func in seconds */
+template <typename Func>
+double tuning_measure(int64_t repetitions, Func func)
+{
+    double best = std::numeric_limits<double>::infinity();
+    for (int64_t i = 0; i < std::max<int64_t>(repetitions, 1); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+/* changes are only made for a clear improvement, so measurement noise does
+ * not move the profile away from the defaults */
+static inline bool tuning_faster(double time, double best)
+{
+    return time < best * 0.97;
+}
+
+/* runtime of similarity_batch for texts of the length len using profile.
+ * The profile is passed explicitly, so other threads keep using the active one */
+static inline double tuning_measure_batch(const TuningProfile& profile, size_t len,
+                                          int64_t repetitions)
+{
+    auto patterns = tuning_strings(8, len, len, 1);
+    auto texts = tuning_strings(2048, len, len, 2);
+    std::vector<double> scores(texts.size());
+
+    return tuning_measure(repetitions, [&]() {
+        for (const auto& pattern : patterns) {
+            common::BlockPatternMatchVector PM(pattern.begin(), pattern.end());
+            jaro_similarity_batch(PM, pattern.begin(), pattern.end(), texts.begin(), texts.end(),
+                                  0.0, scores.data(), profile);
+        }
+    });
+}
+
+} // namespace detail
+
+/**
+ * @brief measure the thresholds of the bulk APIs on the current host
+ *
+ * The SIMD lanes and the scalar word kernel are compared on synthetic texts
+ * of different lengths and the cdist tile budgets are selected by running
+ * cdist with different budgets. This takes up to a few seconds. The returned
+ * profile is not activated, so it can be inspected, saved and activated
+ * using set_tuning_profile(). The measurements do not change the active
+ * profile, so autotune can run while other threads use the bulk APIs.
+ *
+ * @param repetitions number of times every measurement is repeated. The
+ *   fastest run is used.
+ */
+static inline TuningProfile autotune(int64_t repetitions = 3)
+{
+    TuningProfile profile;
+    int64_t hw_lanes = detail::hardware_lane_count();
+    if (!hw_lanes) {
+        profile.max_lanes = 0;
+    }
+    else {
+        /* wider lanes are not faster on every CPU, e.g. when AVX-512 lowers
+         * the clock frequency */
+        TuningProfile lanes = profile;
+        lanes.lane_min_length = 0;
+        double best = std::numeric_limits<double>::infinity();
+        for (int64_t width = hw_lanes; width >= 4; width /= 2) {
+            lanes.max_lanes = width;
+            double time = detail::tuning_measure_batch(lanes, 48, repetitions);
+            if (detail::tuning_faster(time, best)) {
+                best = time;
+                profile.max_lanes = width;
+            }
+        }
+
+        /* shortest length from which on the lanes are faster for all lengths */
+        TuningProfile scalar = profile;
+        scalar.lane_min_length = std::numeric_limits<int64_t>::max();
+        lanes.max_lanes = profile.max_lanes;
+        profile.lane_min_length = 65;
+        for (size_t len : {64, 48, 40, 32, 24, 20, 16, 12, 8}) {
+            double lane_time = detail::tuning_measure_batch(lanes, len, repetitions);
+            double scalar_time = detail::tuning_measure_batch(scalar, len, repetitions);
+            if (lane_time >= scalar_time) break;
+            profile.lane_min_length = static_cast<int64_t>(len);
+        }
+    }
+
+    /* coordinate search of the tile budgets starting from the defaults */
+    auto queries = detail::tuning_strings(128, 16, 48, 3);
+    auto choices = detail::tuning_strings(2048, 16, 48, 4);
+    auto measure_cdist = [&](const TuningProfile& candidate) {
+        CdistOptions options;
+        options.tiling = cdist_default_tiling(detail::average_length(queries),
+                                              detail::average_length(choices), sizeof(char),
+                                              candidate);
+        return detail::tuning_measure(repetitions, [&]() {
+            auto matrix = cdist_jaro_winkler(queries, choices, options);
+            if (matrix.empty()) throw std::logic_error("cdist returned no results");
+        });
+    };
+
+    double best = measure_cdist(profile);
+    for (int64_t l2_budget : {64 * 1024, 256 * 1024, 512 * 1024}) {
+        TuningProfile candidate = profile;
+        candidate.tile_l2_budget = l2_budget;
+        double time = measure_cdist(candidate);
+        if (detail::tuning_faster(time, best)) {
+            best = time;
+            profile = candidate;
+        }
+    }
+    for (int64_t l1_budget : {8 * 1024, 32 * 1024}) {
+        TuningProfile candidate = profile;
+        candidate.tile_l1_budget = l1_budget;
+        double time = measure_cdist(candidate);
+        if (detail::tuning_faster(time, best)) {
+            best = time;
+            profile = candidate;
+        }
+    }
+
+    return profile;
+}
+
+/**
+ * @brief activate the profile stored at path. When the file does not exist
+ * or can't be read, a new profile is measured using autotune() and stored at
+ * path, so the tuning only runs on the first start on a host.
+ *
+ * @return the activated profile
+ */
+static inline TuningProfile load_or_autotune(const std::string& path)
+{
+    TuningProfile profile;
+    try {
+        profile = load_tuning_profile(path);
+    }
+    catch (const std::exception&) {
+        profile = autotune();
+        try {
+            save_tuning_profile(profile, path);
+        }
+        catch (const std::system_error&) {
+            /* the profile is still used when it can't be stored */
+        }
+    }
+
+    set_tuning_profile(profile);
+    return profile;
+}
+
+} // namespace jaro_winkler
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/jaro_winkler.hpp>
+#include <jaro_winkler_c.h>
+
+/* the same texts stored using the different kinds */
+struct TestStrings {
+    std::vector<std::string> u8;
+    std::vector<std::u16string> u16;
+    std::vector<std::u32string> u32;
+
+    explicit TestStrings(const std::vector<std::string>& texts) : u8(texts)
+    {
+        for (const auto& text : texts) {
+            u16.emplace_back(text.begin(), text.end());
+            u32.emplace_back(text.begin(), text.end());
+        }
+    }
+
+    /* the kind of every string is selected by its position */
+    std::vector<jw_string> mixed(size_t shift = 0) const
+    {
+        std::vector<jw_string> strings;
+        for (size_t i = 0; i < u8.size(); ++i) {
+            switch ((i + shift) % 3) {
+            case 0: strings.push_back({u8[i].data(), u8[i].size(), JW_KIND_UINT8}); break;
+            case 1: strings.push_back({u16[i].data(), u16[i].size(), JW_KIND_UINT16}); break;
+            default: strings.push_back({u32[i].data(), u32[i].size(), JW_KIND_UINT32}); break;
+            }
+        }
+        return strings;
+    }
+};
+
+static const std::vector<std::string> texts = {
+    "",        "a",         "aaaa",      "Johnathan", "Jonathan", "Johnathan", "Jon",
+    "Jonathon", "Johnny",   "abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123"};
+
+TEST_CASE("C API scorer")
+{
+    TestStrings strings(texts);
+    auto choices = strings.mixed();
+
+    for (size_t i = 0; i < texts.size(); ++i) {
+        auto patterns = strings.mixed(i);
+        jw_scorer* jaro = nullptr;
+        jw_scorer* winkler = nullptr;
+        REQUIRE(jw_scorer_new_jaro(&patterns[i], &jaro) == JW_OK);
+        REQUIRE(jw_scorer_new_jaro_winkler(&patterns[i], 0.2, &winkler) == JW_OK);
+
+        for (double cutoff : {0.0, 0.8}) {
+            std::vector<double> jaro_scores(choices.size());
+            std::vector<double> winkler_scores(choices.size());
+            REQUIRE(jw_scorer_similarity_batch(jaro, choices.data(), choices.size(), cutoff,
+                                               jaro_scores.data()) == JW_OK);
+            REQUIRE(jw_scorer_similarity_batch(winkler, choices.data(), choices.size(), cutoff,
+                                               winkler_scores.data()) == JW_OK);
+
+            for (size_t j = 0; j < choices.size(); ++j) {
+                double expected_jaro =
+                    jaro_winkler::jaro_similarity(texts[i], texts[j], cutoff);
+                double expected_winkler =
+                    jaro_winkler::jaro_winkler_similarity(texts[i], texts[j], 0.2, cutoff);
+                REQUIRE(jaro_scores[j] == expected_jaro);
+                REQUIRE(winkler_scores[j] == expected_winkler);
+
+                double score = -1;
+                REQUIRE(jw_scorer_similarity(winkler, &choices[j], cutoff, &score) == JW_OK);
+                REQUIRE(score == expected_winkler);
+            }
+        }
+
+        jw_scorer_free(jaro);
+        jw_scorer_free(winkler);
+    }
+}
+
+TEST_CASE("C API index")
+{
+    TestStrings strings(texts);
+    auto choices = strings.mixed();
+
+    for (size_t shift = 0; shift < 3; ++shift) {
+        auto patterns = strings.mixed(shift);
+        jw_index* index = nullptr;
+        REQUIRE(jw_index_new(patterns.data(), patterns.size(), 2, &index) == JW_OK);
+        REQUIRE(jw_index_size(index) == patterns.size());
+
+        for (int64_t workers : {1, 4}) {
+            std::vector<double> jaro(patterns.size() * choices.size());
+            std::vector<double> winkler(patterns.size() * choices.size());
+            REQUIRE(jw_index_cdist_jaro(index, choices.data(), choices.size(), 0.5, workers,
+                                        jaro.data()) == JW_OK);
+            REQUIRE(jw_index_cdist_jaro_winkler(index, choices.data(), choices.size(), 0.1, 0.5,
+                                                workers, winkler.data()) == JW_OK);
+
+            for (size_t q = 0; q < patterns.size(); ++q) {
+                for (size_t c = 0; c < choices.size(); ++c) {
+                    size_t pos = q * choices.size() + c;
+                    REQUIRE(jaro[pos] == jaro_winkler::jaro_similarity(texts[q], texts[c], 0.5));
+                    REQUIRE(winkler[pos] ==
+                            jaro_winkler::jaro_winkler_similarity(texts[q], texts[c], 0.1, 0.5));
+                }
+            }
+        }
+
+        jw_index_free(index);
+    }
+}
+
+TEST_CASE("C API pairwise")
+{
+    TestStrings strings(texts);
+    auto a = strings.mixed();
+
+    for (size_t shift = 0; shift < 3; ++shift) {
+        /* pair every text with the next one, so the pairs have different kinds */
+        std::vector<jw_string> b = strings.mixed(shift);
+        std::rotate(b.begin(), b.begin() + 1, b.end());
+
+        std::vector<double> jaro(a.size());
+        std::vector<double> winkler(a.size());
+        REQUIRE(jw_pairwise_jaro(a.data(), b.data(), a.size(), 0, 2, jaro.data()) == JW_OK);
+        REQUIRE(jw_pairwise_jaro_winkler(a.data(), b.data(), a.size(), 0.1, 0, 2,
+                                         winkler.data()) == JW_OK);
+
+        for (size_t i = 0; i < a.size(); ++i) {
+            const auto& other = texts[(i + 1) % texts.size()];
+            REQUIRE(jaro[i] == jaro_winkler::jaro_similarity(texts[i], other));
+            REQUIRE(winkler[i] == jaro_winkler::jaro_winkler_similarity(texts[i], other));
+        }
+    }
+}
+
+TEST_CASE("C API errors")
+{
+    std::string text = "text";
+    jw_string valid = {text.data(), text.size(), JW_KIND_UINT8};
+    jw_string invalid_kind = {text.data(), text.size(), 3};
+    jw_string null_data = {nullptr, 4, JW_KIND_UINT8};
+    jw_string empty = {nullptr, 0, JW_KIND_UINT8};
+
+    REQUIRE(jw_api_version() == JW_C_API_VERSION);
+
+    jw_scorer* scorer = nullptr;
+    REQUIRE(jw_scorer_new_jaro(&invalid_kind, &scorer) == JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(scorer == nullptr);
+    REQUIRE(std::string(jw_last_error()) == "invalid string kind");
+    REQUIRE(jw_scorer_new_jaro(&null_data, &scorer) == JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(jw_scorer_new_jaro_winkler(&valid, 0.5, &scorer) == JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(jw_scorer_new_jaro(&valid, nullptr) == JW_ERROR_INVALID_ARGUMENT);
+
+    REQUIRE(jw_scorer_new_jaro(&empty, &scorer) == JW_OK);
+    double score = -1;
+    REQUIRE(jw_scorer_similarity(scorer, &empty, 0, &score) == JW_OK);
+    REQUIRE(score == jaro_winkler::jaro_similarity(std::string(), std::string()));
+    REQUIRE(jw_scorer_similarity(scorer, &invalid_kind, 0, &score) == JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(jw_scorer_similarity_batch(scorer, &valid, 1, 0, nullptr) ==
+            JW_ERROR_INVALID_ARGUMENT);
+    jw_scorer_free(scorer);
+
+    jw_index* index = nullptr;
+    REQUIRE(jw_index_new(&invalid_kind, 1, 1, &index) == JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(jw_index_new(&valid, 1, 1, &index) == JW_OK);
+    double matrix[2] = {};
+    jw_string choices[2] = {valid, invalid_kind};
+    REQUIRE(jw_index_cdist_jaro(index, choices, 2, 0, 1, matrix) == JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(jw_index_cdist_jaro_winkler(index, choices, 1, 0.5, 0, 1, matrix) ==
+            JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(jw_index_cdist_jaro(index, choices, 1, 0, 1, nullptr) == JW_ERROR_INVALID_ARGUMENT);
+    jw_index_free(index);
+
+    REQUIRE(jw_pairwise_jaro(choices, choices, 2, 0, 1, matrix) == JW_ERROR_INVALID_ARGUMENT);
+    REQUIRE(jw_pairwise_jaro_winkler(choices, choices, 1, -0.1, 0, 1, matrix) ==
+            JW_ERROR_INVALID_ARGUMENT);
+
+    /* freeing NULL handles is allowed */
+    jw_scorer_free(nullptr);
+    jw_index_free(nullptr);
+}
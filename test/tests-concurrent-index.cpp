@@ -0,0 +1,103 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/concurrent_index.hpp>
+
+static const std::vector<std::string> index_strings = {
+    "james", "robert", "john", "michael", "william", "david", "joseph", "thomas",
+    "charles", "mary", "patricia", "jennifer", "linda", "elizabeth", "barbara",
+    std::string(80, 'a') + "susan", "jessica sarah karen susan barbara linda mary patricia jennifer"
+};
+
+TEST_CASE("ConcurrentPatternIndex")
+{
+    SECTION("insert and erase")
+    {
+        jaro_winkler::ConcurrentPatternIndex<char> index;
+        for (size_t i = 0; i < 200; ++i)
+        {
+            REQUIRE(index.insert(index_strings[i % index_strings.size()]) == i);
+        }
+        REQUIRE(index.size() == 200);
+
+        {
+            auto reader = index.reader();
+            REQUIRE(index.erase(3));
+            REQUIRE(!index.erase(3));
+            REQUIRE(!index.erase(500));
+
+            /* the reader entered before the removal, so the entry has to stay alive */
+            REQUIRE(index.retired_count() == 1);
+            REQUIRE(!reader.contains(3));
+            REQUIRE(reader.jaro_winkler_similarity(3, "michael") == 0);
+        }
+
+        index.collect();
+        REQUIRE(index.retired_count() == 0);
+
+        auto reader = index.reader();
+        REQUIRE(reader.size() == 200);
+        for (size_t i = 0; i < 200; ++i)
+        {
+            if (i == 3) continue;
+            const auto& s1 = index_strings[i % index_strings.size()];
+            REQUIRE(reader.pattern(i) == s1);
+            for (const auto& s2 : index_strings)
+            {
+                REQUIRE(reader.jaro_winkler_similarity(i, s2) ==
+                        jaro_winkler::jaro_winkler_similarity(s1, s2));
+                REQUIRE(reader.jaro_similarity(i, s2, 0.8) ==
+                        jaro_winkler::jaro_similarity(s1, s2, 0.8));
+            }
+        }
+    }
+
+    SECTION("readers run concurrently to writers")
+    {
+        jaro_winkler::ConcurrentPatternIndex<char> index;
+        std::atomic<bool> done(false);
+        std::atomic<int64_t> mismatches(0);
+        const size_t inserts = 3000;
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t)
+        {
+            readers.emplace_back([&, t]() {
+                const auto& query = index_strings[static_cast<size_t>(t)];
+                while (!done.load())
+                {
+                    auto reader = index.reader();
+                    for (size_t i = 0; i < reader.size(); ++i)
+                    {
+                        double score = reader.jaro_winkler_similarity(i, query);
+                        double expected = jaro_winkler::jaro_winkler_similarity(
+                            index_strings[i % index_strings.size()], query);
+                        if (score != expected && score != 0) mismatches++;
+                    }
+                }
+            });
+        }
+
+        for (size_t i = 0; i < inserts; ++i)
+        {
+            size_t handle = index.insert(index_strings[i % index_strings.size()]);
+            if (handle % 3 == 0) index.erase(handle);
+        }
+        done = true;
+        for (auto& reader : readers) reader.join();
+
+        REQUIRE(mismatches == 0);
+        REQUIRE(index.size() == inserts);
+        index.collect();
+        REQUIRE(index.retired_count() == 0);
+
+        auto reader = index.reader();
+        for (size_t i = 0; i < inserts; ++i)
+        {
+            REQUIRE(reader.contains(i) == (i % 3 != 0));
+        }
+    }
+}
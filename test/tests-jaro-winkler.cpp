@@ -1,4 +1,6 @@
 #include <bitset>
+#include <random>
+#include <stdexcept>
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
@@ -23,22 +25,22 @@ struct FlaggedCharsOriginal {
     int64_t CommonChars;
 };
 
-template <typename CharT1, typename CharT2>
+template <typename Policy, typename CharT1, typename CharT2>
 size_t get_jaro_bound(const std::basic_string<CharT1>& P, const std::basic_string<CharT2>& T)
 {
-    size_t Bound = std::max(P.size(), T.size()) / 2;
-    if (Bound > 0) Bound--;
-    return Bound;
+    int64_t Bound = Policy::match_window(static_cast<int64_t>(P.size()),
+                                         static_cast<int64_t>(T.size()));
+    return static_cast<size_t>(std::max<int64_t>(Bound, 0));
 }
 
-template <typename CharT1, typename CharT2>
+template <typename Policy = jaro_winkler::DefaultJaroPolicy, typename CharT1, typename CharT2>
 static inline FlaggedCharsOriginal flag_similar_characters_original(
     const std::basic_string<CharT1>& P, const std::basic_string<CharT2>& T)
 {
     std::vector<int> P_flag(P.size() + 1);
     std::vector<int> T_flag(T.size() + 1);
 
-    size_t Bound = get_jaro_bound(P, T);
+    size_t Bound = get_jaro_bound<Policy>(P, T);
 
     int64_t CommonChars = 0;
     for (size_t i = 0; i < T.size(); i++) {
@@ -58,11 +60,11 @@ static inline FlaggedCharsOriginal flag_similar_characters_original(
 }
 
 
-template <typename CharT1, typename CharT2>
+template <typename Policy = jaro_winkler::DefaultJaroPolicy, typename CharT1, typename CharT2>
 double jaro_similarity_original(const std::basic_string<CharT1>& P, const std::basic_string<CharT2>& T,
                                 double score_cutoff)
 {
-    auto flagged = flag_similar_characters_original(P, T);
+    auto flagged = flag_similar_characters_original<Policy>(P, T);
 
     // Count the number of transpositions
     int64_t Transpositions = 0;
@@ -82,9 +84,26 @@ double jaro_similarity_original(const std::basic_string<CharT1>& P, const std::b
         }
     }
 
-    double sim = jaro_winkler::detail::jaro_calculate_similarity(
-        static_cast<int64_t>(P.size()), static_cast<int64_t>(T.size()),
-        flagged.CommonChars, Transpositions);
+    double sim = 0;
+    if (flagged.CommonChars)
+        sim = jaro_winkler::detail::jaro_calculate_similarity(
+            static_cast<int64_t>(P.size()), static_cast<int64_t>(T.size()),
+            flagged.CommonChars, Transpositions);
+    return jaro_winkler::common::result_cutoff(sim, score_cutoff);
+}
+
+template <typename Policy = jaro_winkler::DefaultJaroPolicy, typename CharT1, typename CharT2>
+double jaro_winkler_similarity_original(const std::basic_string<CharT1>& P,
+                                        const std::basic_string<CharT2>& T, double prefix_weight,
+                                        double score_cutoff)
+{
+    double sim = jaro_similarity_original<Policy>(P, T, 0);
+    if (sim > Policy::boost_threshold()) {
+        size_t prefix = 0;
+        size_t max_prefix = std::min({P.size(), T.size(), static_cast<size_t>(Policy::max_prefix())});
+        while (prefix < max_prefix && P[prefix] == T[prefix]) prefix++;
+        sim += static_cast<double>(prefix) * prefix_weight * (1.0 - sim);
+    }
     return jaro_winkler::common::result_cutoff(sim, score_cutoff);
 }
 
@@ -178,4 +197,609 @@ TEST_CASE("JaroWinklerTest")
         }
     }
 
-}
\ No newline at end of file
+}
+TEST_CASE("CachedPatternSlab")
+{
+    std::vector<std::string> names = {
+        "james", "robert", "john", "michael", "william", "", "a",
+        "elizabeth", "barbara", "susan", "jessica", "sarah", "karen",
+        std::string(100, 'a') + "jaro winkler" + std::string(60, 'b')
+    };
+
+    std::vector<std::u32string> wide_names = {
+        U"james", U"jämes", U"中文字符", std::u32string(70, U'က') + U"jaro"
+    };
+
+    SECTION("matches CachedJaroWinklerSimilarity")
+    {
+        for (int64_t workers : {1, 3})
+        {
+            jaro_winkler::CachedPatternSlab<char> slab(names, workers);
+            REQUIRE(slab.size() == names.size());
+
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(names[i]);
+                jaro_winkler::CachedJaroSimilarity<char> jaro_scorer(names[i]);
+                REQUIRE(slab.pattern_length(i) == static_cast<int64_t>(names[i].size()));
+
+                for (const auto& name2 : names)
+                {
+                    INFO("Name1: " << names[i] << ", Name2: " << name2);
+                    REQUIRE(slab.jaro_winkler_similarity(i, name2) == scorer.similarity(name2));
+                    REQUIRE(slab.jaro_winkler_similarity(i, name2, 0.1, 0.8) ==
+                            scorer.similarity(name2, 0.8));
+                    REQUIRE(slab.jaro_similarity(i, name2) == jaro_scorer.similarity(name2));
+                }
+            }
+        }
+    }
+
+    SECTION("characters outside of extended ascii")
+    {
+        jaro_winkler::CachedPatternSlab<char32_t> slab(wide_names, 2);
+
+        for (size_t i = 0; i < wide_names.size(); ++i)
+        {
+            for (const auto& name2 : wide_names)
+            {
+                REQUIRE(slab.jaro_winkler_similarity(i, name2) ==
+                        jaro_winkler::jaro_winkler_similarity(wide_names[i], name2));
+            }
+        }
+    }
+}
+
+TEST_CASE("similarity_batch")
+{
+    std::vector<std::u32string> strings = {
+        U"james", U"jämes", U"robert", U"john", U"", U"j", U"michael", U"william",
+        U"jessica", U"中文字符", U"中文", U"elizabeth", std::u32string(63, U'a'),
+        std::u32string(64, U'a') + U"b", std::u32string(30, U'a') + U"jämes",
+        std::u32string(100, U'b') + U"karen", U"barbara", U"susan", U"sarah", U"karen",
+        U"william michael robert james", U"robert james william michael",
+        U"jessica sarah karen susan barbara", U"中文字符 jessica sarah karen susan",
+        U"elizabeth patricia jennifer linda mary", U"mary linda jennifer patricia elizabeth",
+        U"james robert john michael william david joseph thomas charles"
+    };
+
+    SECTION("matches the scalar implementation")
+    {
+        for (const auto& s1 : strings)
+        {
+            jaro_winkler::CachedJaroWinklerSimilarity<char32_t> scorer(s1);
+            jaro_winkler::CachedJaroSimilarity<char32_t> jaro_scorer(s1);
+
+            for (double score_cutoff : {0.0, 0.8})
+            {
+                std::vector<double> scores(strings.size());
+                std::vector<double> jaro_scores(strings.size());
+                scorer.similarity_batch(strings.begin(), strings.end(), scores.data(), score_cutoff);
+                jaro_scorer.similarity_batch(strings.begin(), strings.end(), jaro_scores.data(),
+                                             score_cutoff);
+
+                for (size_t i = 0; i < strings.size(); ++i)
+                {
+                    REQUIRE(scores[i] == scorer.similarity(strings[i], score_cutoff));
+                    REQUIRE(jaro_scores[i] == jaro_scorer.similarity(strings[i], score_cutoff));
+                }
+            }
+        }
+    }
+
+    SECTION("all lane counts flag the same characters")
+    {
+        std::u32string P = U"jämes michael";
+        jaro_winkler::common::BlockPatternMatchVector PM(P.begin(), P.end());
+        using Lane = jaro_winkler::detail::WordLane<std::u32string::iterator, std::u32string::iterator>;
+
+        for (int64_t count = 1; count <= 8; ++count)
+        {
+            std::vector<Lane> lanes;
+            for (int64_t i = 0; i < count; ++i)
+            {
+                auto& T = strings[static_cast<size_t>(i)];
+                auto P_last = P.end();
+                auto T_last = T.end();
+                int64_t Bound = jaro_winkler::detail::jaro_bounds(P.begin(), P_last, T.begin(), T_last);
+                lanes.push_back({P.begin(), P_last, T.begin(), T_last, Bound, {0, 0}});
+            }
+
+            auto expected = lanes;
+            jaro_winkler::detail::flag_similar_characters_word_lanes_scalar(PM, expected.data(), count);
+            jaro_winkler::detail::flag_similar_characters_word_lanes(PM, lanes.data(), count);
+
+            for (int64_t i = 0; i < count; ++i)
+            {
+                auto idx = static_cast<size_t>(i);
+                REQUIRE(lanes[idx].flagged.P_flag == expected[idx].flagged.P_flag);
+                REQUIRE(lanes[idx].flagged.T_flag == expected[idx].flagged.T_flag);
+            }
+        }
+    }
+
+    SECTION("lanes with a separate pattern per pair")
+    {
+        std::vector<std::u32string> short_strings;
+        for (const auto& s : strings)
+            if (s.size() <= 64) short_strings.push_back(s);
+
+        using Lane = jaro_winkler::detail::WordLane<std::u32string::iterator, std::u32string::iterator>;
+        for (int64_t count = 1; count <= 8; ++count)
+        {
+            std::vector<Lane> lanes;
+            std::vector<Lane> expected;
+            for (int64_t i = 0; i < count; ++i)
+            {
+                auto& P = short_strings[static_cast<size_t>(i * 5 + 1) % short_strings.size()];
+                auto& T = short_strings[static_cast<size_t>(i)];
+                auto P_last = P.end();
+                auto T_last = T.end();
+                int64_t Bound = jaro_winkler::detail::jaro_bounds(P.begin(), P_last, T.begin(), T_last);
+                lanes.push_back({P.begin(), P_last, T.begin(), T_last, Bound, {0, 0}});
+
+                jaro_winkler::common::PatternMatchVector PM(P.begin(), P_last);
+                expected.push_back(lanes.back());
+                jaro_winkler::detail::flag_similar_characters_word_lanes_scalar(PM, &expected.back(), 1);
+            }
+
+            auto scalar = lanes;
+            uint64_t PM_vals[64][8];
+            int64_t max_len = jaro_winkler::detail::load_pair_lanes<8>(scalar.data(), count, PM_vals);
+            jaro_winkler::detail::flag_word_lanes_scalar<8>(PM_vals, max_len, scalar.data(), count);
+            jaro_winkler::detail::flag_similar_characters_pair_lanes(lanes.data(), count);
+
+            for (int64_t i = 0; i < count; ++i)
+            {
+                auto idx = static_cast<size_t>(i);
+                REQUIRE(lanes[idx].flagged.P_flag == expected[idx].flagged.P_flag);
+                REQUIRE(lanes[idx].flagged.T_flag == expected[idx].flagged.T_flag);
+                REQUIRE(scalar[idx].flagged.P_flag == expected[idx].flagged.P_flag);
+                REQUIRE(scalar[idx].flagged.T_flag == expected[idx].flagged.T_flag);
+            }
+        }
+    }
+}
+
+struct NarrowWindowPolicy : jaro_winkler::DefaultJaroPolicy {
+    static constexpr int64_t match_window(int64_t P_len, int64_t T_len)
+    {
+        return std::max(P_len, T_len) / 8;
+    }
+};
+
+struct WideWindowPolicy : jaro_winkler::DefaultJaroPolicy {
+    static constexpr int64_t match_window(int64_t P_len, int64_t T_len)
+    {
+        return std::max(P_len, T_len);
+    }
+
+    static constexpr double boost_threshold()
+    {
+        return 0.5;
+    }
+
+    static constexpr int64_t max_prefix()
+    {
+        return 6;
+    }
+};
+
+template <typename Policy>
+void validate_policy(const std::vector<std::string>& strings)
+{
+    for (const auto& s1 : strings)
+    {
+        jaro_winkler::CachedJaroSimilarity<char, Policy> jaro_scorer(s1);
+        jaro_winkler::CachedJaroWinklerSimilarity<char, Policy> scorer(s1, 0.15);
+
+        std::vector<double> scores(strings.size());
+        scorer.similarity_batch(strings.begin(), strings.end(), scores.data());
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            const auto& s2 = strings[i];
+            INFO("s1: " << s1 << ", s2: " << s2);
+            double expected_jaro = jaro_similarity_original<Policy>(s1, s2, 0);
+            double expected = jaro_winkler_similarity_original<Policy>(s1, s2, 0.15, 0);
+
+            REQUIRE(jaro_winkler::jaro_similarity<Policy>(s1, s2) == Approx(expected_jaro));
+            REQUIRE(jaro_scorer.similarity(s2) == Approx(expected_jaro));
+            REQUIRE(jaro_winkler::jaro_winkler_similarity<Policy>(s1, s2, 0.15) == Approx(expected));
+            REQUIRE(scorer.similarity(s2) == Approx(expected));
+            REQUIRE(scores[i] == Approx(expected));
+        }
+    }
+}
+
+TEST_CASE("JaroPolicy")
+{
+    std::vector<std::string> strings = {
+        "a", "ab", "ba", "james", "jamse", "robert", "martha", "marhta", "dwayne", "duane",
+        "abcdefghij", "abcdefhgij", "jihgfedcba",
+        "the quick brown fox jumps over the lazy dog",
+        "the quick brown dog jumps over the lazy fox",
+        std::string(70, 'a') + "bcd", "bcd" + std::string(70, 'a'),
+    };
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> len_dist(1, 200);
+    std::uniform_int_distribution<int> char_dist('a', 'e');
+    for (int i = 0; i < 20; ++i)
+    {
+        std::string s(static_cast<size_t>(len_dist(gen)), 'a');
+        for (auto& ch : s) ch = static_cast<char>(char_dist(gen));
+        strings.push_back(s);
+    }
+
+    SECTION("default policy")
+    {
+        validate_policy<jaro_winkler::DefaultJaroPolicy>(strings);
+    }
+
+    SECTION("narrow match window")
+    {
+        validate_policy<NarrowWindowPolicy>(strings);
+    }
+
+    SECTION("wide match window and longer prefix")
+    {
+        validate_policy<WideWindowPolicy>(strings);
+        REQUIRE_THROWS_AS(jaro_winkler::jaro_winkler_similarity<WideWindowPolicy>("a", "a", 0.2),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(jaro_winkler::jaro_winkler_similarity("a", "a", 0.3), std::invalid_argument);
+        REQUIRE_NOTHROW(jaro_winkler::jaro_winkler_similarity("a", "a", 0.25));
+    }
+}
+
+TEST_CASE("processor")
+{
+    using jaro_winkler::processor::Lowercase;
+    using jaro_winkler::processor::Normalize;
+
+    SECTION("character mapping")
+    {
+        REQUIRE(Lowercase::map('A') == 'a');
+        REQUIRE(Lowercase::map(U'É') == U'é');
+        REQUIRE(Lowercase::map(U'Ÿ') == U'ÿ');
+        REQUIRE(Lowercase::map(U'Ł') == U'ł');
+        REQUIRE(Lowercase::map(U'中') == U'中');
+        REQUIRE(Normalize::map(U'É') == U'e');
+        REQUIRE(Normalize::map(U'Ł') == U'l');
+        REQUIRE(Normalize::map(U'ß') == U'ß');
+        REQUIRE(Normalize::map(U'\t') == U' ');
+        REQUIRE(Normalize::map(U'\u00A0') == U' ');
+        REQUIRE(Normalize::map(U'\u2009') == U' ');
+        REQUIRE(Normalize::map(U'\u3000') == U' ');
+        REQUIRE(Normalize::map(u'\u2028') == u' ');
+        /* 0xA0 is part of multibyte characters in UTF-8 */
+        REQUIRE(Normalize::map(static_cast<char>(0xA0)) == static_cast<char>(0xA0));
+        /* values outside of the character type are left unchanged */
+        REQUIRE(Normalize::map(static_cast<char>(0xC9)) == 'e');
+        REQUIRE(Lowercase::map(static_cast<char>(0xD7)) == static_cast<char>(0xD7));
+    }
+
+    SECTION("matches normalized copies")
+    {
+        std::vector<std::u32string> strings = {
+            U"José Müller", U"jose muller", U"JOSE\tMULLER", U"Łódź", U"lodz", U"Ærøskøbing",
+            U"STRASSE", U"Straße", U"", U"É", U"e",
+            U"ÀÁÂÃÄÅ ÈÉÊË ÌÍÎÏ ÒÓÔÕÖ ÙÚÛÜ àáâãäå èéêë ìíîï òóôõö ùúûü ĀāĂăĄą ĆćĈĉĊċČč",
+            U"aaaaaa eeee iiii ooooo uuuu aaaaaa eeee iiii ooooo uuuu aaaaaa cccccccc",
+        };
+
+        std::vector<std::u32string> normalized;
+        for (const auto& s : strings)
+        {
+            std::u32string copy;
+            for (auto ch : s) copy.push_back(Normalize::map(ch));
+            normalized.push_back(copy);
+        }
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            jaro_winkler::CachedJaroWinklerSimilarity<char32_t> scorer(
+                jaro_winkler::processed<Normalize>(strings[i]));
+            jaro_winkler::CachedJaroWinklerSimilarity<char32_t> expected_scorer(normalized[i]);
+
+            std::vector<jaro_winkler::ProcessedRange<Normalize, std::u32string::const_iterator>> texts;
+            for (const auto& s : strings) texts.push_back(jaro_winkler::processed<Normalize>(s));
+            std::vector<double> scores(texts.size());
+            scorer.similarity_batch(texts.begin(), texts.end(), scores.data());
+
+            for (size_t j = 0; j < strings.size(); ++j)
+            {
+                double expected = expected_scorer.similarity(normalized[j]);
+                REQUIRE(scorer.similarity(texts[j]) == expected);
+                REQUIRE(scores[j] == expected);
+                REQUIRE(jaro_winkler::jaro_winkler_similarity(texts[i], texts[j]) ==
+                        jaro_winkler::jaro_winkler_similarity(normalized[i], normalized[j]));
+            }
+        }
+
+        REQUIRE(jaro_winkler::jaro_similarity(jaro_winkler::processed<Normalize>(strings[0]),
+                                              jaro_winkler::processed<Normalize>(strings[2])) == 1.0);
+    }
+}
+
+TEST_CASE("Transpositions")
+{
+    /* 8 bit strings use the pext based transposition count when supported by the cpu.
+     * test_jaro-winkler-no-pext is built with JARO_WINKLER_DISABLE_PEXT to cover the
+     * scalar fallback on these hosts as well */
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> len_dist(1, 300);
+    std::uniform_int_distribution<int> char_dist('a', 'd');
+    for (int i = 0; i < 200; ++i)
+    {
+        std::string s1(static_cast<size_t>(len_dist(gen)), 'a');
+        std::string s2(static_cast<size_t>(len_dist(gen)), 'a');
+        for (auto& ch : s1) ch = static_cast<char>(char_dist(gen));
+        for (auto& ch : s2) ch = static_cast<char>(char_dist(gen));
+        std::u32string w1(s1.begin(), s1.end());
+        std::u32string w2(s2.begin(), s2.end());
+
+        INFO("s1: " << s1 << ", s2: " << s2);
+        double expected = jaro_similarity_original(s1, s2, 0);
+        REQUIRE(jaro_winkler::jaro_similarity(s1, s2) == Approx(expected));
+        REQUIRE(jaro_winkler::jaro_similarity(w1, w2) == Approx(expected));
+        REQUIRE(jaro_winkler::CachedJaroSimilarity<char>(s1).similarity(s2) == Approx(expected));
+    }
+}
+
+#ifdef JARO_WINKLER_DISABLE_PEXT
+TEST_CASE("DisablePext")
+{
+    REQUIRE(!jaro_winkler::intrinsics::cpu_supports_fast_pext());
+}
+#endif
+
+TEST_CASE("max_possible_score")
+{
+    std::mt19937 gen(99);
+    std::uniform_int_distribution<int> len_dist(1, 100);
+    std::uniform_int_distribution<int> char_dist('a', 'c');
+    std::vector<std::string> strings;
+    for (int i = 0; i < 30; ++i)
+    {
+        std::string s(static_cast<size_t>(len_dist(gen)), 'a');
+        for (auto& ch : s) ch = static_cast<char>(char_dist(gen));
+        strings.push_back(s);
+    }
+
+    jaro_winkler::CachedPatternSlab<char> slab(strings);
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        const std::string& s1 = strings[i];
+        jaro_winkler::CachedJaroSimilarity<char> jaro(s1);
+        jaro_winkler::CachedJaroWinklerSimilarity<char> jaro_winkler(s1);
+        for (const auto& s2 : strings)
+        {
+            int64_t len = static_cast<int64_t>(s2.size());
+            size_t prefix = 0;
+            while (prefix < std::min(s1.size(), s2.size()) && s1[prefix] == s2[prefix]) prefix++;
+
+            REQUIRE(jaro.similarity(s2) <= jaro.max_possible_score(len) + 1e-9);
+            REQUIRE(jaro_winkler.similarity(s2) <=
+                    jaro_winkler.max_possible_score(len, static_cast<int64_t>(prefix)) + 1e-9);
+            REQUIRE(jaro_winkler.max_possible_score(len, static_cast<int64_t>(prefix)) <=
+                    jaro_winkler.max_possible_score(len));
+            REQUIRE(slab.jaro_max_possible_score(i, len) == Approx(jaro.max_possible_score(len)));
+            REQUIRE(slab.jaro_winkler_max_possible_score(i, len, static_cast<int64_t>(prefix)) ==
+                    Approx(jaro_winkler.max_possible_score(len, static_cast<int64_t>(prefix))));
+        }
+
+        /* strings of the same length sharing the maximum prefix can be identical */
+        REQUIRE(jaro_winkler.max_possible_score(static_cast<int64_t>(s1.size())) == Approx(1.0));
+        REQUIRE(jaro.max_possible_score(0) == 0.0);
+    }
+
+    jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(std::string("abcd"));
+    REQUIRE(scorer.max_possible_score(8, 0) == Approx(2.5 / 3.0));
+    REQUIRE(scorer.max_possible_score(8, 2) == Approx(2.5 / 3.0 + 0.2 * (0.5 / 3.0)));
+}
+
+template <typename Word>
+double jaro_similarity_word_width(const std::string& P, const std::string& T)
+{
+    using namespace jaro_winkler;
+    int64_t P_len = static_cast<int64_t>(P.size());
+    int64_t T_len = static_cast<int64_t>(T.size());
+    int64_t Bound = static_cast<int64_t>(get_jaro_bound<DefaultJaroPolicy>(P, T));
+    int64_t CommonChars = 0;
+    int64_t Transpositions = 0;
+
+    /* the kernels expect the parts of the strings outside of the match window to be removed */
+    auto P_last = P.end();
+    auto T_last = T.end();
+    detail::jaro_bounds(P.begin(), P_last, T.begin(), T_last);
+    int64_t P_view_len = std::distance(P.begin(), P_last);
+    int64_t T_view_len = std::distance(T.begin(), T_last);
+
+    const int64_t bits = common::word_bits<Word>::value;
+    if (P_view_len <= bits && T_view_len <= bits)
+    {
+        common::BasicPatternMatchVector<Word> PM(P.begin(), P_last);
+        auto flagged = detail::flag_similar_characters_word(PM, P.begin(), P_last, T.begin(),
+                                                            T_last, static_cast<int>(Bound));
+        CommonChars = detail::count_common_chars(flagged);
+        Transpositions = detail::count_transpositions_word(PM, T.begin(), T_last, flagged);
+    }
+    else
+    {
+        common::BasicBlockPatternMatchVector<Word> PM(P.begin(), P_last);
+        auto flagged = detail::flag_similar_characters_block(PM, P.begin(), P_last, T.begin(),
+                                                             T_last, Bound);
+        CommonChars = detail::count_common_chars(flagged);
+        if (CommonChars)
+            Transpositions =
+                detail::count_transpositions_block(PM, T.begin(), T_last, flagged, CommonChars);
+    }
+
+    if (!CommonChars) return 0;
+    return detail::jaro_calculate_similarity(P_len, T_len, CommonChars, Transpositions);
+}
+
+TEST_CASE("WordWidth")
+{
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> len_dist(1, 150);
+    std::uniform_int_distribution<int> char_dist('a', 'd');
+    for (int i = 0; i < 300; ++i)
+    {
+        std::string s1(static_cast<size_t>(len_dist(gen)), 'a');
+        std::string s2(static_cast<size_t>(len_dist(gen)), 'a');
+        for (auto& ch : s1) ch = static_cast<char>(char_dist(gen));
+        for (auto& ch : s2) ch = static_cast<char>(char_dist(gen));
+
+        INFO("s1: " << s1 << ", s2: " << s2);
+        double expected = jaro_similarity_original(s1, s2, 0);
+        REQUIRE(jaro_similarity_word_width<uint32_t>(s1, s2) == Approx(expected));
+        REQUIRE(jaro_similarity_word_width<uint64_t>(s1, s2) == Approx(expected));
+    }
+}
+
+TEST_CASE("ScopedPatternCache")
+{
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> len_dist(1, 150);
+    std::uniform_int_distribution<int> char_dist('a', 'e');
+    std::vector<std::string> patterns;
+    std::vector<std::string> texts;
+    for (int i = 0; i < 8; ++i)
+    {
+        std::string s(static_cast<size_t>(len_dist(gen)), 'a');
+        for (auto& ch : s) ch = static_cast<char>(char_dist(gen));
+        patterns.push_back(s);
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        std::string s(static_cast<size_t>(len_dist(gen)), 'a');
+        for (auto& ch : s) ch = static_cast<char>(char_dist(gen));
+        texts.push_back(s);
+    }
+
+    std::vector<double> expected;
+    for (const auto& text : texts)
+        for (const auto& pattern : patterns)
+            expected.push_back(jaro_winkler::jaro_winkler_similarity(pattern, text));
+
+    using Cache = jaro_winkler::detail::PatternCache<char>;
+    {
+        jaro_winkler::ScopedPatternCache scope(4, 100);
+        size_t i = 0;
+        for (const auto& text : texts)
+        {
+            for (const auto& pattern : patterns)
+            {
+                REQUIRE(jaro_winkler::jaro_winkler_similarity(pattern, text) ==
+                        Approx(expected[i]));
+                REQUIRE(jaro_winkler::jaro_similarity(pattern, text) ==
+                        Approx(jaro_similarity_original(pattern, text, 0)));
+                REQUIRE(jaro_winkler::jaro_winkler_similarity(pattern, text, 0.1, 0.8) ==
+                        Approx(jaro_winkler_similarity_original(pattern, text, 0.1, 0.8)));
+                i++;
+            }
+        }
+        REQUIRE(Cache::size() <= 4);
+        REQUIRE(Cache::size() > 0);
+
+        {
+            jaro_winkler::ScopedPatternCache nested(1);
+            REQUIRE(Cache::size() == 0);
+            jaro_winkler::jaro_similarity(patterns[0], texts[0]);
+            jaro_winkler::jaro_similarity(patterns[1], texts[0]);
+            REQUIRE(Cache::size() == 1);
+        }
+        REQUIRE(Cache::size() == 0);
+
+        /* patterns longer than max_pattern_length are not cached */
+        jaro_winkler::jaro_similarity(std::string(101, 'a'), texts[0]);
+        REQUIRE(Cache::size() == 0);
+    }
+
+    jaro_winkler::jaro_similarity(patterns[0], texts[0]);
+    REQUIRE(Cache::size() == 0);
+}
+
+TEST_CASE("PatternMatchVector::remove")
+{
+    std::u32string pattern = U"abĀcƀaȀ";
+    jaro_winkler::common::PatternMatchVector PM(pattern.begin(), pattern.end());
+    REQUIRE(PM.get(U'a') == 0x21);
+    REQUIRE(PM.get(U'ƀ') == 0x10);
+
+    PM.remove(pattern.begin(), pattern.end());
+    for (char32_t ch : pattern) REQUIRE(PM.get(ch) == 0);
+
+    /* the vector can be reused for another pattern */
+    std::u32string pattern2 = U"ƀx";
+    PM.insert(pattern2.begin(), pattern2.end());
+    REQUIRE(PM.get(U'ƀ') == 0x1);
+    REQUIRE(PM.get(U'x') == 0x2);
+    REQUIRE(PM.get(U'a') == 0);
+}
+
+/* iterator over a string, which throws when the character at throw_pos is read */
+struct ThrowingIterator {
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char*;
+    using reference = char;
+
+    const char* ptr;
+    const char* throw_pos;
+
+    char operator*() const
+    {
+        if (ptr == throw_pos) throw std::runtime_error("read failed");
+        return *ptr;
+    }
+
+    char operator[](difference_type i) const
+    {
+        return *ThrowingIterator{ptr + i, throw_pos};
+    }
+
+    difference_type operator-(const ThrowingIterator& other) const
+    {
+        return ptr - other.ptr;
+    }
+
+    ThrowingIterator& operator++()
+    {
+        ++ptr;
+        return *this;
+    }
+
+    bool operator==(const ThrowingIterator& other) const
+    {
+        return ptr == other.ptr;
+    }
+
+    bool operator!=(const ThrowingIterator& other) const
+    {
+        return ptr != other.ptr;
+    }
+};
+
+TEST_CASE("ScratchPatternMatchVector")
+{
+    using Scratch = jaro_winkler::detail::ScratchPatternMatchVector<uint64_t, ThrowingIterator>;
+    std::string pattern = "abcdef";
+    const char* first = pattern.data();
+    const char* last = pattern.data() + pattern.size();
+
+    /* the entries inserted before the exception are reset */
+    REQUIRE_THROWS_AS(Scratch(ThrowingIterator{first, first + 3}, ThrowingIterator{last, nullptr}),
+                      std::runtime_error);
+
+    std::string pattern2 = "xa";
+    Scratch scratch(ThrowingIterator{&pattern2[0], nullptr},
+                    ThrowingIterator{&pattern2[0] + 2, nullptr});
+    REQUIRE(scratch.PM.get('x') == 0x1);
+    REQUIRE(scratch.PM.get('a') == 0x2);
+    REQUIRE(scratch.PM.get('b') == 0);
+    REQUIRE(scratch.PM.get('c') == 0);
+}
@@ -0,0 +1,411 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/process.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> get_choices()
+{
+    return {"james", "robert", "john", "michael", "william", "david", "joseph",
+            "thomas", "charles", "mary", "patricia", "jennifer", "linda", "elizabeth",
+            "barbara", "susan", "jessica", "sarah", "karen", "jamie", "jameson", "janet"};
+}
+
+static std::vector<jaro_winkler::ExtractMatch>
+extract_reference(const std::string& query, const std::vector<std::string>& choices, size_t limit,
+                  double score_cutoff)
+{
+    std::vector<jaro_winkler::ExtractMatch> res;
+    for (size_t i = 0; i < choices.size(); ++i) {
+        double score = jaro_winkler::jaro_winkler_similarity(query, choices[i]);
+        if (score >= score_cutoff) res.push_back({static_cast<int64_t>(i), score});
+    }
+    std::stable_sort(res.begin(), res.end(), [](const jaro_winkler::ExtractMatch& a,
+                                                const jaro_winkler::ExtractMatch& b) {
+        return a.score > b.score;
+    });
+    if (res.size() > limit) res.resize(limit);
+    return res;
+}
+
+static void require_equal(const std::vector<jaro_winkler::ExtractMatch>& a,
+                          const std::vector<jaro_winkler::ExtractMatch>& b)
+{
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        REQUIRE(a[i].index == b[i].index);
+        REQUIRE(a[i].score == b[i].score);
+    }
+}
+
+TEST_CASE("ExtractScan")
+{
+    auto choices = get_choices();
+
+    for (const auto& query : {std::string("james"), std::string("jennie"), std::string("")}) {
+        jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(query);
+
+        SECTION("extract matches a full sort")
+        {
+            for (size_t limit : {1, 3, 100}) {
+                for (double cutoff : {0.0, 0.8}) {
+                    INFO("query: " << query << " limit: " << limit << " cutoff: " << cutoff);
+                    require_equal(jaro_winkler::extract(scorer, choices, limit, cutoff),
+                                  extract_reference(query, choices, limit, cutoff));
+                }
+            }
+        }
+
+        SECTION("state is preserved between chunks")
+        {
+            auto scan = jaro_winkler::make_extract_scan(scorer, choices, 3, 0.5);
+            int64_t steps = 0;
+            while (!scan.done()) {
+                REQUIRE(scan.step(4) <= 4);
+                steps++;
+            }
+            REQUIRE(steps == 6);
+            REQUIRE(scan.processed() == static_cast<int64_t>(choices.size()));
+            REQUIRE(scan.step(4) == 0);
+            require_equal(scan.results(), extract_reference(query, choices, 3, 0.5));
+        }
+    }
+
+    SECTION("deduplicated choices")
+    {
+        std::vector<std::string> duplicated;
+        for (size_t i = 0; i < 200; ++i) {
+            duplicated.push_back(choices[(i * 7) % choices.size()]);
+        }
+
+        for (const auto& query : {std::string("james"), std::string("jennie"), std::string("")}) {
+            jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(query);
+            for (size_t limit : {1, 3, 100, 300}) {
+                for (double cutoff : {0.0, 0.8}) {
+                    INFO("query: " << query << " limit: " << limit << " cutoff: " << cutoff);
+                    require_equal(jaro_winkler::extract(scorer, duplicated, limit, cutoff, true),
+                                  extract_reference(query, duplicated, limit, cutoff));
+                }
+            }
+        }
+    }
+
+    SECTION("cutoff tightens once the result is full")
+    {
+        jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(std::string("james"));
+        auto scan = jaro_winkler::make_extract_scan(scorer, choices, 1);
+        REQUIRE(scan.current_cutoff() == 0.0);
+        scan.step(1);
+        REQUIRE(scan.current_cutoff() == 1.0);
+    }
+}
+
+#if JARO_WINKLER_HAS_COROUTINES
+TEST_CASE("scan_chunks")
+{
+    auto choices = get_choices();
+    jaro_winkler::CachedJaroWinklerSimilarity<char> scorer(std::string("jameson"));
+    auto scan = jaro_winkler::make_extract_scan(scorer, choices, 5);
+
+    std::vector<int64_t> progress;
+    for (int64_t processed : jaro_winkler::scan_chunks(scan, 10)) {
+        progress.push_back(processed);
+    }
+
+    REQUIRE(progress == std::vector<int64_t>{10, 20, 22});
+    require_equal(scan.results(), extract_reference("jameson", choices, 5, 0.0));
+
+    auto scan2 = jaro_winkler::make_extract_scan(scorer, choices, 5);
+    REQUIRE_THROWS_AS(jaro_winkler::scan_chunks(scan2, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(jaro_winkler::scan_chunks(scan2, -1), std::invalid_argument);
+}
+#endif
+
+TEST_CASE("cdist")
+{
+    auto choices = get_choices();
+    std::vector<std::string> queries = {"james", "jennie", "", std::string(80, 'a') + "james",
+                                        "elisabeth"};
+    choices.push_back(std::string(70, 'a') + "jamie");
+    /* duplicates on both sides and queries, which occur in the choices */
+    choices.insert(choices.end(), {"james", "", "jamie", "james", std::string(70, 'a') + "jamie"});
+    queries.insert(queries.end(), {"jennie", "james", "", "jamie"});
+
+    for (int64_t workers : {1, 2}) {
+        for (int64_t tile : {0, 1, 3}) {
+            for (bool deduplicate : {false, true}) {
+                INFO("workers: " << workers << " tile: " << tile << " dedup: " << deduplicate);
+                jaro_winkler::CdistOptions options;
+                options.workers = workers;
+                options.tiling.query_tile = tile;
+                options.tiling.choice_tile = tile;
+                options.score_cutoff = 0.5;
+                options.deduplicate = deduplicate;
+                options.numa = workers > 1;
+
+                auto jw_matrix = jaro_winkler::cdist_jaro_winkler(queries, choices, options);
+                auto jaro_matrix = jaro_winkler::cdist_jaro(queries, choices, options);
+                REQUIRE(jw_matrix.size() == queries.size() * choices.size());
+
+                for (size_t q = 0; q < queries.size(); ++q) {
+                    for (size_t c = 0; c < choices.size(); ++c) {
+                        INFO("query: " << queries[q] << " choice: " << choices[c]);
+                        REQUIRE(jw_matrix[q * choices.size() + c] ==
+                                jaro_winkler::jaro_winkler_similarity(queries[q], choices[c], 0.1,
+                                                                      0.5));
+                        REQUIRE(jaro_matrix[q * choices.size() + c] ==
+                                jaro_winkler::jaro_similarity(queries[q], choices[c], 0.5));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("parallel_for_nodes")
+{
+    REQUIRE(jaro_winkler::common::parse_cpu_list("0-3,8,10-11\n") ==
+            std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(jaro_winkler::common::parse_cpu_list("").empty());
+
+    const auto& system = jaro_winkler::common::NumaTopology::get();
+    if (!system.nodes()) return;
+
+    /* pretend the cpus of the first node form multiple nodes */
+    jaro_winkler::common::NumaTopology topology;
+    topology.node_cpus = {system.node_cpus[0], system.node_cpus[0], system.node_cpus[0]};
+
+    for (int64_t count : {0, 2, 100}) {
+        for (int64_t workers : {1, 2, 5}) {
+            INFO("count: " << count << " workers: " << workers);
+            std::vector<int> covered(static_cast<size_t>(count), 0);
+            std::atomic<int64_t> total_workers(0);
+            std::mutex mutex;
+
+            jaro_winkler::common::parallel_for_nodes(
+                topology, count, workers, [&](int64_t first, int64_t last, int64_t node_workers) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    total_workers += node_workers;
+                    for (int64_t i = first; i < last; ++i) {
+                        covered[static_cast<size_t>(i)]++;
+                    }
+                });
+
+            REQUIRE(std::all_of(covered.begin(), covered.end(), [](int c) { return c == 1; }));
+            REQUIRE(total_workers == workers);
+        }
+    }
+}
+
+TEST_CASE("SentenceDedup")
+{
+    std::vector<std::string> strings = {"james", "jamie", "james", "", "john", "", "jamie", "mary"};
+    jaro_winkler::detail::SentenceDedup<std::vector<std::string>::const_iterator> dedup(
+        strings.begin(), 3);
+
+    std::vector<int64_t> ids;
+    for (size_t i = 0; i < strings.size(); ++i) {
+        ids.push_back(dedup.insert(static_cast<int64_t>(i)));
+    }
+    /* only 3 distinct strings fit into the table */
+    REQUIRE(ids == std::vector<int64_t>{0, 1, 0, 2, -1, 2, 1, -1});
+    REQUIRE(dedup.size() == 3);
+
+    std::u32string wide = U"jamie";
+    REQUIRE(dedup.find(wide.begin(), wide.end()) == 1);
+    REQUIRE(dedup.find(strings[4].begin(), strings[4].end()) == -1);
+    REQUIRE(*(dedup.begin() + 2) == "");
+}
+
+TEST_CASE("pairwise")
+{
+    auto choices = get_choices();
+    std::vector<std::string> a;
+    std::vector<std::string> b;
+    for (const auto& s1 : choices) {
+        for (const auto& s2 : choices) {
+            a.push_back(s1);
+            b.push_back(s2);
+        }
+    }
+    /* pairs of every length class including pairs which only fit into the
+     * word kernel after removing the parts out of range of each other */
+    a.insert(a.end(), {"", "a", std::string(70, 'a') + "jamie", std::string(40, 'b') + "james",
+                       std::string(200, 'c'), "abcdefghijklmnopqrstuvwxyz"});
+    b.insert(b.end(), {"james", "a", "jamie", std::string(90, 'b') + "james", std::string(190, 'c'),
+                       "zyxwvutsrqponmlkjihgfedcba"});
+    /* more pairs than fit into a single window of the length class sorting */
+    for (size_t i = 0, count = a.size(); a.size() < 5000; i = (i + 7) % count) {
+        a.push_back(a[i]);
+        b.push_back(b[(i * 3) % count]);
+    }
+
+    std::u32string wide = {0x1F600, 'j', 'a', 0x10000, 'e', 's'};
+    std::vector<std::u32string> a_wide;
+    std::vector<std::u32string> b_wide;
+    for (size_t i = 0; i < a.size(); ++i) {
+        a_wide.push_back(std::u32string(a[i].begin(), a[i].end()));
+        b_wide.push_back(std::u32string(b[i].begin(), b[i].end()));
+        if (i % 3 == 0) b_wide.back() += wide;
+    }
+
+    for (int64_t workers : {1, 3}) {
+        for (double score_cutoff : {0.0, 0.8}) {
+            jaro_winkler::CdistOptions options;
+            options.workers = workers;
+            options.score_cutoff = score_cutoff;
+
+            auto jw_scores = jaro_winkler::pairwise_jaro_winkler(a, b, options);
+            auto jaro_scores = jaro_winkler::pairwise_jaro(a, b, options);
+            auto wide_scores = jaro_winkler::pairwise_jaro_winkler(a_wide, b_wide, options);
+            REQUIRE(jw_scores.size() == a.size());
+
+            for (size_t i = 0; i < a.size(); ++i) {
+                INFO("s1: " << a[i] << " s2: " << b[i]);
+                REQUIRE(jw_scores[i] ==
+                        jaro_winkler::jaro_winkler_similarity(a[i], b[i], 0.1, score_cutoff));
+                REQUIRE(jaro_scores[i] == jaro_winkler::jaro_similarity(a[i], b[i], score_cutoff));
+                REQUIRE(wide_scores[i] ==
+                        jaro_winkler::jaro_winkler_similarity(a_wide[i], b_wide[i], 0.1,
+                                                              score_cutoff));
+            }
+        }
+    }
+
+    std::vector<double> scores(a.size());
+    jaro_winkler::pairwise_jaro_winkler(a, b, scores.data());
+    REQUIRE(scores == jaro_winkler::pairwise_jaro_winkler(a, b));
+
+    REQUIRE(jaro_winkler::pairwise_jaro(std::vector<std::string>(), std::vector<std::string>())
+                .empty());
+    REQUIRE_THROWS_AS(jaro_winkler::pairwise_jaro(a, std::vector<std::string>()),
+                      std::invalid_argument);
+}
+
+TEST_CASE("cdist_sparse")
+{
+    auto choices = get_choices();
+    std::vector<std::string> queries = {"james", "jennie", "", std::string(80, 'a') + "james",
+                                        "elisabeth", "joseph", "mary"};
+    choices.push_back(std::string(70, 'a') + "jamie");
+
+    jaro_winkler::CdistOptions dense_options;
+    dense_options.score_cutoff = 0.7;
+    auto dense = jaro_winkler::cdist_jaro_winkler(queries, choices, dense_options);
+    size_t cols = choices.size();
+
+    std::vector<double> expected_scores;
+    std::vector<int64_t> expected_rows;
+    std::vector<int64_t> expected_cols;
+    for (size_t i = 0; i < dense.size(); ++i) {
+        if (dense[i] == 0) continue;
+        expected_scores.push_back(dense[i]);
+        expected_rows.push_back(static_cast<int64_t>(i / cols));
+        expected_cols.push_back(static_cast<int64_t>(i % cols));
+    }
+
+    for (int64_t workers : {1, 3}) {
+        for (int64_t tile : {0, 1, 2}) {
+            jaro_winkler::CdistOptions options = dense_options;
+            options.workers = workers;
+            options.tiling.query_tile = tile;
+            options.tiling.choice_tile = tile ? tile + 2 : 0;
+
+            jaro_winkler::CooMatrix coo;
+            jaro_winkler::cdist_jaro_winkler_sparse(queries, choices, coo, options);
+            REQUIRE(coo.rows == static_cast<int64_t>(queries.size()));
+            REQUIRE(coo.cols == static_cast<int64_t>(cols));
+            REQUIRE(coo.row == expected_rows);
+            REQUIRE(coo.col == expected_cols);
+            REQUIRE(coo.score == expected_scores);
+
+            jaro_winkler::CsrMatrix csr;
+            jaro_winkler::cdist_jaro_winkler_sparse(queries, choices, csr, options);
+            REQUIRE(csr.row_offsets.size() == queries.size() + 1);
+            REQUIRE(csr.col == expected_cols);
+            REQUIRE(csr.score == expected_scores);
+            for (size_t q = 0; q < queries.size(); ++q) {
+                for (int64_t i = csr.row_offsets[q]; i < csr.row_offsets[q + 1]; ++i) {
+                    REQUIRE(expected_rows[static_cast<size_t>(i)] == static_cast<int64_t>(q));
+                }
+            }
+        }
+    }
+
+    SECTION("jaro")
+    {
+        jaro_winkler::CooMatrix coo;
+        jaro_winkler::cdist_jaro_sparse(queries, choices, coo, dense_options);
+        auto jaro_dense = jaro_winkler::cdist_jaro(queries, choices, dense_options);
+        size_t nnz = 0;
+        for (size_t i = 0; i < jaro_dense.size(); ++i) {
+            if (jaro_dense[i] == 0) continue;
+            REQUIRE(coo.row[nnz] * static_cast<int64_t>(cols) + coo.col[nnz] ==
+                    static_cast<int64_t>(i));
+            REQUIRE(coo.score[nnz] == jaro_dense[i]);
+            nnz++;
+        }
+        REQUIRE(coo.nnz() == nnz);
+    }
+
+    SECTION("binary file")
+    {
+        std::string path = "jaro_winkler_test_sparse.bin";
+        jaro_winkler::CdistOptions options = dense_options;
+        options.workers = 2;
+        options.tiling.query_tile = 1;
+        {
+            jaro_winkler::SparseFileWriter writer(path);
+            /* a reused writer drops the records of the previous, larger result */
+            auto more_queries = queries;
+            more_queries.insert(more_queries.end(), queries.begin(), queries.end());
+            jaro_winkler::cdist_jaro_winkler_sparse(more_queries, choices, writer, options);
+            jaro_winkler::cdist_jaro_winkler_sparse(queries, choices, writer, options);
+            REQUIRE(writer.nnz() == expected_scores.size());
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        char magic[8];
+        uint32_t version, record_size;
+        uint64_t rows, file_cols, nnz;
+        file.read(magic, 8);
+        file.read(reinterpret_cast<char*>(&version), 4);
+        file.read(reinterpret_cast<char*>(&record_size), 4);
+        file.read(reinterpret_cast<char*>(&rows), 8);
+        file.read(reinterpret_cast<char*>(&file_cols), 8);
+        file.read(reinterpret_cast<char*>(&nnz), 8);
+        REQUIRE(std::string(magic, 8) == "JWSPARSE");
+        REQUIRE(record_size == 12);
+        REQUIRE(rows == queries.size());
+        REQUIRE(file_cols == cols);
+        REQUIRE(nnz == expected_scores.size());
+
+        for (size_t i = 0; i < nnz; ++i) {
+            uint32_t row, col;
+            float score;
+            file.read(reinterpret_cast<char*>(&row), 4);
+            file.read(reinterpret_cast<char*>(&col), 4);
+            file.read(reinterpret_cast<char*>(&score), 4);
+            REQUIRE(row == expected_rows[i]);
+            REQUIRE(col == expected_cols[i]);
+            REQUIRE(score == static_cast<float>(expected_scores[i]));
+        }
+        REQUIRE(file.peek() == EOF);
+        file.close();
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("parallel_for propagates exceptions")
+{
+    REQUIRE_THROWS_AS(jaro_winkler::common::parallel_for(8, 4, [](int64_t begin, int64_t) {
+                          if (begin >= 4) throw std::runtime_error("worker failed");
+                      }),
+                      std::runtime_error);
+}
@@ -0,0 +1,76 @@
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/record.hpp>
+
+using Catch::Approx;
+
+static std::vector<std::vector<std::string>> random_records(size_t count, unsigned seed)
+{
+    std::vector<std::string> names = {"james", "jamie", "jameson", "robert", "roberta", "mary",
+                                      "marie", "elizabeth", "elisabeth", ""};
+    std::vector<std::string> streets = {"main street", "main st", "high street", "station road",
+                                        "church lane", "church road", "mill lane"};
+    std::vector<std::string> cities = {"london", "londen", "leeds", "liverpool", "bristol",
+                                       "brighton", "manchester"};
+    std::vector<std::string> zips = {"12345", "12354", "54321", "12", "99999"};
+
+    std::mt19937 gen(seed);
+    auto pick = [&](const std::vector<std::string>& values) {
+        return values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(gen)];
+    };
+
+    std::vector<std::vector<std::string>> records;
+    for (size_t i = 0; i < count; ++i) {
+        records.push_back({pick(names), pick(names), pick(streets), pick(cities), pick(zips)});
+    }
+    return records;
+}
+
+TEST_CASE("CachedRecordSimilarity")
+{
+    std::vector<double> weights = {1.0, 3.0, 0.5, 2.0, 0.0};
+    auto queries = random_records(20, 1);
+    auto records = random_records(200, 2);
+
+    for (const auto& query : queries) {
+        jaro_winkler::CachedRecordSimilarity<char> scorer(query, weights);
+        REQUIRE(scorer.size() == query.size());
+
+        for (const auto& record : records) {
+            double expected = 0;
+            for (size_t i = 0; i < query.size(); ++i) {
+                expected += weights[i] * jaro_winkler::jaro_winkler_similarity(query[i], record[i]);
+            }
+            expected /= 6.5;
+
+            double full = scorer.similarity(record);
+            REQUIRE(full == Approx(expected));
+
+            for (double score_cutoff : {0.3, 0.6, 0.8, 0.9, full}) {
+                INFO("score_cutoff: " << score_cutoff);
+                REQUIRE(scorer.similarity(record, score_cutoff) ==
+                        ((full >= score_cutoff) ? full : 0.0));
+            }
+        }
+    }
+}
+
+TEST_CASE("CachedRecordSimilarity rejects invalid input")
+{
+    std::vector<std::string> query = {"james", "main street"};
+    REQUIRE_THROWS_AS(jaro_winkler::CachedRecordSimilarity<char>(query, {1.0}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(jaro_winkler::CachedRecordSimilarity<char>(query, {1.0, -1.0}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(jaro_winkler::CachedRecordSimilarity<char>(query, {0.0, 0.0}),
+                      std::invalid_argument);
+
+    jaro_winkler::CachedRecordSimilarity<char> scorer(query, {1.0, 1.0});
+    REQUIRE_THROWS_AS(scorer.similarity(std::vector<std::string>{"james"}), std::invalid_argument);
+    REQUIRE(scorer.similarity(query) == 1.0);
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <list>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/sequence.hpp>
+
+/* sequences of ids drawn from alphabet_size keys spread over the 64 bit range */
+static std::vector<std::vector<uint64_t>> random_sequences(size_t count, size_t max_len,
+                                                           uint64_t alphabet_size, unsigned seed)
+{
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<size_t> len_dist(0, max_len);
+    std::uniform_int_distribution<uint64_t> key_dist(0, alphabet_size - 1);
+
+    std::vector<std::vector<uint64_t>> sequences(count);
+    for (auto& seq : sequences) {
+        seq.resize(len_dist(gen));
+        for (auto& key : seq) {
+            /* keys sharing their low bits, which collide in BitvectorHashmap */
+            key = key_dist(gen) << 32;
+        }
+    }
+    return sequences;
+}
+
+TEST_CASE("SequencePatternMatchVector")
+{
+    for (const auto& seq : random_sequences(50, 300, 200, 1)) {
+        jaro_winkler::common::SequencePatternMatchVector PM(seq.begin(), seq.end());
+        jaro_winkler::common::BlockPatternMatchVector expected(seq.begin(), seq.end());
+        REQUIRE(PM.block_count() == expected.block_count());
+
+        for (int64_t block = 0; block < PM.block_count(); ++block) {
+            for (uint64_t key : seq) {
+                REQUIRE(PM.get(block, key) == expected.get(block, key));
+            }
+            REQUIRE(PM.get(block, uint64_t(12345)) == 0);
+        }
+    }
+
+    /* keys in the extended ascii range and negative keys */
+    std::vector<int64_t> seq = {0, 1, 255, 256, -1, -1, 1, 0};
+    jaro_winkler::common::SequencePatternMatchVector PM(seq.begin(), seq.end());
+    REQUIRE(PM.get(int64_t(0)) == 0x81);
+    REQUIRE(PM.get(int64_t(1)) == 0x42);
+    REQUIRE(PM.get(int64_t(-1)) == 0x30);
+    REQUIRE(PM.get(int64_t(2)) == 0);
+}
+
+TEST_CASE("CachedJaroSequenceSimilarity")
+{
+    for (uint64_t alphabet_size : {4, 100, 100000}) {
+        auto patterns = random_sequences(30, 300, alphabet_size, 2);
+        auto texts = random_sequences(30, 300, alphabet_size, 3);
+        /* similar sequences, so the cutoffs are reached */
+        texts.insert(texts.end(), patterns.begin(), patterns.begin() + 10);
+        for (size_t i = 0; i < 10; ++i) {
+            auto& seq = texts[texts.size() - 1 - i];
+            if (seq.size() > 2) std::swap(seq[0], seq[seq.size() / 2]);
+        }
+
+        for (const auto& pattern : patterns) {
+            jaro_winkler::CachedJaroSequenceSimilarity<uint64_t> jaro(pattern);
+            jaro_winkler::CachedJaroWinklerSequenceSimilarity<uint64_t> winkler(pattern, 0.2);
+
+            for (double cutoff : {0.0, 0.7, 0.9}) {
+                std::vector<double> scores(texts.size());
+                winkler.similarity_batch(texts.begin(), texts.end(), scores.data(), cutoff);
+
+                for (size_t i = 0; i < texts.size(); ++i) {
+                    const auto& text = texts[i];
+                    REQUIRE(jaro.similarity(text, cutoff) ==
+                            jaro_winkler::jaro_similarity(pattern, text, cutoff));
+
+                    double expected =
+                        jaro_winkler::jaro_winkler_similarity(pattern, text, 0.2, cutoff);
+                    REQUIRE(winkler.similarity(text, cutoff) == expected);
+                    REQUIRE(scores[i] == expected);
+                }
+            }
+        }
+    }
+
+    REQUIRE_THROWS_AS(
+        jaro_winkler::CachedJaroWinklerSequenceSimilarity<uint32_t>(std::vector<uint32_t>(), 0.5),
+        std::invalid_argument);
+
+    /* patterns only providing bidirectional iterators */
+    std::vector<uint64_t> pattern = {1, 2, 3, uint64_t(1) << 40, 5};
+    std::vector<uint64_t> text = {2, 1, 3, 5, uint64_t(1) << 40};
+    std::list<uint64_t> list(pattern.begin(), pattern.end());
+    jaro_winkler::CachedJaroSequenceSimilarity<uint64_t> jaro(list.begin(), list.end());
+    jaro_winkler::CachedJaroWinklerSequenceSimilarity<uint64_t> winkler(list);
+    REQUIRE(jaro.similarity(text) == jaro_winkler::jaro_similarity(pattern, text));
+    REQUIRE(winkler.similarity(text) == jaro_winkler::jaro_winkler_similarity(pattern, text));
+}
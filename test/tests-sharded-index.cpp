@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/sharded_index.hpp>
+
+#if JARO_WINKLER_HAS_MMAP
+#    include <sys/wait.h>
+#endif
+
+static std::vector<std::string> random_strings(size_t count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> len_dist(0, 20);
+    std::uniform_int_distribution<int> char_dist('a', 'f');
+
+    std::vector<std::string> strings(count);
+    for (auto& str : strings) {
+        str.resize(len_dist(gen));
+        for (auto& ch : str) {
+            ch = static_cast<char>(char_dist(gen));
+        }
+    }
+    return strings;
+}
+
+/* top-k computed by scoring every choice */
+static std::vector<jaro_winkler::ExtractMatch>
+reference_extract(const jaro_winkler::CachedPatternSlab<char>& slab, const std::string& query,
+                  size_t limit, double score_cutoff, bool winkler)
+{
+    std::vector<jaro_winkler::ExtractMatch> res;
+    for (size_t i = 0; i < slab.size(); ++i) {
+        double sim = winkler ? slab.jaro_winkler_similarity(i, query, 0.1, score_cutoff)
+                             : slab.jaro_similarity(i, query, score_cutoff);
+        if (sim >= score_cutoff) res.push_back({static_cast<int64_t>(i), sim});
+    }
+
+    std::sort(res.begin(), res.end(), jaro_winkler::detail::extract_match_better);
+    res.resize(std::min(limit, res.size()));
+    return res;
+}
+
+static void require_same_matches(const std::vector<jaro_winkler::ExtractMatch>& a,
+                                 const std::vector<jaro_winkler::ExtractMatch>& b)
+{
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        REQUIRE(a[i].index == b[i].index);
+        REQUIRE(a[i].score == b[i].score);
+    }
+}
+
+TEST_CASE("ShardCutoff")
+{
+    jaro_winkler::ShardCutoff cutoff(0.5);
+    REQUIRE(cutoff.load() == 0.5);
+
+    cutoff.raise(0.25);
+    REQUIRE(cutoff.load() == 0.5);
+    cutoff.raise(0.75);
+    REQUIRE(cutoff.load() == 0.75);
+
+    cutoff.reset();
+    REQUIRE(cutoff.load() == 0.0);
+    cutoff.raise(-0.0);
+    REQUIRE(cutoff.load() == 0.0);
+    cutoff.raise(0.1);
+    REQUIRE(cutoff.load() == 0.1);
+}
+
+TEST_CASE("ShardedPatternIndex")
+{
+    auto choices = random_strings(500, 1);
+    /* duplicates result in equal scores, which are ordered by their index */
+    choices.insert(choices.end(), choices.begin(), choices.begin() + 50);
+    auto queries = random_strings(20, 2);
+    jaro_winkler::CachedPatternSlab<char> slab(choices);
+
+    for (size_t shard_count : {1, 3, 8}) {
+        jaro_winkler::ShardedPatternIndex<char> index(choices, shard_count);
+        REQUIRE(index.size() == choices.size());
+        REQUIRE(index.shard_count() == shard_count);
+        REQUIRE(index.shard_offset(0) == 0);
+
+        for (const auto& query : queries) {
+            for (size_t limit : {0, 1, 5, 1000}) {
+                for (double cutoff : {0.0, 0.7}) {
+                    for (int64_t workers : {1, 4}) {
+                        auto expected = reference_extract(slab, query, limit, cutoff, true);
+                        require_same_matches(
+                            index.extract_jaro_winkler(query, limit, 0.1, cutoff, workers),
+                            expected);
+
+                        expected = reference_extract(slab, query, limit, cutoff, false);
+                        require_same_matches(index.extract_jaro(query, limit, cutoff, workers),
+                                             expected);
+                    }
+                }
+            }
+        }
+    }
+
+    REQUIRE_THROWS_AS(jaro_winkler::ShardedPatternIndex<char>(choices, 0), std::invalid_argument);
+    jaro_winkler::ShardedPatternIndex<char> index(choices, 2);
+    REQUIRE_THROWS_AS(index.extract_jaro_winkler(queries[0], 5, 0.5), std::invalid_argument);
+}
+
+TEST_CASE("shard cutoff prunes later shards")
+{
+    /* the first shard contains exact matches, so the second shard only
+     * has to report choices reaching a score of 1 */
+    std::vector<std::string> choices = {"abc", "abc", "abd", "xyz", "abd"};
+    jaro_winkler::CachedPatternSlab<char> first(choices.begin(), choices.begin() + 2);
+    jaro_winkler::CachedPatternSlab<char> second(choices.begin() + 2, choices.end());
+
+    jaro_winkler::ShardCutoff cutoff(0.0);
+    auto res1 = jaro_winkler::shard_extract_jaro_winkler(first, std::string("abc"), 2, cutoff);
+    REQUIRE(cutoff.load() == 1.0);
+    auto res2 =
+        jaro_winkler::shard_extract_jaro_winkler(second, std::string("abc"), 2, cutoff, 0.1, 2);
+    REQUIRE(res2.empty());
+
+    auto merged = jaro_winkler::merge_shard_results({res1, res2}, 2);
+    REQUIRE(merged.size() == 2);
+    REQUIRE(merged[0].index == 0);
+    REQUIRE(merged[1].index == 1);
+}
+
+#if JARO_WINKLER_HAS_MMAP
+TEST_CASE("shards in multiple processes")
+{
+    auto choices = random_strings(400, 3);
+    auto queries = random_strings(10, 4);
+    jaro_winkler::CachedPatternSlab<char> slab(choices);
+
+    /* every process maps its shard and the shared cutoff from files */
+    const size_t shard_count = 4;
+    std::string base = "/tmp/jaro_winkler_test_shard_" + std::to_string(getpid());
+    std::string cutoff_path = base + "_cutoff";
+    std::vector<int64_t> offsets;
+    for (size_t i = 0; i <= shard_count; ++i) {
+        offsets.push_back(static_cast<int64_t>(choices.size() * i / shard_count));
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        jaro_winkler::CachedPatternSlab<char> shard(choices.begin() + offsets[i],
+                                                    choices.begin() + offsets[i + 1]);
+        jaro_winkler::save_shared_index(shard, base + std::to_string(i));
+    }
+
+    jaro_winkler::MappedShardCutoff coordinator_cutoff(cutoff_path);
+    const size_t limit = 5;
+    for (const auto& query : queries) {
+        coordinator_cutoff.cutoff().reset(0.0);
+
+        std::vector<int> pipes;
+        std::vector<pid_t> children;
+        for (size_t i = 0; i < shard_count; ++i) {
+            int fds[2];
+            REQUIRE(pipe(fds) == 0);
+            pid_t pid = fork();
+            REQUIRE(pid >= 0);
+            if (pid == 0) {
+                close(fds[0]);
+                jaro_winkler::MappedPatternIndex<char> shard(base + std::to_string(i));
+                jaro_winkler::MappedShardCutoff cutoff(cutoff_path);
+                auto res = jaro_winkler::shard_extract_jaro_winkler(shard, query, limit,
+                                                                    cutoff.cutoff(), 0.1,
+                                                                    offsets[i]);
+                size_t bytes = res.size() * sizeof(jaro_winkler::ExtractMatch);
+                _exit(write(fds[1], res.data(), bytes) == static_cast<ssize_t>(bytes) ? 0 : 1);
+            }
+            close(fds[1]);
+            pipes.push_back(fds[0]);
+            children.push_back(pid);
+        }
+
+        std::vector<std::vector<jaro_winkler::ExtractMatch>> results(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            jaro_winkler::ExtractMatch match;
+            while (read(pipes[i], &match, sizeof(match)) == sizeof(match)) {
+                results[i].push_back(match);
+            }
+            close(pipes[i]);
+
+            int status = 0;
+            REQUIRE(waitpid(children[i], &status, 0) == children[i]);
+            REQUIRE(WIFEXITED(status));
+            REQUIRE(WEXITSTATUS(status) == 0);
+        }
+
+        require_same_matches(jaro_winkler::merge_shard_results(results, limit),
+                             reference_extract(slab, query, limit, 0.0, true));
+    }
+
+    for (size_t i = 0; i < shard_count; ++i) {
+        std::remove((base + std::to_string(i)).c_str());
+    }
+    std::remove(cutoff_path.c_str());
+}
+#endif
@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/shared_index.hpp>
+
+static std::vector<std::u32string> index_strings()
+{
+    return {
+        U"james", U"jämes", U"robert", U"", U"j", U"中文字符", U"中文",
+        std::u32string(63, U'a'), std::u32string(64, U'a') + U"b",
+        std::u32string(100, U'b') + U"karen", std::u32string(70, U'中') + U"jessica",
+        U"william michael robert james", U"mary linda jennifer patricia elizabeth"
+    };
+}
+
+TEST_CASE("SharedPatternIndexView")
+{
+    auto strings = index_strings();
+    jaro_winkler::CachedPatternSlab<char32_t> slab(strings);
+
+    size_t size = jaro_winkler::shared_index_size(slab);
+    std::vector<uint64_t> storage(size / sizeof(uint64_t) + 8);
+    /* the index has to be aligned to 64 bytes */
+    void* buffer = reinterpret_cast<void*>(
+        (reinterpret_cast<uintptr_t>(storage.data()) + 63) / 64 * 64);
+    jaro_winkler::write_shared_index(slab, buffer, size);
+
+    SECTION("matches the slab")
+    {
+        jaro_winkler::SharedPatternIndexView<char32_t> index(buffer, size);
+        REQUIRE(index.size() == slab.size());
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            REQUIRE(std::u32string(index.pattern_begin(i), index.pattern_end(i)) == strings[i]);
+
+            std::vector<double> scores(strings.size());
+            index.jaro_winkler_similarity_batch(i, strings.begin(), strings.end(), scores.data());
+            for (size_t j = 0; j < strings.size(); ++j)
+            {
+                double expected = slab.jaro_winkler_similarity(i, strings[j]);
+                REQUIRE(index.jaro_winkler_similarity(i, strings[j]) == expected);
+                REQUIRE(index.jaro_similarity(i, strings[j]) == slab.jaro_similarity(i, strings[j]));
+                REQUIRE(scores[j] == expected);
+            }
+        }
+    }
+
+    SECTION("rejects invalid buffers")
+    {
+        REQUIRE_THROWS_AS(jaro_winkler::SharedPatternIndexView<char32_t>(buffer, size - 1),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(jaro_winkler::SharedPatternIndexView<char>(buffer, size),
+                          std::invalid_argument);
+
+        static_cast<char*>(buffer)[0] = 'X';
+        REQUIRE_THROWS_AS(jaro_winkler::SharedPatternIndexView<char32_t>(buffer, size),
+                          std::invalid_argument);
+    }
+
+    SECTION("rejects corrupted offsets")
+    {
+        jaro_winkler::detail::SharedIndexHeader header;
+        std::memcpy(&header, buffer, sizeof(header));
+        int64_t* pattern_offsets =
+            reinterpret_cast<int64_t*>(static_cast<char*>(buffer) + header.pattern_offsets);
+        pattern_offsets[1] = 1000;
+        REQUIRE_THROWS_AS(jaro_winkler::SharedPatternIndexView<char32_t>(buffer, size),
+                          std::invalid_argument);
+    }
+
+    SECTION("rejects counts overflowing the layout")
+    {
+        /* (count + 1) * 8 wraps around to 0, so the layout describes a tiny index */
+        auto header = jaro_winkler::detail::shared_index_layout<char32_t>(
+            (uint64_t(1) << 61) - 1, 0, 0, 0);
+        REQUIRE(header.size <= size);
+        std::memcpy(buffer, &header, sizeof(header));
+        REQUIRE_THROWS_AS(jaro_winkler::SharedPatternIndexView<char32_t>(buffer, size),
+                          std::invalid_argument);
+    }
+
+    SECTION("rejects full hashmaps")
+    {
+        jaro_winkler::detail::SharedIndexHeader header;
+        std::memcpy(&header, buffer, sizeof(header));
+        REQUIRE(header.map_count > 0);
+
+        /* every slot of the first map is used */
+        uint64_t* map = reinterpret_cast<uint64_t*>(static_cast<char*>(buffer) + header.maps);
+        for (size_t slot = 0; slot < 128; ++slot) {
+            map[2 * slot] = 1000 + slot;
+            map[2 * slot + 1] = 1;
+        }
+        REQUIRE_THROWS_AS(jaro_winkler::SharedPatternIndexView<char32_t>(buffer, size),
+                          std::invalid_argument);
+    }
+}
+
+TEST_CASE("MappedPatternIndex")
+{
+    auto strings = index_strings();
+    jaro_winkler::CachedPatternSlab<char32_t> slab(strings);
+    std::string path = "jaro_winkler_test_index.bin";
+    jaro_winkler::save_shared_index(slab, path);
+
+    {
+        jaro_winkler::MappedPatternIndex<char32_t> index(path);
+        REQUIRE(index.size() == slab.size());
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            for (size_t j = 0; j < strings.size(); ++j)
+            {
+                REQUIRE(index.jaro_winkler_similarity(i, strings[j], 0.1, 0.5) ==
+                        slab.jaro_winkler_similarity(i, strings[j], 0.1, 0.5));
+            }
+        }
+    }
+
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(jaro_winkler::MappedPatternIndex<char32_t>(path), std::system_error);
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/token.hpp>
+
+static std::vector<std::string> split(const std::string& s)
+{
+    std::istringstream stream(s);
+    return std::vector<std::string>(std::istream_iterator<std::string>(stream),
+                                    std::istream_iterator<std::string>());
+}
+
+static std::string join(const std::vector<std::string>& tokens)
+{
+    std::string res;
+    for (const auto& token : tokens) {
+        if (!res.empty()) res += ' ';
+        res += token;
+    }
+    return res;
+}
+
+static double token_sort_reference(const std::string& s1, const std::string& s2)
+{
+    auto tokens1 = split(s1);
+    auto tokens2 = split(s2);
+    std::sort(tokens1.begin(), tokens1.end());
+    std::sort(tokens2.begin(), tokens2.end());
+    return jaro_winkler::jaro_winkler_similarity(join(tokens1), join(tokens2));
+}
+
+static double token_set_reference(const std::string& s1, const std::string& s2)
+{
+    auto split1 = split(s1);
+    auto split2 = split(s2);
+    std::set<std::string> tokens1(split1.begin(), split1.end());
+    std::set<std::string> tokens2(split2.begin(), split2.end());
+    if (tokens1.empty() || tokens2.empty()) return 0.0;
+
+    std::vector<std::string> sect;
+    std::vector<std::string> diff_ab;
+    std::vector<std::string> diff_ba;
+    std::set_intersection(tokens1.begin(), tokens1.end(), tokens2.begin(), tokens2.end(),
+                          std::back_inserter(sect));
+    std::set_difference(tokens1.begin(), tokens1.end(), tokens2.begin(), tokens2.end(),
+                        std::back_inserter(diff_ab));
+    std::set_difference(tokens2.begin(), tokens2.end(), tokens1.begin(), tokens1.end(),
+                        std::back_inserter(diff_ba));
+
+    if (sect.empty()) return jaro_winkler::jaro_winkler_similarity(join(diff_ab), join(diff_ba));
+
+    std::string sect_str = join(sect);
+    std::string ab = diff_ab.empty() ? sect_str : sect_str + " " + join(diff_ab);
+    std::string ba = diff_ba.empty() ? sect_str : sect_str + " " + join(diff_ba);
+    return std::max({jaro_winkler::jaro_winkler_similarity(sect_str, ab),
+                     jaro_winkler::jaro_winkler_similarity(sect_str, ba),
+                     jaro_winkler::jaro_winkler_similarity(ab, ba)});
+}
+
+TEST_CASE("token scorers")
+{
+    std::vector<std::string> strings = {"john smith",
+                                        "smith john",
+                                        "john  smith\tjr",
+                                        "jon smith",
+                                        "john john smith",
+                                        "smith",
+                                        "johnathan smythe",
+                                        "",
+                                        "   ",
+                                        "mary ann elizabeth",
+                                        "elizabeth mary",
+                                        "ann mary",
+                                        "the quick brown fox jumps over the lazy dog",
+                                        "lazy dog quick fox",
+                                        "a b c d e f",
+                                        "f e d c b a x"};
+
+    for (const auto& s1 : strings) {
+        jaro_winkler::CachedTokenSortJaroWinklerSimilarity<char> sort_scorer(s1);
+        jaro_winkler::CachedTokenSetJaroWinklerSimilarity<char> set_scorer(s1);
+
+        for (const auto& s2 : strings) {
+            INFO("s1: '" << s1 << "' s2: '" << s2 << "'");
+            double sort_expected = token_sort_reference(s1, s2);
+            double set_expected = token_set_reference(s1, s2);
+
+            for (double score_cutoff : {0.0, 0.5, 0.8, 0.95}) {
+                INFO("score_cutoff: " << score_cutoff);
+                REQUIRE(sort_scorer.similarity(s2, score_cutoff) ==
+                        ((sort_expected >= score_cutoff) ? sort_expected : 0.0));
+                REQUIRE(set_scorer.similarity(s2, score_cutoff) ==
+                        ((set_expected >= score_cutoff) ? set_expected : 0.0));
+            }
+
+            REQUIRE(jaro_winkler::token_sort_jaro_winkler_similarity(s1, s2) == sort_expected);
+            REQUIRE(jaro_winkler::token_set_jaro_winkler_similarity(s1, s2) == set_expected);
+        }
+    }
+
+    REQUIRE(jaro_winkler::token_sort_jaro_winkler_similarity(std::string("john smith"),
+                                                             std::string("smith john")) == 1.0);
+    REQUIRE(jaro_winkler::token_set_jaro_winkler_similarity(std::string("john smith"),
+                                                            std::string("smith john jr")) == 1.0);
+}
+
+TEST_CASE("token scorers with wide characters")
+{
+    std::u32string s1 = U"jämes　中文 smith";
+    std::u32string s2 = U"中文 jämes";
+
+    jaro_winkler::CachedTokenSetJaroWinklerSimilarity<char32_t> set_scorer(s1);
+    REQUIRE(set_scorer.similarity(s2) == 1.0);
+
+    jaro_winkler::CachedTokenSortJaroWinklerSimilarity<char32_t> sort_scorer(s1);
+    REQUIRE(sort_scorer.similarity(std::u32string(U"smith 中文\tjämes")) == 1.0);
+}
+
+TEST_CASE("token scorers with UTF-8")
+{
+    /* 'Р' is encoded as D0 A0, so splitting on 0xA0 would produce a D0 token */
+    REQUIRE(jaro_winkler::token_set_jaro_winkler_similarity(std::string("Рим"),
+                                                            std::string("Р")) ==
+            token_set_reference("Рим", "Р"));
+    REQUIRE(jaro_winkler::token_set_jaro_winkler_similarity(std::string("Рим"),
+                                                            std::string("Р")) < 1.0);
+
+    /* 'à' is encoded as C3 A0 */
+    std::string s1 = "café à la carte";
+    std::string s2 = "café a la carte";
+    REQUIRE(jaro_winkler::token_sort_jaro_winkler_similarity(s1, s2) ==
+            token_sort_reference(s1, s2));
+    jaro_winkler::CachedTokenSortJaroWinklerSimilarity<char> sort_scorer(s1);
+    REQUIRE(sort_scorer.similarity(std::string("carte café la à")) == 1.0);
+}
+
+TEST_CASE("token scorers with normalized strings")
+{
+    /* Normalize replaces the same characters with ' ', which the token scorers split on */
+    for (char32_t space : {U'\t', U'\u0085', U'\u00A0', U'\u1680', U'\u2000', U'\u200A',
+                           U'\u2028', U'\u202F', U'\u205F', U'\u3000'})
+    {
+        std::u32string s1 = U"smith";
+        s1 += space;
+        s1 += U"john";
+        std::u32string normalized;
+        for (char32_t ch : s1) normalized += jaro_winkler::processor::Normalize::map(ch);
+        REQUIRE(normalized == U"smith john");
+        std::u32string s2 = U"john smith";
+        REQUIRE(jaro_winkler::token_sort_jaro_winkler_similarity(s1, s2) == 1.0);
+    }
+}
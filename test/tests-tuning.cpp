@@ -0,0 +1,141 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jaro_winkler/tuning.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::vector<std::string> get_strings()
+{
+    std::vector<std::string> strings = {"james", "jameson", "", "elisabeth", "elizabeth"};
+    for (size_t len : {12, 20, 24, 31, 40, 64, 65, 100}) {
+        std::string str;
+        for (size_t i = 0; i < len; ++i) {
+            str += static_cast<char>('a' + (i * 7 + len) % 11);
+        }
+        strings.push_back(str);
+        strings.push_back(std::string(str.rbegin(), str.rend()));
+    }
+    return strings;
+}
+
+TEST_CASE("tuning profile")
+{
+    jaro_winkler::TuningProfile profile;
+    profile.lane_min_length = 17;
+    profile.max_lanes = 4;
+    profile.tile_l1_budget = 4096;
+    profile.tile_l2_budget = 1 << 20;
+
+    SECTION("save and load")
+    {
+        std::stringstream stream;
+        jaro_winkler::save_tuning_profile(profile, stream);
+        auto loaded = jaro_winkler::load_tuning_profile(stream);
+        REQUIRE(loaded.lane_min_length == 17);
+        REQUIRE(loaded.max_lanes == 4);
+        REQUIRE(loaded.tile_l1_budget == 4096);
+        REQUIRE(loaded.tile_l2_budget == 1 << 20);
+
+        std::string path = "tuning_profile_test.txt";
+        jaro_winkler::save_tuning_profile(profile, path);
+        REQUIRE(jaro_winkler::load_tuning_profile(path).tile_l2_budget == 1 << 20);
+        std::remove(path.c_str());
+    }
+
+    SECTION("unknown and missing keys")
+    {
+        std::stringstream stream("jaro_winkler_tuning_profile 1\nmax_lanes 0\nfuture_key 5\n");
+        auto loaded = jaro_winkler::load_tuning_profile(stream);
+        REQUIRE(loaded.max_lanes == 0);
+        REQUIRE(loaded.lane_min_length == jaro_winkler::TuningProfile().lane_min_length);
+    }
+
+    SECTION("invalid profiles are rejected")
+    {
+        std::stringstream no_header("max_lanes 4\n");
+        REQUIRE_THROWS_AS(jaro_winkler::load_tuning_profile(no_header), std::invalid_argument);
+        std::stringstream bad_value("jaro_winkler_tuning_profile 1\nmax_lanes x\n");
+        REQUIRE_THROWS_AS(jaro_winkler::load_tuning_profile(bad_value), std::invalid_argument);
+        std::stringstream out_of_range("jaro_winkler_tuning_profile 1\nmax_lanes 9\n");
+        REQUIRE_THROWS_AS(jaro_winkler::load_tuning_profile(out_of_range), std::invalid_argument);
+
+        profile.tile_l1_budget = 0;
+        REQUIRE_THROWS_AS(jaro_winkler::set_tuning_profile(profile), std::invalid_argument);
+        REQUIRE_THROWS_AS(jaro_winkler::load_tuning_profile("does/not/exist"), std::system_error);
+    }
+}
+
+TEST_CASE("tuning profile does not change results")
+{
+    auto strings = get_strings();
+    jaro_winkler::CdistOptions options;
+    options.score_cutoff = 0.6;
+    auto expected = jaro_winkler::cdist_jaro_winkler(strings, strings, options);
+    auto expected_pairs = jaro_winkler::pairwise_jaro(strings, strings);
+
+    jaro_winkler::TuningProfile defaults = jaro_winkler::get_tuning_profile();
+    for (int64_t max_lanes : {0, 1, 4, 8}) {
+        for (int64_t lane_min_length : {int64_t(0), int64_t(24),
+                                        std::numeric_limits<int64_t>::max()})
+        {
+            INFO("max_lanes: " << max_lanes << " lane_min_length: " << lane_min_length);
+            jaro_winkler::TuningProfile profile;
+            profile.max_lanes = max_lanes;
+            profile.lane_min_length = lane_min_length;
+            profile.tile_l1_budget = 1;
+            profile.tile_l2_budget = 1;
+            jaro_winkler::set_tuning_profile(profile);
+
+            REQUIRE(jaro_winkler::cdist_jaro_winkler(strings, strings, options) == expected);
+            REQUIRE(jaro_winkler::pairwise_jaro(strings, strings) == expected_pairs);
+        }
+    }
+    jaro_winkler::set_tuning_profile(defaults);
+}
+
+TEST_CASE("autotune")
+{
+    jaro_winkler::TuningProfile before = jaro_winkler::get_tuning_profile();
+
+    /* other threads keep seeing the active profile while autotune runs */
+    std::atomic<bool> done(false);
+    std::atomic<bool> changed(false);
+    std::thread observer([&]() {
+        while (!done) {
+            jaro_winkler::TuningProfile active = jaro_winkler::get_tuning_profile();
+            if (active.max_lanes != before.max_lanes ||
+                active.lane_min_length != before.lane_min_length ||
+                active.tile_l1_budget != before.tile_l1_budget ||
+                active.tile_l2_budget != before.tile_l2_budget)
+            {
+                changed = true;
+            }
+        }
+    });
+    jaro_winkler::TuningProfile profile = jaro_winkler::autotune(1);
+    done = true;
+    observer.join();
+    REQUIRE(!changed);
+    REQUIRE_NOTHROW(profile.validate());
+
+    /* autotune does not activate the profile */
+    jaro_winkler::TuningProfile after = jaro_winkler::get_tuning_profile();
+    REQUIRE(after.lane_min_length == before.lane_min_length);
+    REQUIRE(after.max_lanes == before.max_lanes);
+    REQUIRE(after.tile_l1_budget == before.tile_l1_budget);
+    REQUIRE(after.tile_l2_budget == before.tile_l2_budget);
+
+    std::string path = "autotune_profile_test.txt";
+    std::remove(path.c_str());
+    jaro_winkler::TuningProfile stored = jaro_winkler::load_or_autotune(path);
+    REQUIRE(jaro_winkler::get_tuning_profile().max_lanes == stored.max_lanes);
+    REQUIRE(jaro_winkler::load_tuning_profile(path).lane_min_length == stored.lane_min_length);
+    std::remove(path.c_str());
+    jaro_winkler::set_tuning_profile(before);
+}